@@ -316,6 +316,12 @@
    */
   #define HOT_BRANCH(cond) __builtin_expect(cond, 1)
 #endif
+#ifndef PREFETCH
+  /**
+   * Hints that memory at \p addr is going to be read soon.
+   */
+  #define PREFETCH(addr) __builtin_prefetch(addr, 0, 3)
+#endif
 #ifndef MARK_MALLOC_ALIGNED
   /**
    * Marks that a function allocates memory and returns a pointer to said memory.
@@ -6,7 +6,7 @@
 #include <memory/GAlloc.h>
 #include <structures/HashSet.h>
 #include <structures/Interface.h>
-#include <structures/SortedArray.h>
+#include <structures/PriorityQueue.h>
 
 #include <stddef.h>
 #include <stdint.h>
@@ -20,9 +20,8 @@ typedef struct {
 } RDataType;
 
 struct BestFSState {
-  // TODO: do this properly with a Heap data structure.
-  // SortedArray used as frontier.
-  SortedArray* frontier;
+  // PriorityQueue used as frontier.
+  PriorityQueue* frontier;
   // HashMap used as closed set.
   HashSet* closed_set;
   // Problem interface.
@@ -44,7 +43,7 @@ static int internal_bestfs_reverse_cmp_le(const RDataType* dti, const void* a, c
 BestFSState* bestfs_create(const ISearchProblem* problem, const void* initial_state) {
   BestFSState* obj = malloc(sizeof(BestFSState));
   if(obj != NULL) {
-    // Create special IDataType for sorting based on the heuristic.
+    // Create special IDataType, so that the state with the smallest heuristic is at the top.
     RDataType* rdti = malloc(sizeof(RDataType));
     if(rdti == NULL) {
       // Could not allocate data type for frontier.
@@ -54,25 +53,33 @@ BestFSState* bestfs_create(const ISearchProblem* problem, const void* initial_st
     memcpy(rdti, problem->state_interface, sizeof(IDataType));
     rdti->dti.cmp_l = (Compare)internal_bestfs_reverse_cmp_l;
     rdti->dti.cmp_le = (Compare)internal_bestfs_reverse_cmp_le;
+    // Reversed order no longer matches the key bits.
+    rdti->dti.key_kind = KEY_KIND_OPAQUE;
     rdti->old = problem->state_interface;
     // Allocate frontier/agenda.
-    SortedArray* sa = sorted_array_create((IDataType*)rdti);
-    if(sa == NULL) {
-      // SortedArray allocation failed.
+    PriorityQueue* pq = priority_queue_create((IDataType*)rdti, 0, 0);
+    if(pq == NULL) {
+      // PriorityQueue allocation failed.
+      free(rdti);
+      free(obj);
+      return NULL;
+    }
+    if(priority_queue_push(pq, initial_state) == INVALID_SIZE_T) {
+      priority_queue_destroy(pq);
       free(rdti);
       free(obj);
       return NULL;
     }
-    sorted_array_insert(sa, initial_state);
     // Allocate closed set.
-    HashSet* hs = hashset_create(problem->state_interface, 0, -1.0, -1.0);
+    HashSet* hs = hashset_create(problem->state_interface, 0, -1.0, -1.0, HASHSET_ENGINE_BUCKETS | HASHSET_CACHE_HASH | HASHSET_POW2 | HASHSET_MIX_HASH);
     if(hs == NULL) {
       // HashSet allocation failed.
-      sorted_array_destroy(sa);
+      priority_queue_destroy(pq);
+      free(rdti);
       free(obj);
       return NULL;
     }
-    obj->frontier = sa;
+    obj->frontier = pq;
     obj->closed_set = hs;
     obj->problem = problem;
     obj->interface = problem->state_interface;
@@ -85,7 +92,7 @@ BestFSState* bestfs_create(const ISearchProblem* problem, const void* initial_st
 }
 
 int bestfs_step(BestFSState* bfs, void* goal_state) {
-  if(sorted_array_size(bfs->frontier) == 0) {
+  if(priority_queue_size(bfs->frontier) == 0) {
     // No more nodes to search.
     return -1;
   }
@@ -96,7 +103,7 @@ int bestfs_step(BestFSState* bfs, void* goal_state) {
     return 2;
   }
   // Get first state.
-  if(COLD_BRANCH(sorted_array_pop(bfs->frontier, current_state))) {
+  if(COLD_BRANCH(priority_queue_pop(bfs->frontier, current_state))) {
     // Pop failed.
     falloc_free(current_state);
     return 2;
@@ -117,8 +124,8 @@ int bestfs_step(BestFSState* bfs, void* goal_state) {
   // Expand current state.
   TempArray children = bfs->problem->state_expand(bfs->problem, current_state);
   if(children.length != 0) {
-    if(COLD_BRANCH(sorted_array_merge(bfs->frontier, children.data, children.length))) {
-      // Merge failed.
+    if(COLD_BRANCH(priority_queue_push_many(bfs->frontier, children.data, children.length, NULL))) {
+      // Push failed.
       free(children.data);
       falloc_free(current_state);
       return 2;
@@ -137,7 +144,7 @@ int bestfs_step(BestFSState* bfs, void* goal_state) {
 }
 
 void bestfs_destroy(BestFSState* bfs) {
-  sorted_array_destroy(bfs->frontier);
+  priority_queue_destroy(bfs->frontier);
   hashset_destroy(bfs->closed_set);
   free(bfs->reverse_interface);
   free(bfs);
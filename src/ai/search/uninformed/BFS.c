@@ -1,4 +1,5 @@
 #include "BFS.h"
+#include "Uninformed.h"
 
 #include <Macros.h>
 #include <ai/search/SearchProblem.h>
@@ -10,6 +11,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 struct BFSState {
   // Queue used as frontier.
@@ -40,7 +42,7 @@ BFSState* bfs_create(const ISearchProblem* problem, const void* initial_state) {
       return NULL;
     }
     // Allocate closed set.
-    HashSet* hs = hashset_create(problem->state_interface, 0, -1.0, -1.0);
+    HashSet* hs = hashset_create(problem->state_interface, 0, -1.0, -1.0, HASHSET_ENGINE_BUCKETS | HASHSET_CACHE_HASH | HASHSET_POW2 | HASHSET_MIX_HASH);
     if(hs == NULL) {
       // HashSet allocation failed.
       dequeue_destroy(dq);
@@ -90,18 +92,12 @@ int bfs_step(BFSState* bfs, void* goal_state) {
   }
   // Expand current state.
   TempArray children = bfs->problem->state_expand(bfs->problem, current_state);
-  for(size_t i = 0; i < children.length; i++) {
-    // TODO: add more batch operations.
-    void* c = dti_element(bfs->interface, children.data, i);
-    if(hashset_contains(bfs->closed_set, c)) {
-      continue;
-    }
-    if(COLD_BRANCH(dequeue_push_back(bfs->frontier, c))) {
-      // Insertion failed.
-      free(children.data);
-      falloc_free(current_state);
-      return 2;
-    }
+  if(children.length != 0 &&
+     COLD_BRANCH(internal_uninformed_push_open(bfs->frontier, bfs->closed_set, bfs->interface, children, dequeue_push_back_many))) {
+    // Insertion failed.
+    free(children.data);
+    falloc_free(current_state);
+    return 2;
   }
   free(children.data);
   // Add current state to closed set.
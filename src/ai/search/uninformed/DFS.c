@@ -1,4 +1,5 @@
 #include "DFS.h"
+#include "Uninformed.h"
 
 #include <Macros.h>
 #include <ai/search/SearchProblem.h>
@@ -10,6 +11,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 struct DFSState {
   // Queue used as frontier.
@@ -40,7 +42,7 @@ DFSState* dfs_create(const ISearchProblem* problem, const void* initial_state) {
       return NULL;
     }
     // Allocate closed set.
-    HashSet* hs = hashset_create(problem->state_interface, 0, -1.0, -1.0);
+    HashSet* hs = hashset_create(problem->state_interface, 0, -1.0, -1.0, HASHSET_ENGINE_BUCKETS | HASHSET_CACHE_HASH | HASHSET_POW2 | HASHSET_MIX_HASH);
     if(hs == NULL) {
       // HashSet allocation failed.
       dequeue_destroy(dq);
@@ -90,18 +92,12 @@ int dfs_step(DFSState* dfs, void* goal_state) {
   }
   // Expand current state and add generated children to the frontier.
   TempArray children = dfs->problem->state_expand(dfs->problem, current_state);
-  for(size_t i = 0; i < children.length; i++) {
-    // TODO: add more batch operations.
-    void* c = dti_element(dfs->interface, children.data, i);
-    if(hashset_contains(dfs->closed_set, c)) {
-      continue;
-    }
-    if(COLD_BRANCH(dequeue_push_front(dfs->frontier, c))) {
-      // Insertion failed.
-      free(children.data);
-      falloc_free(current_state);
-      return 2;
-    }
+  if(children.length != 0 &&
+     COLD_BRANCH(internal_uninformed_push_open(dfs->frontier, dfs->closed_set, dfs->interface, children, dequeue_push_front_many))) {
+    // Insertion failed.
+    free(children.data);
+    falloc_free(current_state);
+    return 2;
   }
   free(children.data);
   // Add current state to closed set.
@@ -0,0 +1,53 @@
+#ifndef SSCE_SEARCH_UNINFORMED_H
+#define SSCE_SEARCH_UNINFORMED_H
+/**
+* @file
+* @brief Common code for the uninformed AI search algorithms.
+*/
+
+#include <Macros.h>
+#include <ai/search/SearchProblem.h>
+#include <memory/FAlloc.h>
+#include <structures/Bitfield.h>
+#include <structures/Dequeue.h>
+#include <structures/HashSet.h>
+#include <structures/Interface.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Internal usage only.
+ * Adds the \p children not in \p closed_set to \p frontier in one go, with \p push_many.
+ * Children are moved inside their array, which the caller still owns.
+ * Returns 0 on success.
+ */
+static inline int internal_uninformed_push_open(Dequeue* frontier, HashSet* closed_set, const IDataType* interface,
+                                                TempArray children, int (*push_many)(Dequeue*, const void*, size_t)) {
+  // Find out which children have already been searched, all at once.
+  size_t closed_bytes = bitfield_size((children.length + CHAR_BIT - 1) / CHAR_BIT);
+  void* closed_data = falloc_malloc_aligned(closed_bytes, sizeof(size_t));
+  if(COLD_BRANCH(closed_data == NULL)) {
+    // Allocation failed.
+    return 1;
+  }
+  Bitfield closed;
+  bitfield_init(&closed, closed_data, closed_bytes);
+  hashset_contains_many(closed_set, children.data, children.length, &closed);
+  // Move the open children together, so they can be added in one go.
+  size_t open = 0;
+  for(size_t i = 0; i < children.length; i++) {
+    if(bitfield_get(&closed, i)) {
+      continue;
+    }
+    if(open != i) {
+      memcpy(dti_element(interface, children.data, open), dti_element(interface, children.data, i), interface->size);
+    }
+    open++;
+  }
+  falloc_free(closed_data);
+  return push_many(frontier, children.data, open);
+}
+
+#endif /*SSCE_SEARCH_UNINFORMED_H*/
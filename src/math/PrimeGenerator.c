@@ -124,18 +124,16 @@ void internal_primegen_algo_pre(const Bitfield* bt, const uintmax_t start, const
  * Partial sieve pass.
  */
 void internal_primegen_algo_main(Bitfield* bt, const uintmax_t start, const uintmax_t end, const uintmax_t fast_bound, const size_t job_size) {
-  for(size_t i = 0; i < job_size; i++) {
-    // If current number is prime:
-    if(bitfield_get(bt, i)) {
-      uintmax_t current_prime = start + i * 2;
-      if(current_prime <= fast_bound) {
-        break;
-      }
-      for(uintmax_t not_prime = current_prime * current_prime; not_prime <= end; not_prime += current_prime) {
-        // Convert to bit index.
-        size_t not_prime_index = (not_prime - start) / 2;
-        bitfield_clear(bt, not_prime_index);
-      }
+  // Jump from prime to prime, skipping whole words of composites.
+  for(size_t i = bitfield_find_next_set(bt, 0); i < job_size; i = bitfield_find_next_set(bt, i + 1)) {
+    uintmax_t current_prime = start + i * 2;
+    if(current_prime <= fast_bound) {
+      break;
+    }
+    for(uintmax_t not_prime = current_prime * current_prime; not_prime <= end; not_prime += current_prime) {
+      // Convert to bit index.
+      size_t not_prime_index = (not_prime - start) / 2;
+      bitfield_clear(bt, not_prime_index);
     }
   }
 }
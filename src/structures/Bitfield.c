@@ -0,0 +1,89 @@
+#include "Bitfield.h"
+#include "BitfieldWords.h"
+
+#include <Macros.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * How many words select skips at once, counting them with the bulk popcount.
+ */
+#define SELECT_BLOCK_WORDS 32
+
+/*
+ * Internal functions.
+ */
+
+static inline const BitfieldWords* internal_bitfield_words() {
+  static const BitfieldWords* resolved = NULL;
+  // Every thread resolves the same table, so racing stores are harmless.
+  const BitfieldWords* words = __atomic_load_n(&resolved, __ATOMIC_RELAXED);
+  if(COLD_BRANCH(words == NULL)) {
+    words = internal_bitfield_resolve_words();
+    __atomic_store_n(&resolved, words, __ATOMIC_RELAXED);
+  }
+  return words;
+}
+
+#define GENERATE_OPERATION(name)                                                          \
+  int bitfield_##name(const Bitfield* dst, const Bitfield* a, const Bitfield* b) {        \
+    if(COLD_BRANCH(dst->__length != a->__length || dst->__length != b->__length)) {       \
+      return 1;                                                                           \
+    }                                                                                     \
+    internal_bitfield_words()->op_##name(dst->__data, a->__data, b->__data,               \
+                                         dst->__length / sizeof(size_t));                 \
+    return 0;                                                                             \
+  }
+
+/*
+ * Interface | Public Api.
+ */
+
+GENERATE_OPERATION(and);
+GENERATE_OPERATION(or);
+GENERATE_OPERATION(xor);
+GENERATE_OPERATION(andnot);
+
+size_t bitfield_popcount(const Bitfield* obj) {
+  return internal_bitfield_words()->popcount(obj->__data, obj->__length / sizeof(size_t));
+}
+
+size_t bitfield_rank(const Bitfield* obj, size_t index) {
+  BOUNDS_CHECK(index, bitfield_bits(obj) + 1);
+  size_t word = index / SIZE_T_BITS;
+  unsigned int bit = index % SIZE_T_BITS;
+  size_t r = internal_bitfield_words()->popcount(obj->__data, word);
+  if(bit != 0) {
+    r += bitfield_word_popcount(obj->__data[word] & ((((size_t)0x1) << bit) - 1));
+  }
+  return r;
+}
+
+size_t bitfield_select(const Bitfield* obj, size_t rank) {
+  bitfield_popcount_t* popcount = internal_bitfield_words()->popcount;
+  size_t words = obj->__length / sizeof(size_t);
+  size_t word = 0;
+  // Skip whole blocks, until the one containing the bit.
+  while(word + SELECT_BLOCK_WORDS <= words) {
+    size_t count = popcount(obj->__data + word, SELECT_BLOCK_WORDS);
+    if(count > rank) {
+      break;
+    }
+    rank -= count;
+    word += SELECT_BLOCK_WORDS;
+  }
+  for(; word < words; word++) {
+    size_t value = obj->__data[word];
+    size_t count = bitfield_word_popcount(value);
+    if(count > rank) {
+      // Drop the lower set bits.
+      for(; rank != 0; rank--) {
+        value &= value - 1;
+      }
+      return word * SIZE_T_BITS + bitfield_word_ctz(value);
+    }
+    rank -= count;
+  }
+  return words * SIZE_T_BITS;
+}
@@ -2,7 +2,11 @@
 #define SSCE_BITFIELD
 /**
 * @file
-* @brief Header library to operate a block of memory as a bitfield.
+* @brief Operate a block of memory as a bitfield.
+*
+* Single bit operations, ranges, searches and iteration are inlined.
+* Operations over whole bitfields work a word or a vector at a time
+* and are selected at runtime for the current cpu.
 */
 
 #include <Macros.h>
@@ -144,22 +148,143 @@ static inline FORCE_INLINE int bitfield_get(const Bitfield* obj, size_t index) {
   return !!value;
 }
 
-#define internal_bitfield_for_each_set(byte, byte_index, code_block) \
-  while(byte != 0) {                                                 \
-    MARK_UNUSED size_t bit_index = __builtin_ffs(byte) - 1;          \
-    byte ^= ((__typeof__(byte))0x1) << bit_index;                    \
-    bit_index += base_bit_index + byte_index * CHAR_BIT;             \
-    (code_block);                                                    \
+/**
+ * Returns how many bits the bitfield can hold.
+ */
+static inline FORCE_INLINE size_t bitfield_bits(const Bitfield* obj) {
+  return obj->__length / sizeof(size_t) * SIZE_T_BITS;
+}
+
+/**
+ * Index of the lowest set bit of a non zero word.
+ */
+static inline FORCE_INLINE unsigned int bitfield_word_ctz(size_t w) {
+  return sizeof(size_t) > sizeof(unsigned int) ? __builtin_ctzll(w) : __builtin_ctz(w);
+}
+
+/**
+ * Sets the bits in [begin, end).
+ */
+static inline void bitfield_set_range(const Bitfield* obj, size_t begin, size_t end) {
+  if(begin >= end) {
+    return;
+  }
+  size_t first = begin / SIZE_T_BITS;
+  size_t last = (end - 1) / SIZE_T_BITS;
+  BOUNDS_CHECK(last, obj->__length / sizeof(size_t));
+  size_t first_mask = SIZE_MAX << (begin % SIZE_T_BITS);
+  size_t last_mask = SIZE_MAX >> (SIZE_T_BITS - 1 - (end - 1) % SIZE_T_BITS);
+  if(first == last) {
+    obj->__data[first] |= first_mask & last_mask;
+    return;
+  }
+  obj->__data[first] |= first_mask;
+  memset(obj->__data + first + 1, 0xff, (last - first - 1) * sizeof(size_t));
+  obj->__data[last] |= last_mask;
+}
+
+/**
+ * Clears the bits in [begin, end).
+ */
+static inline void bitfield_clear_range(const Bitfield* obj, size_t begin, size_t end) {
+  if(begin >= end) {
+    return;
+  }
+  size_t first = begin / SIZE_T_BITS;
+  size_t last = (end - 1) / SIZE_T_BITS;
+  BOUNDS_CHECK(last, obj->__length / sizeof(size_t));
+  size_t first_mask = SIZE_MAX << (begin % SIZE_T_BITS);
+  size_t last_mask = SIZE_MAX >> (SIZE_T_BITS - 1 - (end - 1) % SIZE_T_BITS);
+  if(first == last) {
+    obj->__data[first] &= ~(first_mask & last_mask);
+    return;
+  }
+  obj->__data[first] &= ~first_mask;
+  memset(obj->__data + first + 1, 0x00, (last - first - 1) * sizeof(size_t));
+  obj->__data[last] &= ~last_mask;
+}
+
+/**
+ * Finds the first set bit at or after \p index.
+ * 
+ * @returns the index of the found bit or \ref bitfield_bits if there is none.
+ */
+static inline size_t bitfield_find_next_set(const Bitfield* obj, size_t index) {
+  size_t words = obj->__length / sizeof(size_t);
+  size_t word = index / SIZE_T_BITS;
+  if(word >= words) {
+    return words * SIZE_T_BITS;
   }
+  size_t value = obj->__data[word] & (SIZE_MAX << (index % SIZE_T_BITS));
+  while(value == 0) {
+    if(++word == words) {
+      return words * SIZE_T_BITS;
+    }
+    value = obj->__data[word];
+  }
+  return word * SIZE_T_BITS + bitfield_word_ctz(value);
+}
 
-#define internal_bitfield_for_each(byte, byte_index, code_block) \
-  for(size_t ibte_i = 0; ibte_i < CHAR_BIT; ibte_i++) {          \
-    MARK_UNUSED int bit_value = byte & 0x1;                      \
-    byte = byte >> 1;                                            \
-    MARK_UNUSED size_t bit_index = ibte_i;                       \
-    bit_index += base_bit_index + byte_index * CHAR_BIT;         \
-    (code_block);                                                \
+/**
+ * Finds the first cleared bit at or after \p index.
+ * 
+ * @returns the index of the found bit or \ref bitfield_bits if there is none.
+ */
+static inline size_t bitfield_find_next_clear(const Bitfield* obj, size_t index) {
+  size_t words = obj->__length / sizeof(size_t);
+  size_t word = index / SIZE_T_BITS;
+  if(word >= words) {
+    return words * SIZE_T_BITS;
   }
+  size_t value = ~obj->__data[word] & (SIZE_MAX << (index % SIZE_T_BITS));
+  while(value == 0) {
+    if(++word == words) {
+      return words * SIZE_T_BITS;
+    }
+    value = ~obj->__data[word];
+  }
+  return word * SIZE_T_BITS + bitfield_word_ctz(value);
+}
+
+/**
+ * Bitwise operations between whole bitfields.
+ * All three bitfields must have the same length, but \p dst may be the same as \p a or \p b.
+ * 
+ * @returns non zero if the lengths differ, in which case nothing is changed.
+ */
+EXPORT_API int bitfield_and(const Bitfield* dst, const Bitfield* a, const Bitfield* b) MARK_NONNULL_ARGS(1, 2, 3);
+/**
+ * See \ref bitfield_and.
+ */
+EXPORT_API int bitfield_or(const Bitfield* dst, const Bitfield* a, const Bitfield* b) MARK_NONNULL_ARGS(1, 2, 3);
+/**
+ * See \ref bitfield_and.
+ */
+EXPORT_API int bitfield_xor(const Bitfield* dst, const Bitfield* a, const Bitfield* b) MARK_NONNULL_ARGS(1, 2, 3);
+/**
+ * Clears in \p dst the bits of \p a which are set in \p b.
+ * See \ref bitfield_and.
+ */
+EXPORT_API int bitfield_andnot(const Bitfield* dst, const Bitfield* a, const Bitfield* b) MARK_NONNULL_ARGS(1, 2, 3);
+
+/**
+ * Counts the set bits.
+ */
+EXPORT_API size_t bitfield_popcount(const Bitfield* obj) MARK_NONNULL_ARGS(1);
+
+/**
+ * Counts the set bits in [0, \p index).
+ * \p index may be up to \ref bitfield_bits.
+ */
+EXPORT_API size_t bitfield_rank(const Bitfield* obj, size_t index) MARK_NONNULL_ARGS(1);
+
+/**
+ * Finds the set bit which has \p rank set bits before it.
+ * The inverse of \ref bitfield_rank.
+ * 
+ * @returns the index of the found bit or \ref bitfield_bits if fewer bits are set.
+ */
+EXPORT_API size_t bitfield_select(const Bitfield* obj, size_t rank) MARK_NONNULL_ARGS(1);
 
 /**
  * Executes code_block for each element in the bitfield with optinal.
@@ -173,77 +298,34 @@ static inline FORCE_INLINE int bitfield_get(const Bitfield* obj, size_t index) {
  * Has the same locals variables as the line where \ref bitfield_for_each is called(parameters included).
  * Also it has access to a variable `size_t bit_index` which contains the index of the found bit
  * and `int bit_value` the value of the found bit.
- * TODO: arm optimizations, counting the bits optimization for intel branch predictor.
  */
 #define bitfield_for_each(obj, filter, dense, code_block)                    \
   for(size_t bfe_i = 0; bfe_i < (obj)->__length / sizeof(size_t); bfe_i++) { \
     size_t bfe_value = (obj)->__data[bfe_i];                                 \
-    size_t base_bit_index = bfe_i * sizeof(size_t) * CHAR_BIT;               \
-    if(filter == 0) {                                                        \
-      MARK_UNUSED int bit_value = 0;                                         \
-      if(dense && bfe_value == SIZE_MAX) {                                   \
-        continue;                                                            \
-      }                                                                      \
-      bfe_value = ~bfe_value;                                                \
-      uint_least8_t bfe_b0 = EXTRACT_BYTE(bfe_value, 0);                     \
-      internal_bitfield_for_each_set(bfe_b0, 0, code_block);                 \
-      uint_least8_t bfe_b1 = EXTRACT_BYTE(bfe_value, 1);                     \
-      internal_bitfield_for_each_set(bfe_b1, 1, code_block);                 \
-      uint_least8_t bfe_b2 = EXTRACT_BYTE(bfe_value, 2);                     \
-      internal_bitfield_for_each_set(bfe_b2, 2, code_block);                 \
-      uint_least8_t bfe_b3 = EXTRACT_BYTE(bfe_value, 3);                     \
-      internal_bitfield_for_each_set(bfe_b3, 3, code_block);                 \
-      if(__SIZEOF_SIZE_T__ == 8) {                                           \
-        uint_least8_t bfe_b4 = EXTRACT_BYTE(bfe_value, 4);                   \
-        internal_bitfield_for_each_set(bfe_b4, 4, code_block);               \
-        uint_least8_t bfe_b5 = EXTRACT_BYTE(bfe_value, 5);                   \
-        internal_bitfield_for_each_set(bfe_b5, 5, code_block);               \
-        uint_least8_t bfe_b6 = EXTRACT_BYTE(bfe_value, 6);                   \
-        internal_bitfield_for_each_set(bfe_b6, 6, code_block);               \
-        uint_least8_t bfe_b7 = EXTRACT_BYTE(bfe_value, 7);                   \
-        internal_bitfield_for_each_set(bfe_b7, 7, code_block);               \
+    size_t base_bit_index = bfe_i * SIZE_T_BITS;                             \
+    if((filter) == 0 || (filter) == 1) {                                     \
+      MARK_UNUSED int bit_value = (filter);                                  \
+      if((filter) == 0) {                                                    \
+        if((dense) && bfe_value == SIZE_MAX) {                               \
+          continue;                                                          \
+        }                                                                    \
+        bfe_value = ~bfe_value;                                              \
       }                                                                      \
-    } else if(filter == 1) {                                                 \
-      MARK_UNUSED int bit_value = 1;                                         \
-      if(!dense && bfe_value == 0) {                                         \
+      else if(!(dense) && bfe_value == 0) {                                  \
         continue;                                                            \
       }                                                                      \
-      uint_least8_t bfe_b0 = EXTRACT_BYTE(bfe_value, 0);                     \
-      internal_bitfield_for_each_set(bfe_b0, 0, code_block);                 \
-      uint_least8_t bfe_b1 = EXTRACT_BYTE(bfe_value, 1);                     \
-      internal_bitfield_for_each_set(bfe_b1, 1, code_block);                 \
-      uint_least8_t bfe_b2 = EXTRACT_BYTE(bfe_value, 2);                     \
-      internal_bitfield_for_each_set(bfe_b2, 2, code_block);                 \
-      uint_least8_t bfe_b3 = EXTRACT_BYTE(bfe_value, 3);                     \
-      internal_bitfield_for_each_set(bfe_b3, 3, code_block);                 \
-      if(__SIZEOF_SIZE_T__ == 8) {                                           \
-        uint_least8_t bfe_b4 = EXTRACT_BYTE(bfe_value, 4);                   \
-        internal_bitfield_for_each_set(bfe_b4, 4, code_block);               \
-        uint_least8_t bfe_b5 = EXTRACT_BYTE(bfe_value, 5);                   \
-        internal_bitfield_for_each_set(bfe_b5, 5, code_block);               \
-        uint_least8_t bfe_b6 = EXTRACT_BYTE(bfe_value, 6);                   \
-        internal_bitfield_for_each_set(bfe_b6, 6, code_block);               \
-        uint_least8_t bfe_b7 = EXTRACT_BYTE(bfe_value, 7);                   \
-        internal_bitfield_for_each_set(bfe_b7, 7, code_block);               \
+      /* Visit the set bits only, lowest first. */                           \
+      while(bfe_value != 0) {                                                \
+        MARK_UNUSED size_t bit_index = base_bit_index;                       \
+        bit_index += bitfield_word_ctz(bfe_value);                           \
+        bfe_value &= bfe_value - 1;                                          \
+        (code_block);                                                        \
       }                                                                      \
     } else {                                                                 \
-      uint_least8_t bfe_b0 = EXTRACT_BYTE(bfe_value, 0);                     \
-      internal_bitfield_for_each(bfe_b0, 0, code_block);                     \
-      uint_least8_t bfe_b1 = EXTRACT_BYTE(bfe_value, 1);                     \
-      internal_bitfield_for_each(bfe_b1, 1, code_block);                     \
-      uint_least8_t bfe_b2 = EXTRACT_BYTE(bfe_value, 2);                     \
-      internal_bitfield_for_each(bfe_b2, 2, code_block);                     \
-      uint_least8_t bfe_b3 = EXTRACT_BYTE(bfe_value, 3);                     \
-      internal_bitfield_for_each(bfe_b3, 3, code_block);                     \
-      if(__SIZEOF_SIZE_T__ == 8) {                                           \
-        uint_least8_t bfe_b4 = EXTRACT_BYTE(bfe_value, 4);                   \
-        internal_bitfield_for_each(bfe_b4, 4, code_block);                   \
-        uint_least8_t bfe_b5 = EXTRACT_BYTE(bfe_value, 5);                   \
-        internal_bitfield_for_each(bfe_b5, 5, code_block);                   \
-        uint_least8_t bfe_b6 = EXTRACT_BYTE(bfe_value, 6);                   \
-        internal_bitfield_for_each(bfe_b6, 6, code_block);                   \
-        uint_least8_t bfe_b7 = EXTRACT_BYTE(bfe_value, 7);                   \
-        internal_bitfield_for_each(bfe_b7, 7, code_block);                   \
+      for(size_t bfe_j = 0; bfe_j < SIZE_T_BITS; bfe_j++) {                  \
+        MARK_UNUSED int bit_value = (bfe_value >> bfe_j) & 0x1;              \
+        MARK_UNUSED size_t bit_index = base_bit_index + bfe_j;               \
+        (code_block);                                                        \
       }                                                                      \
     }                                                                        \
   }
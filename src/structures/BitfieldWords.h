@@ -0,0 +1,73 @@
+#ifndef SSCE_BITFIELD_WORDS_H
+#define SSCE_BITFIELD_WORDS_H
+/**
+* @file
+* @brief Common code for the bulk word operations of Bitfield.
+*/
+
+#include <Macros.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef size_t(bitfield_popcount_t)(const size_t* words, size_t count);
+typedef void(bitfield_operation_t)(size_t* dst, const size_t* a, const size_t* b, size_t count);
+
+/**
+ * A bulk word operations implementation.
+ * Operations go over \p count words and \p dst may be the same as \p a or \p b.
+ */
+typedef struct {
+  bitfield_popcount_t* popcount;
+  // dst = a & b
+  bitfield_operation_t* op_and;
+  // dst = a | b
+  bitfield_operation_t* op_or;
+  // dst = a ^ b
+  bitfield_operation_t* op_xor;
+  // dst = a & ~b
+  bitfield_operation_t* op_andnot;
+} BitfieldWords;
+
+/*
+ * Portable implementation.
+ * The popcount is done in registers, as the library
+ * is not built with a hardware popcount instruction by default.
+ */
+static inline unsigned int bitfield_word_popcount(size_t w) {
+  uint64_t v = w;
+  v = v - ((v >> 1) & UINT64_C(0x5555555555555555));
+  v = (v & UINT64_C(0x3333333333333333)) + ((v >> 2) & UINT64_C(0x3333333333333333));
+  v = (v + (v >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+  return (unsigned int)((v * UINT64_C(0x0101010101010101)) >> 56);
+}
+
+static inline size_t bitfield_popcount_generic(const size_t* words, size_t count) {
+  size_t r = 0;
+  for(size_t i = 0; i < count; i++) {
+    r += bitfield_word_popcount(words[i]);
+  }
+  return r;
+}
+
+#define GENERATE_GENERIC_OPERATION(name, expr)                                                                \
+  static inline void bitfield_##name##_generic(size_t* dst, const size_t* a, const size_t* b, size_t count) { \
+    for(size_t i = 0; i < count; i++) {                                                                       \
+      size_t x = a[i];                                                                                        \
+      size_t y = b[i];                                                                                        \
+      dst[i] = (expr);                                                                                        \
+    }                                                                                                         \
+  }
+
+GENERATE_GENERIC_OPERATION(and, x & y);
+GENERATE_GENERIC_OPERATION(or, x | y);
+GENERATE_GENERIC_OPERATION(xor, x ^ y);
+GENERATE_GENERIC_OPERATION(andnot, x & ~y);
+
+/**
+ * Internal usage only.
+ * Selects the best implementation for the current cpu.
+ */
+const BitfieldWords* internal_bitfield_resolve_words();
+
+#endif /*SSCE_BITFIELD_WORDS_H*/
@@ -0,0 +1,12 @@
+#include "BitfieldWords.h"
+
+#include <Macros.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+static const BitfieldWords WORDS_GENERIC = {bitfield_popcount_generic, bitfield_and_generic, bitfield_or_generic, bitfield_xor_generic, bitfield_andnot_generic};
+
+MARK_COLD const BitfieldWords* internal_bitfield_resolve_words() {
+  return &WORDS_GENERIC;
+}
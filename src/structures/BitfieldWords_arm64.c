@@ -0,0 +1,23 @@
+#include "BitfieldWords.h"
+
+#include <Macros.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Advanced SIMD is mandatory, so the compiler turns this into cnt and addv.
+ */
+static size_t bitfield_popcount_neon(const size_t* words, size_t count) {
+  size_t r = 0;
+  for(size_t i = 0; i < count; i++) {
+    r += __builtin_popcountll(words[i]);
+  }
+  return r;
+}
+
+static const BitfieldWords WORDS_NEON = {bitfield_popcount_neon, bitfield_and_generic, bitfield_or_generic, bitfield_xor_generic, bitfield_andnot_generic};
+
+MARK_COLD const BitfieldWords* internal_bitfield_resolve_words() {
+  return &WORDS_NEON;
+}
@@ -0,0 +1,30 @@
+#include "BitfieldWords.h"
+
+#include <Macros.h>
+#include <Runtime.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+TARGET_EXT(popcnt) static size_t bitfield_popcount_popcnt(const size_t* words, size_t count) {
+  size_t r = 0;
+  for(size_t i = 0; i < count; i++) {
+    r += __builtin_popcount(words[i]);
+  }
+  return r;
+}
+
+static const BitfieldWords WORDS_GENERIC = {bitfield_popcount_generic, bitfield_and_generic, bitfield_or_generic, bitfield_xor_generic, bitfield_andnot_generic};
+static const BitfieldWords WORDS_POPCNT = {bitfield_popcount_popcnt, bitfield_and_generic, bitfield_or_generic, bitfield_xor_generic, bitfield_andnot_generic};
+
+MARK_COLD const BitfieldWords* internal_bitfield_resolve_words() {
+  Runtime* features = ssce_get_runtime();
+  if(features->cpu_x86_sse42) {
+    // Runtime has no popcnt flag, but every cpu with SSE4.2 has it.
+    EARLY_TRACE("Selecting bitfield_words_popcnt");
+    return &WORDS_POPCNT;
+  } else {
+    EARLY_TRACE("Selecting bitfield_words_generic");
+    return &WORDS_GENERIC;
+  }
+}
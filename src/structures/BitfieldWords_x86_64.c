@@ -0,0 +1,144 @@
+#include "BitfieldWords.h"
+
+#include <Macros.h>
+#include <Runtime.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+TARGET_EXT(popcnt) static size_t bitfield_popcount_popcnt(const size_t* words, size_t count) {
+  size_t r = 0;
+  for(size_t i = 0; i < count; i++) {
+    r += __builtin_popcountll(words[i]);
+  }
+  return r;
+}
+
+/*
+ * Nibble lookup popcount: every byte is split in two nibbles,
+ * which index a table of bit counts with a byte shuffle.
+ * Byte counts are summed for a few vectors, before being widened into 64 bit lanes with sad.
+ * A byte count grows by at most 8 per vector, so it does not overflow.
+ */
+#define POPCOUNT_UNROLL 8
+
+TARGET_EXT(avx2) static size_t bitfield_popcount_avx2(const size_t* words, size_t count) {
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for(; i + 4 * POPCOUNT_UNROLL <= count; i += 4 * POPCOUNT_UNROLL) {
+    __m256i bytes = _mm256_setzero_si256();
+    for(size_t j = 0; j < POPCOUNT_UNROLL; j++) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(words + i + j * 4));
+      __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low));
+      __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+      bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(lo, hi));
+    }
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+  }
+  for(; i + 4 <= count; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+    __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low));
+    __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+  }
+  size_t r = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+  _mm256_zeroupper();
+  for(; i < count; i++) {
+    r += bitfield_word_popcount(words[i]);
+  }
+  return r;
+}
+
+#define GENERATE_AVX2_OPERATION(name, expr)                                                                  \
+  TARGET_EXT(avx2) static void bitfield_##name##_avx2(size_t* dst, const size_t* a, const size_t* b, size_t count) { \
+    size_t i = 0;                                                                                            \
+    for(; i + 4 <= count; i += 4) {                                                                          \
+      __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));                                               \
+      __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));                                               \
+      _mm256_storeu_si256((__m256i*)(dst + i), (expr));                                                      \
+    }                                                                                                        \
+    _mm256_zeroupper();                                                                                      \
+    bitfield_##name##_generic(dst + i, a + i, b + i, count - i);                                             \
+  }
+
+GENERATE_AVX2_OPERATION(and, _mm256_and_si256(x, y));
+GENERATE_AVX2_OPERATION(or, _mm256_or_si256(x, y));
+GENERATE_AVX2_OPERATION(xor, _mm256_xor_si256(x, y));
+GENERATE_AVX2_OPERATION(andnot, _mm256_andnot_si256(y, x));
+
+/*
+ * Same as avx2, shuffling and summing bytes needs avx512bw.
+ */
+TARGET_EXT(avx512bw) static size_t bitfield_popcount_avx512(const size_t* words, size_t count) {
+  const __m512i lut = _mm512_set_epi64(0x0403030203020201, 0x0302020102010100, 0x0403030203020201, 0x0302020102010100,
+                                       0x0403030203020201, 0x0302020102010100, 0x0403030203020201, 0x0302020102010100);
+  const __m512i low = _mm512_set1_epi8(0x0f);
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+  for(; i + 8 * POPCOUNT_UNROLL <= count; i += 8 * POPCOUNT_UNROLL) {
+    __m512i bytes = _mm512_setzero_si512();
+    for(size_t j = 0; j < POPCOUNT_UNROLL; j++) {
+      __m512i v = _mm512_loadu_si512((const void*)(words + i + j * 8));
+      __m512i lo = _mm512_shuffle_epi8(lut, _mm512_and_si512(v, low));
+      __m512i hi = _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(v, 4), low));
+      bytes = _mm512_add_epi8(bytes, _mm512_add_epi8(lo, hi));
+    }
+    acc = _mm512_add_epi64(acc, _mm512_sad_epu8(bytes, _mm512_setzero_si512()));
+  }
+  for(; i + 8 <= count; i += 8) {
+    __m512i v = _mm512_loadu_si512((const void*)(words + i));
+    __m512i lo = _mm512_shuffle_epi8(lut, _mm512_and_si512(v, low));
+    __m512i hi = _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(v, 4), low));
+    acc = _mm512_add_epi64(acc, _mm512_sad_epu8(_mm512_add_epi8(lo, hi), _mm512_setzero_si512()));
+  }
+  size_t r = _mm512_reduce_add_epi64(acc);
+  _mm256_zeroupper();
+  for(; i < count; i++) {
+    r += bitfield_word_popcount(words[i]);
+  }
+  return r;
+}
+
+#define GENERATE_AVX512_OPERATION(name, expr)                                                                   \
+  TARGET_EXT(avx512f) static void bitfield_##name##_avx512(size_t* dst, const size_t* a, const size_t* b, size_t count) { \
+    size_t i = 0;                                                                                               \
+    for(; i + 8 <= count; i += 8) {                                                                             \
+      __m512i x = _mm512_loadu_si512((const void*)(a + i));                                                     \
+      __m512i y = _mm512_loadu_si512((const void*)(b + i));                                                     \
+      _mm512_storeu_si512((void*)(dst + i), (expr));                                                            \
+    }                                                                                                           \
+    _mm256_zeroupper();                                                                                         \
+    bitfield_##name##_generic(dst + i, a + i, b + i, count - i);                                                \
+  }
+
+GENERATE_AVX512_OPERATION(and, _mm512_and_si512(x, y));
+GENERATE_AVX512_OPERATION(or, _mm512_or_si512(x, y));
+GENERATE_AVX512_OPERATION(xor, _mm512_xor_si512(x, y));
+GENERATE_AVX512_OPERATION(andnot, _mm512_andnot_si512(y, x));
+
+static const BitfieldWords WORDS_GENERIC = {bitfield_popcount_generic, bitfield_and_generic, bitfield_or_generic, bitfield_xor_generic, bitfield_andnot_generic};
+static const BitfieldWords WORDS_POPCNT = {bitfield_popcount_popcnt, bitfield_and_generic, bitfield_or_generic, bitfield_xor_generic, bitfield_andnot_generic};
+static const BitfieldWords WORDS_AVX2 = {bitfield_popcount_avx2, bitfield_and_avx2, bitfield_or_avx2, bitfield_xor_avx2, bitfield_andnot_avx2};
+static const BitfieldWords WORDS_AVX512 = {bitfield_popcount_avx512, bitfield_and_avx512, bitfield_or_avx512, bitfield_xor_avx512, bitfield_andnot_avx512};
+
+MARK_COLD const BitfieldWords* internal_bitfield_resolve_words() {
+  Runtime* features = ssce_get_runtime();
+  if(features->cpu_x86_avx512f && features->cpu_x86_avx512bw) {
+    EARLY_TRACE("Selecting bitfield_words_avx512");
+    return &WORDS_AVX512;
+  } else if(features->cpu_x86_avx2) {
+    EARLY_TRACE("Selecting bitfield_words_avx2");
+    return &WORDS_AVX2;
+  } else if(features->cpu_x86_sse42) {
+    // Runtime has no popcnt flag, but every cpu with SSE4.2 has it.
+    EARLY_TRACE("Selecting bitfield_words_popcnt");
+    return &WORDS_POPCNT;
+  } else {
+    EARLY_TRACE("Selecting bitfield_words_generic");
+    return &WORDS_GENERIC;
+  }
+}
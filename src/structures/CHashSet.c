@@ -0,0 +1,504 @@
+#include "CHashSet.h"
+#include "CacheLine.h"
+
+#include <Config.h>
+#include <Macros.h>
+#include <core/PosixThreads.h>
+#include <memory/GAlloc.h>
+#include <structures/Interface.h>
+
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Link of memory waiting to be released.
+ * Must be the first member of every retired type.
+ */
+typedef struct Retired {
+  struct Retired* next;
+  // Epoch in which it was removed.
+  size_t epoch;
+} Retired;
+
+typedef struct CNode {
+  // Used only after the node has been removed.
+  Retired retired;
+  // Next node in the same bucket.
+  struct CNode* next;
+  // Cached hash, so resizes never call the user's hash.
+  size_t hash;
+  // The element is stored right after the node.
+} CNode;
+
+#define cnode_element(n) ((void*)((n) + 1))
+
+typedef struct {
+  Retired retired;
+  // Always a power of two.
+  size_t size;
+  CNode* buckets[];
+} CTable;
+
+typedef struct {
+  pthread_mutex_t lock;
+  // Memory removed under this lock, newest first.
+  Retired* retired;
+  size_t retired_count;
+  // Value of retired_count at which the next collection is attempted.
+  size_t collect_at;
+  // Lookups in progress, by the parity of the epoch they started in.
+  size_t readers[2];
+} Stripe;
+
+/*
+ * Implementation details:
+ * Removed memory is released with epoch based reclamation.
+ * A lookup counts itself as a reader of the current epoch, in the stripe of its hash.
+ * The epoch only advances once no reader of the previous epoch is left,
+ * so memory retired in epoch e can no longer be read when the epoch reaches e + 2.
+ */
+struct CHashSet {
+  // Current bucket array.
+  CTable* table;
+  // Odd while an expand is relinking nodes.
+  size_t seq;
+  // Current reclamation epoch.
+  size_t epoch;
+  size_t length;
+  size_t min_size;
+  float expand;
+  // Stripes are padded to the cache line size.
+  void* stripes_alloc;
+  uint8_t* stripes;
+  size_t stripe_stride;
+  const IDataType* interface;
+};
+
+#define STRIPE_MASK (STRUCTURES_CHASHSET_STRIPES - 1)
+
+#define internal_chashset_stripe_at(hs, i) ((Stripe*)((hs)->stripes + (i) * (hs)->stripe_stride))
+
+static inline Stripe* internal_chashset_stripe(const CHashSet* hs, size_t hash) {
+  return internal_chashset_stripe_at(hs, hash & STRIPE_MASK);
+}
+
+static inline size_t internal_chashset_round_pow2(size_t n) {
+  size_t r = STRUCTURES_CHASHSET_STRIPES;
+  while(r < n) {
+    r <<= 1;
+  }
+  return r;
+}
+
+static CTable* internal_chashset_table_alloc(size_t size) {
+  CTable* t = calloc(1, sizeof(CTable) + size * sizeof(CNode*));
+  if(t != NULL) {
+    t->size = size;
+  }
+  return t;
+}
+
+/**
+ * Registers a lookup as a reader of the current epoch.
+ * Returns the counter to pass to \ref internal_chashset_leave.
+ */
+static inline size_t* internal_chashset_enter(CHashSet* hs, Stripe* stripe) {
+  while(1) {
+    size_t epoch = __atomic_load_n(&hs->epoch, __ATOMIC_SEQ_CST);
+    size_t* readers = &stripe->readers[epoch & 1];
+    __atomic_add_fetch(readers, 1, __ATOMIC_SEQ_CST);
+    if(HOT_BRANCH(__atomic_load_n(&hs->epoch, __ATOMIC_SEQ_CST) == epoch)) {
+      return readers;
+    }
+    // The epoch advanced without seeing this reader, so count it in the new one.
+    __atomic_sub_fetch(readers, 1, __ATOMIC_RELEASE);
+  }
+}
+
+static inline void internal_chashset_leave(size_t* readers) {
+  __atomic_sub_fetch(readers, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Advances the epoch, if no reader of the previous epoch is left.
+ * Returns the current epoch.
+ */
+static size_t internal_chashset_advance(CHashSet* hs) {
+  size_t epoch = __atomic_load_n(&hs->epoch, __ATOMIC_SEQ_CST);
+  for(size_t i = 0; i < STRUCTURES_CHASHSET_STRIPES; i++) {
+    if(__atomic_load_n(&internal_chashset_stripe_at(hs, i)->readers[(epoch + 1) & 1], __ATOMIC_SEQ_CST) != 0) {
+      return epoch;
+    }
+  }
+  // Failing means another thread advanced it.
+  __atomic_compare_exchange_n(&hs->epoch, &epoch, epoch + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return __atomic_load_n(&hs->epoch, __ATOMIC_SEQ_CST);
+}
+
+static inline void internal_chashset_release(Retired* r) {
+  while(r != NULL) {
+    Retired* next = r->next;
+    free(r);
+    r = next;
+  }
+}
+
+/**
+ * Releases the memory retired under \p stripe, which no lookup can read anymore.
+ * Caller must hold the stripe lock.
+ */
+static void internal_chashset_collect(CHashSet* hs, Stripe* stripe) {
+  // Memory retired in the current epoch needs two advances.
+  internal_chashset_advance(hs);
+  size_t epoch = internal_chashset_advance(hs);
+  Retired** link = &stripe->retired;
+  size_t kept = 0;
+  while(*link != NULL && (*link)->epoch + 2 > epoch) {
+    link = &(*link)->next;
+    kept++;
+  }
+  internal_chashset_release(*link);
+  *link = NULL;
+  stripe->retired_count = kept;
+  // Lookups which are still running keep the rest, so do not retry on every removal.
+  stripe->collect_at = kept + STRUCTURES_CHASHSET_RECLAIM_BATCH;
+}
+
+/**
+ * Hands \p r over to reclamation, once it can no longer be reached from the table.
+ * Caller must hold the stripe lock.
+ */
+static inline void internal_chashset_retire(CHashSet* hs, Stripe* stripe, Retired* r) {
+  // The epoch must not be read before the unlink is visible.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  r->epoch = __atomic_load_n(&hs->epoch, __ATOMIC_SEQ_CST);
+  r->next = stripe->retired;
+  stripe->retired = r;
+  stripe->retired_count++;
+}
+
+static inline void internal_chashset_check_collect(CHashSet* hs, Stripe* stripe) {
+  if(COLD_BRANCH(stripe->retired_count >= stripe->collect_at)) {
+    internal_chashset_collect(hs, stripe);
+  }
+}
+
+/**
+ * Lock free lookup.
+ * Positive results are valid as soon as they are found.
+ * Negative results are validated against \ref CHashSet::seq,
+ * because an expand may move nodes under the reader's feet.
+ * Caller must be registered with \ref internal_chashset_enter.
+ */
+static const CNode* internal_chashset_find(CHashSet* hs, const void* kv, size_t hash) {
+  const IDataType* dti = hs->interface;
+  while(1) {
+    size_t seq = __atomic_load_n(&hs->seq, __ATOMIC_ACQUIRE);
+    if(COLD_BRANCH(seq & 1)) {
+      // Expand in progress, which relinks every node.
+      sched_yield();
+      continue;
+    }
+    CTable* t = __atomic_load_n(&hs->table, __ATOMIC_ACQUIRE);
+    CNode* n = __atomic_load_n(&t->buckets[hash & (t->size - 1)], __ATOMIC_ACQUIRE);
+    while(n != NULL) {
+      if(n->hash == hash && dti->cmp_eq(dti, add_offset(cnode_element(n), dti->offset), kv)) {
+        return n;
+      }
+      n = __atomic_load_n(&n->next, __ATOMIC_ACQUIRE);
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(HOT_BRANCH(__atomic_load_n(&hs->seq, __ATOMIC_RELAXED) == seq)) {
+      return NULL;
+    }
+  }
+}
+
+/**
+ * Finds the link pointing to the node matching \p kv,
+ * or the terminating link of the bucket if there is none.
+ * Caller must hold the stripe lock of \p hash.
+ */
+static CNode** internal_chashset_find_link(CHashSet* hs, const void* kv, size_t hash) {
+  const IDataType* dti = hs->interface;
+  CTable* t = hs->table;
+  CNode** link = &t->buckets[hash & (t->size - 1)];
+  CNode* n;
+  while((n = *link) != NULL) {
+    if(n->hash == hash && dti->cmp_eq(dti, add_offset(cnode_element(n), dti->offset), kv)) {
+      break;
+    }
+    link = &n->next;
+  }
+  return link;
+}
+
+static CNode* internal_chashset_node_alloc(const IDataType* dti, const void* value, size_t hash) {
+  CNode* n = malloc(sizeof(CNode) + dti->size);
+  if(n != NULL) {
+    n->hash = hash;
+    memcpy(cnode_element(n), value, dti->size);
+  }
+  return n;
+}
+
+static void internal_chashset_lock_all(CHashSet* hs) {
+  for(size_t i = 0; i < STRUCTURES_CHASHSET_STRIPES; i++) {
+    pthread_mutex_lock(&internal_chashset_stripe_at(hs, i)->lock);
+  }
+}
+
+static void internal_chashset_unlock_all(CHashSet* hs) {
+  for(size_t i = STRUCTURES_CHASHSET_STRIPES; i > 0; i--) {
+    pthread_mutex_unlock(&internal_chashset_stripe_at(hs, i - 1)->lock);
+  }
+}
+
+static void internal_chashset_expand(CHashSet* hs) {
+  internal_chashset_lock_all(hs);
+  CTable* old_table = hs->table;
+  size_t length = __atomic_load_n(&hs->length, __ATOMIC_RELAXED);
+  float ratio = ((double)length) / ((double)old_table->size);
+  if(ratio <= hs->expand) {
+    // Another thread expanded first.
+    internal_chashset_unlock_all(hs);
+    return;
+  }
+  CTable* new_table = internal_chashset_table_alloc(old_table->size * STRUCTURES_HASHSET_RESIZE_FACTOR);
+  if(new_table == NULL) {
+    EARLY_TRACE("internal_chashset_expand could not allocate new table!");
+    internal_chashset_unlock_all(hs);
+    return;
+  }
+  size_t mask = new_table->size - 1;
+  __atomic_store_n(&hs->seq, hs->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  // Each node is relinked exactly once, so readers still walking
+  // the old chains always reach the end of some bucket.
+  for(size_t i = 0; i < old_table->size; i++) {
+    CNode* n = old_table->buckets[i];
+    while(n != NULL) {
+      CNode* next = n->next;
+      CNode** link = &new_table->buckets[n->hash & mask];
+      __atomic_store_n(&n->next, *link, __ATOMIC_RELEASE);
+      *link = n;
+      n = next;
+    }
+  }
+  __atomic_store_n(&hs->table, new_table, __ATOMIC_RELEASE);
+  __atomic_store_n(&hs->seq, hs->seq + 1, __ATOMIC_RELEASE);
+  // Readers may still be using the old table.
+  Stripe* stripe = internal_chashset_stripe_at(hs, 0);
+  internal_chashset_retire(hs, stripe, &old_table->retired);
+  // Tables are large, so they are released as soon as the lookups using them are done.
+  stripe->collect_at = stripe->retired_count;
+  EARLY_TRACEF("internal_chashset_expand (%zu -> %zu)!", old_table->size, new_table->size);
+  internal_chashset_unlock_all(hs);
+}
+
+/**
+ * Expands if \p length elements are too many for \p size buckets.
+ * The size is read under a stripe lock, as the table may be released without one.
+ */
+static inline void internal_chashset_check_expand(CHashSet* hs, size_t length, size_t size) {
+  if(COLD_BRANCH(hs->expand == 0.0)) {
+    // Expanding disabled.
+    return;
+  }
+  float ratio = ((double)length) / ((double)size);
+  if(COLD_BRANCH(ratio > hs->expand)) {
+    internal_chashset_expand(hs);
+  }
+}
+
+/**
+ * Shared implementation of \ref chashset_add and \ref chashset_insert.
+ */
+static int internal_chashset_put(CHashSet* hs, const void* value, int replace) {
+  const IDataType* dti = hs->interface;
+  const void* kv = add_offset(value, dti->offset);
+  size_t hash = dti->hash(dti, kv);
+  Stripe* stripe = internal_chashset_stripe(hs, hash);
+  pthread_mutex_lock(&stripe->lock);
+  CNode** link = internal_chashset_find_link(hs, kv, hash);
+  CNode* old = *link;
+  if(old != NULL && !replace) {
+    pthread_mutex_unlock(&stripe->lock);
+    return 0;
+  }
+  CNode* n = internal_chashset_node_alloc(dti, value, hash);
+  if(n == NULL) {
+    pthread_mutex_unlock(&stripe->lock);
+    return -1;
+  }
+  if(old != NULL) {
+    // Replacing. Readers may be copying the old element, so it is swapped out.
+    n->next = old->next;
+    __atomic_store_n(link, n, __ATOMIC_RELEASE);
+    internal_chashset_retire(hs, stripe, &old->retired);
+    internal_chashset_check_collect(hs, stripe);
+    pthread_mutex_unlock(&stripe->lock);
+    EARLY_TRACE("chashset_add replaced element!");
+    return 0;
+  }
+  // Adding at the head of the bucket.
+  CTable* t = hs->table;
+  CNode** head = &t->buckets[hash & (t->size - 1)];
+  n->next = *head;
+  __atomic_store_n(head, n, __ATOMIC_RELEASE);
+  size_t length = __atomic_add_fetch(&hs->length, 1, __ATOMIC_RELAXED);
+  size_t size = t->size;
+  internal_chashset_check_collect(hs, stripe);
+  pthread_mutex_unlock(&stripe->lock);
+  internal_chashset_check_expand(hs, length, size);
+  return 1;
+}
+
+CHashSet* chashset_create(const IDataType* interface, size_t initial_size, float expand_ratio) {
+  if(initial_size == INVALID_SIZE_T || initial_size == 0) {
+    // Use default value.
+    initial_size = STRUCTURES_HASHSET_INITIAL_SIZE;
+  }
+  if(expand_ratio < 0.0f) {
+    // Use default value.
+    expand_ratio = STRUCTURES_HASHSET_EXPAND_RATIO;
+  }
+  CHashSet* obj = malloc(sizeof(CHashSet));
+  if(obj == NULL) {
+    return NULL;
+  }
+  // Give each stripe its own cache line.
+  size_t alignment = internal_cache_line_alignment();
+  obj->stripe_stride = ((sizeof(Stripe) + alignment - 1) / alignment) * alignment;
+  obj->stripes_alloc = malloc(STRUCTURES_CHASHSET_STRIPES * obj->stripe_stride + alignment);
+  obj->table = internal_chashset_table_alloc(internal_chashset_round_pow2(initial_size));
+  if(obj->stripes_alloc == NULL || obj->table == NULL) {
+    // Not enough memory.
+    free(obj->stripes_alloc);
+    free(obj->table);
+    free(obj);
+    return NULL;
+  }
+  obj->stripes = (uint8_t*)((((uintptr_t)obj->stripes_alloc) + alignment - 1) / alignment * alignment);
+  for(size_t i = 0; i < STRUCTURES_CHASHSET_STRIPES; i++) {
+    Stripe* stripe = (Stripe*)(obj->stripes + i * obj->stripe_stride);
+    pthread_mutex_init(&stripe->lock, NULL);
+    stripe->retired = NULL;
+    stripe->retired_count = 0;
+    stripe->collect_at = STRUCTURES_CHASHSET_RECLAIM_BATCH;
+    stripe->readers[0] = 0;
+    stripe->readers[1] = 0;
+  }
+  obj->seq = 0;
+  obj->epoch = 0;
+  obj->length = 0;
+  obj->min_size = obj->table->size;
+  obj->expand = expand_ratio;
+  obj->interface = interface;
+  return obj;
+}
+
+size_t chashset_size(CHashSet* hs) {
+  return __atomic_load_n(&hs->length, __ATOMIC_RELAXED);
+}
+
+int chashset_contains(CHashSet* hs, const void* value) {
+  const void* kv = add_offset(value, hs->interface->offset);
+  size_t hash = hs->interface->hash(hs->interface, kv);
+  size_t* readers = internal_chashset_enter(hs, internal_chashset_stripe(hs, hash));
+  int found = internal_chashset_find(hs, kv, hash) != NULL;
+  internal_chashset_leave(readers);
+  return found;
+}
+
+int chashset_get(CHashSet* hs, void* value) {
+  const void* kv = add_offset(value, hs->interface->offset);
+  size_t hash = hs->interface->hash(hs->interface, kv);
+  size_t* readers = internal_chashset_enter(hs, internal_chashset_stripe(hs, hash));
+  const CNode* n = internal_chashset_find(hs, kv, hash);
+  if(n != NULL) {
+    // Stored elements are never modified in place.
+    memcpy(value, cnode_element(n), hs->interface->size);
+  }
+  internal_chashset_leave(readers);
+  return n == NULL;
+}
+
+int chashset_add(CHashSet* hs, const void* value) {
+  return internal_chashset_put(hs, value, 1) < 0;
+}
+
+int chashset_insert(CHashSet* hs, const void* value) {
+  return internal_chashset_put(hs, value, 0);
+}
+
+int chashset_remove(CHashSet* hs, const void* value) {
+  const void* kv = add_offset(value, hs->interface->offset);
+  size_t hash = hs->interface->hash(hs->interface, kv);
+  Stripe* stripe = internal_chashset_stripe(hs, hash);
+  pthread_mutex_lock(&stripe->lock);
+  CNode** link = internal_chashset_find_link(hs, kv, hash);
+  CNode* n = *link;
+  if(n == NULL) {
+    // Not found.
+    pthread_mutex_unlock(&stripe->lock);
+    return 1;
+  }
+  // Readers on the removed node can still continue through its next link.
+  __atomic_store_n(link, n->next, __ATOMIC_RELEASE);
+  internal_chashset_retire(hs, stripe, &n->retired);
+  __atomic_sub_fetch(&hs->length, 1, __ATOMIC_RELAXED);
+  internal_chashset_check_collect(hs, stripe);
+  pthread_mutex_unlock(&stripe->lock);
+  return 0;
+}
+
+void chashset_reclaim(CHashSet* hs) {
+  for(size_t i = 0; i < STRUCTURES_CHASHSET_STRIPES; i++) {
+    Stripe* stripe = internal_chashset_stripe_at(hs, i);
+    internal_chashset_release(stripe->retired);
+    stripe->retired = NULL;
+    stripe->retired_count = 0;
+    stripe->collect_at = STRUCTURES_CHASHSET_RECLAIM_BATCH;
+  }
+}
+
+static void internal_chashset_table_destroy(CTable* t) {
+  for(size_t i = 0; i < t->size; i++) {
+    CNode* n = t->buckets[i];
+    while(n != NULL) {
+      CNode* next = n->next;
+      free(n);
+      n = next;
+    }
+  }
+  free(t);
+}
+
+int chashset_clear(CHashSet* hs) {
+  chashset_reclaim(hs);
+  internal_chashset_table_destroy(hs->table);
+  hs->length = 0;
+  // Recreate buckets.
+  hs->table = internal_chashset_table_alloc(hs->min_size);
+  if(hs->table == NULL) {
+    return 1;
+  }
+  return 0;
+}
+
+void chashset_destroy(CHashSet* hs) {
+  chashset_reclaim(hs);
+  if(hs->table != NULL) {
+    internal_chashset_table_destroy(hs->table);
+  }
+  for(size_t i = 0; i < STRUCTURES_CHASHSET_STRIPES; i++) {
+    Stripe* stripe = internal_chashset_stripe_at(hs, i);
+    pthread_mutex_destroy(&stripe->lock);
+  }
+  free(hs->stripes_alloc);
+  free(hs);
+}
\ No newline at end of file
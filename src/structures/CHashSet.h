@@ -0,0 +1,128 @@
+#ifndef SSCE_CHASHSET_H
+#define SSCE_CHASHSET_H
+/**
+ * @file
+ * @brief A HashSet which can be shared between threads.
+ *
+ * Lookups do not take any locks.
+ * Modifications lock only a stripe of the buckets,
+ * so threads working on different elements rarely contend.
+ * Expanding locks every stripe and lookups wait for it to finish.
+ *
+ * Removed elements can still be read by concurrent lookups,
+ * so their memory is released once every lookup which started before the removal is done.
+ */
+
+#include <Interface.h>
+#include <Macros.h>
+
+#include <stddef.h>
+
+/**
+ * Opaque structure containing internal data.
+ */
+struct CHashSet;
+typedef struct CHashSet CHashSet;
+
+/**
+ * Allocates a new CHashSet object.
+ * The bucket count is always a power of two and it never shrinks.
+ *
+ * @param interface \ref interface.
+ * @param initial_size How many buckets to allocate at initialization.
+ *   Use \ref INVALID_SIZE_T or 0 to use the defaults.
+ * @param expand_ratio When the currently stored elements
+ *   divided by the current allocated buckets grows above \p expand_ratio
+ *   the number of allocated buckets is increased.
+ *   Pass 0.0 to disable expanding, or a negative value to use the defaults.
+ * @returns the allocated CHashSet or NULL if there was not enough memory available.
+ */
+EXPORT_API MARK_OBJ_ALLOC CHashSet* chashset_create(const IDataType* interface, size_t initial_size, float expand_ratio) MARK_NONNULL_ARGS(1);
+
+/**
+ * Gets the number of currently stored elements.
+ *
+ * @param hs \ref chashset_create.
+ * @returns element count.
+ */
+EXPORT_API size_t chashset_size(CHashSet* hs) MARK_NONNULL_ARGS(1);
+
+/**
+ * Checks if \p value exists in the \ref CHashSet.
+ * Thread safe and lock free.
+ *
+ * @param hs \ref chashset_create.
+ * @param value pointer to value to search.
+ * @returns boolean (0 -> not found).
+ */
+EXPORT_API int chashset_contains(CHashSet* hs, const void* value) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Retrieves the stored element which matches \p value
+ * Thread safe and lock free.
+ *
+ * @param hs \ref chashset_create.
+ * @param value pointer to value to retrieve (inout).
+ * @returns non zero on error (not found).
+ */
+EXPORT_API int chashset_get(CHashSet* hs, void* value) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Adds element \p value if it does not exist in the \ref CHashSet.
+ * Replaces element \p value if it exists in the \ref CHashSet.
+ * Thread safe.
+ *
+ * @param hs \ref chashset_create.
+ * @param value pointer to value to add.
+ * @returns non zero on error.
+ */
+EXPORT_API int chashset_add(CHashSet* hs, const void* value) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Adds element \p value only if it does not exist in the \ref CHashSet.
+ * The check and the insertion happen atomically,
+ * so exactly one of many threads inserting the same element succeeds.
+ * Thread safe.
+ *
+ * @param hs \ref chashset_create.
+ * @param value pointer to value to add.
+ * @returns 1 if \p value was added, 0 if it already existed, -1 on error.
+ */
+EXPORT_API int chashset_insert(CHashSet* hs, const void* value) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Removes element \p value if it exists in the \ref CHashSet.
+ * Thread safe.
+ *
+ * @param hs \ref chashset_create.
+ * @param value pointer to value to remove.
+ * @returns non zero on error.
+ */
+EXPORT_API int chashset_remove(CHashSet* hs, const void* value) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Releases memory of removed elements and old bucket arrays right away,
+ * instead of waiting for the lookups which might still read it.
+ * Must not run concurrently with any other operation on \p hs.
+ *
+ * @param hs \ref chashset_create.
+ */
+EXPORT_API void chashset_reclaim(CHashSet* hs) MARK_NONNULL_ARGS(1);
+
+/**
+ * Removes all stored elements in this \ref CHashSet.
+ * Must not run concurrently with any other operation on \p hs.
+ *
+ * @param hs \ref chashset_create.
+ * @returns non zero on error.
+ */
+EXPORT_API int chashset_clear(CHashSet* hs) MARK_NONNULL_ARGS(1);
+
+/**
+ * Deallocates a previously allocated \ref CHashSet data structure.
+ *
+ * @param hs \ref chashset_create.
+ */
+EXPORT_API void chashset_destroy(CHashSet* hs) MARK_NONNULL_ARGS(1);
+
+#endif /*SSCE_CHASHSET_H*/
\ No newline at end of file
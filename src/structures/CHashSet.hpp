@@ -0,0 +1,20 @@
+#ifndef SSCE_CHASHSET_HPP
+#define SSCE_CHASHSET_HPP
+/**
+ * @file
+ * @brief A HashSet which can be shared between threads.
+ */
+
+#include <Macros.h>
+C_DECLS_START
+#include <CHashSet.h>
+C_DECLS_END
+
+#include <Interface.hpp>
+
+namespace ssce {
+
+// TODO:
+
+} // namespace ssce
+#endif /*SSCE_CHASHSET_HPP*/
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "CQueue.h"
+#include "CacheLine.h"
+
+#include <Macros.h>
+#include <memory/GAlloc.h>
+#include <structures/Interface.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Indices owned by one side of a SPSCQueue.
+ * Each side is on its own cache line.
+ */
+typedef struct {
+  // Next index this side is going to use.
+  size_t index;
+  // Last seen index of the other side.
+  // Only reloaded when this side seems to have caught up,
+  // so the other side's cache line is rarely read.
+  size_t cached;
+} SPSCSide;
+
+/*
+ * Implementation details:
+ * Indices increase forever and get masked on access,
+ * so a full queue (tail - head == capacity) can be told apart from an empty one.
+ */
+struct SPSCQueue {
+  // Written only by the consumer.
+  SPSCSide* head;
+  // Written only by the producer.
+  SPSCSide* tail;
+  // Elements, capacity of them.
+  uint8_t* slots;
+  size_t mask;
+  void* allocated;
+  const IDataType* interface;
+};
+
+/*
+ * A MPMCQueue slot is a sequence number followed by the element.
+ * The sequence tells which lap of the ring the slot is ready for:
+ * equal to the position, when it is free to be pushed at that position,
+ * one past the position, when it holds the element pushed at that position.
+ */
+typedef struct {
+  size_t sequence;
+  // The element is stored right after.
+} MPMCSlot;
+
+struct MPMCQueue {
+  // Next position to pop, on its own cache line.
+  size_t* head;
+  // Next position to push, on its own cache line.
+  size_t* tail;
+  uint8_t* slots;
+  // Bytes between slots, keeps sequences aligned.
+  size_t stride;
+  size_t mask;
+  void* allocated;
+  const IDataType* interface;
+};
+
+/*
+ * Internal functions.
+ */
+
+/**
+ * Rounds \p n up to a power of two, at least 2.
+ * Returns 0 if it does not fit in a size_t.
+ */
+static inline size_t internal_cqueue_round_pow2(size_t n) {
+  if(n > SIZE_MAX / 2 + 1) {
+    return 0;
+  }
+  size_t r = 2;
+  while(r < n) {
+    r <<= 1;
+  }
+  return r;
+}
+
+/**
+ * Allocates two cache lines for the indices followed by \p capacity slots of \p stride bytes.
+ * Returns the start of the first line, the second line starts \p alignment bytes later.
+ */
+static uint8_t* internal_cqueue_alloc(size_t alignment, size_t capacity, size_t stride, void** allocated) {
+  if(capacity == 0 || (stride != 0 && capacity > (SIZE_MAX - 3 * alignment) / stride)) {
+    *allocated = NULL;
+    return NULL;
+  }
+  *allocated = malloc(3 * alignment + capacity * stride);
+  if(*allocated == NULL) {
+    return NULL;
+  }
+  uint8_t* lines = (uint8_t*)((((uintptr_t)*allocated) + alignment - 1) / alignment * alignment);
+  memset(lines, 0, 2 * alignment);
+  return lines;
+}
+
+#define mpmc_slot(q, position) ((MPMCSlot*)((q)->slots + ((position) & (q)->mask) * (q)->stride))
+#define mpmc_slot_element(s) ((void*)((s) + 1))
+
+/*
+ * Interface | Public Api.
+ */
+
+SPSCQueue* spsc_queue_create(const IDataType* interface, size_t capacity) {
+  SPSCQueue* obj = malloc(sizeof(SPSCQueue));
+  if(obj == NULL) {
+    return NULL;
+  }
+  size_t alignment = internal_cache_line_alignment();
+  capacity = internal_cqueue_round_pow2(capacity);
+  uint8_t* lines = internal_cqueue_alloc(alignment, capacity, interface->size, &obj->allocated);
+  if(lines == NULL) {
+    EARLY_TRACE("spsc_queue_create could not allocate buffer!");
+    free(obj);
+    return NULL;
+  }
+  obj->head = (SPSCSide*)lines;
+  obj->tail = (SPSCSide*)(lines + alignment);
+  obj->slots = lines + 2 * alignment;
+  obj->mask = capacity - 1;
+  obj->interface = interface;
+  return obj;
+}
+
+size_t spsc_queue_capacity(SPSCQueue* q) {
+  return q->mask + 1;
+}
+
+size_t spsc_queue_size(SPSCQueue* q) {
+  size_t head = __atomic_load_n(&q->head->index, __ATOMIC_ACQUIRE);
+  size_t tail = __atomic_load_n(&q->tail->index, __ATOMIC_ACQUIRE);
+  return tail - head;
+}
+
+int spsc_queue_push(SPSCQueue* q, const void* data) {
+  SPSCSide* tail = q->tail;
+  size_t index = tail->index;
+  if(COLD_BRANCH(index - tail->cached > q->mask)) {
+    // Looks full, check where the consumer actually is.
+    tail->cached = __atomic_load_n(&q->head->index, __ATOMIC_ACQUIRE);
+    if(index - tail->cached > q->mask) {
+      return 1;
+    }
+  }
+  memcpy(dti_element(q->interface, q->slots, index & q->mask), data, q->interface->size);
+  // Publish the element.
+  __atomic_store_n(&tail->index, index + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int spsc_queue_pop(SPSCQueue* q, void* data) {
+  SPSCSide* head = q->head;
+  size_t index = head->index;
+  if(COLD_BRANCH(index == head->cached)) {
+    // Looks empty, check where the producer actually is.
+    head->cached = __atomic_load_n(&q->tail->index, __ATOMIC_ACQUIRE);
+    if(index == head->cached) {
+      return 1;
+    }
+  }
+  memcpy(data, dti_element(q->interface, q->slots, index & q->mask), q->interface->size);
+  // Hand the slot back to the producer.
+  __atomic_store_n(&head->index, index + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+void spsc_queue_destroy(SPSCQueue* q) {
+  free(q->allocated);
+  free(q);
+}
+
+MPMCQueue* mpmc_queue_create(const IDataType* interface, size_t capacity) {
+  MPMCQueue* obj = malloc(sizeof(MPMCQueue));
+  if(obj == NULL) {
+    return NULL;
+  }
+  size_t alignment = internal_cache_line_alignment();
+  capacity = internal_cqueue_round_pow2(capacity);
+  obj->stride = (sizeof(MPMCSlot) + interface->size + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+  uint8_t* lines = internal_cqueue_alloc(alignment, capacity, obj->stride, &obj->allocated);
+  if(lines == NULL) {
+    EARLY_TRACE("mpmc_queue_create could not allocate buffer!");
+    free(obj);
+    return NULL;
+  }
+  obj->head = (size_t*)lines;
+  obj->tail = (size_t*)(lines + alignment);
+  obj->slots = lines + 2 * alignment;
+  obj->mask = capacity - 1;
+  obj->interface = interface;
+  for(size_t i = 0; i < capacity; i++) {
+    mpmc_slot(obj, i)->sequence = i;
+  }
+  return obj;
+}
+
+size_t mpmc_queue_capacity(MPMCQueue* q) {
+  return q->mask + 1;
+}
+
+size_t mpmc_queue_size(MPMCQueue* q) {
+  size_t head = __atomic_load_n(q->head, __ATOMIC_ACQUIRE);
+  size_t tail = __atomic_load_n(q->tail, __ATOMIC_ACQUIRE);
+  // Racing pops may move head past the tail read before it.
+  return tail > head ? tail - head : 0;
+}
+
+int mpmc_queue_push(MPMCQueue* q, const void* data) {
+  size_t position = __atomic_load_n(q->tail, __ATOMIC_RELAXED);
+  MPMCSlot* slot;
+  while(1) {
+    slot = mpmc_slot(q, position);
+    size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+    if(diff == 0) {
+      // Slot is free, try to claim the position.
+      if(__atomic_compare_exchange_n(q->tail, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+      // Failed exchange reloaded position.
+    }
+    else if(diff < 0) {
+      // Slot still holds the element from the previous lap.
+      return 1;
+    }
+    else {
+      // Another producer got this position.
+      position = __atomic_load_n(q->tail, __ATOMIC_RELAXED);
+    }
+  }
+  memcpy(mpmc_slot_element(slot), data, q->interface->size);
+  // Publish the element.
+  __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int mpmc_queue_pop(MPMCQueue* q, void* data) {
+  size_t position = __atomic_load_n(q->head, __ATOMIC_RELAXED);
+  MPMCSlot* slot;
+  while(1) {
+    slot = mpmc_slot(q, position);
+    size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    intptr_t diff = (intptr_t)sequence - (intptr_t)(position + 1);
+    if(diff == 0) {
+      // Slot is full, try to claim the position.
+      if(__atomic_compare_exchange_n(q->head, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+    else if(diff < 0) {
+      // Nothing has been pushed at this position yet.
+      return 1;
+    }
+    else {
+      // Another consumer got this position.
+      position = __atomic_load_n(q->head, __ATOMIC_RELAXED);
+    }
+  }
+  memcpy(data, mpmc_slot_element(slot), q->interface->size);
+  // Free the slot for the next lap.
+  __atomic_store_n(&slot->sequence, position + q->mask + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+void mpmc_queue_destroy(MPMCQueue* q) {
+  free(q->allocated);
+  free(q);
+}
@@ -0,0 +1,146 @@
+#ifndef SSCE_CQUEUE_H
+#define SSCE_CQUEUE_H
+/**
+ * @file
+ * @brief Bounded queues which can be shared between threads.
+ *
+ * Both queues are lock free ring buffers of fixed type elements,
+ * which are copied in and out of the buffer.
+ * The capacity is always a power of two and it never grows.
+ *
+ * The indices written by producers and consumers are kept on separate cache lines,
+ * so that the two sides do not invalidate each other's cache when they are not
+ * touching the same elements.
+ */
+
+#include <Interface.h>
+#include <Macros.h>
+
+#include <stddef.h>
+
+/**
+ * Opaque structure containing internal data.
+ * Single producer, single consumer queue.
+ */
+struct SPSCQueue;
+typedef struct SPSCQueue SPSCQueue;
+
+/**
+ * Opaque structure containing internal data.
+ * Multiple producer, multiple consumer queue.
+ */
+struct MPMCQueue;
+typedef struct MPMCQueue MPMCQueue;
+
+/**
+ * Allocates a new SPSCQueue object.
+ * Only one thread may push and only one thread may pop at the same time.
+ *
+ * @param interface \ref interface.
+ * @param capacity the least amount of elements the queue can hold.
+ * @returns the allocated SPSCQueue or NULL if there was not enough memory available.
+ */
+EXPORT_API MARK_OBJ_ALLOC SPSCQueue* spsc_queue_create(const IDataType* interface, size_t capacity) MARK_NONNULL_ARGS(1);
+
+/**
+ * Gets the number of elements the queue can hold.
+ *
+ * @param q \ref spsc_queue_create.
+ * @returns capacity.
+ */
+EXPORT_API size_t spsc_queue_capacity(SPSCQueue* q) MARK_NONNULL_ARGS(1);
+
+/**
+ * Gets the number of currently stored elements.
+ * If other threads are using the queue, the result may already be out of date.
+ *
+ * @param q \ref spsc_queue_create.
+ * @returns element count.
+ */
+EXPORT_API size_t spsc_queue_size(SPSCQueue* q) MARK_NONNULL_ARGS(1);
+
+/**
+ * Adds a copy of \p data at the end of the queue.
+ * Must only be called by the producer thread.
+ *
+ * @param q \ref spsc_queue_create.
+ * @param data pointer to the value to add.
+ * @returns non zero if the queue is full.
+ */
+EXPORT_API int spsc_queue_push(SPSCQueue* q, const void* data) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Retrieves and removes the element at the start of the queue.
+ * Must only be called by the consumer thread.
+ *
+ * @param q \ref spsc_queue_create.
+ * @param data where the element will be placed.
+ * @returns non zero if the queue is empty.
+ */
+EXPORT_API int spsc_queue_pop(SPSCQueue* q, void* data) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Frees all memory used by the queue.
+ * No other thread may be using it.
+ *
+ * @param q \ref spsc_queue_create.
+ */
+EXPORT_API void spsc_queue_destroy(SPSCQueue* q) MARK_NONNULL_ARGS(1);
+
+/**
+ * Allocates a new MPMCQueue object.
+ * Any thread may push or pop.
+ *
+ * @param interface \ref interface.
+ * @param capacity the least amount of elements the queue can hold.
+ * @returns the allocated MPMCQueue or NULL if there was not enough memory available.
+ */
+EXPORT_API MARK_OBJ_ALLOC MPMCQueue* mpmc_queue_create(const IDataType* interface, size_t capacity) MARK_NONNULL_ARGS(1);
+
+/**
+ * Gets the number of elements the queue can hold.
+ *
+ * @param q \ref mpmc_queue_create.
+ * @returns capacity.
+ */
+EXPORT_API size_t mpmc_queue_capacity(MPMCQueue* q) MARK_NONNULL_ARGS(1);
+
+/**
+ * Gets the number of currently stored elements,
+ * including elements which are still getting copied in or out.
+ * If other threads are using the queue, the result may already be out of date.
+ *
+ * @param q \ref mpmc_queue_create.
+ * @returns element count.
+ */
+EXPORT_API size_t mpmc_queue_size(MPMCQueue* q) MARK_NONNULL_ARGS(1);
+
+/**
+ * Adds a copy of \p data at the end of the queue.
+ * Thread safe and lock free.
+ *
+ * @param q \ref mpmc_queue_create.
+ * @param data pointer to the value to add.
+ * @returns non zero if the queue is full.
+ */
+EXPORT_API int mpmc_queue_push(MPMCQueue* q, const void* data) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Retrieves and removes the element at the start of the queue.
+ * Thread safe and lock free.
+ *
+ * @param q \ref mpmc_queue_create.
+ * @param data where the element will be placed.
+ * @returns non zero if the queue is empty.
+ */
+EXPORT_API int mpmc_queue_pop(MPMCQueue* q, void* data) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Frees all memory used by the queue.
+ * No other thread may be using it.
+ *
+ * @param q \ref mpmc_queue_create.
+ */
+EXPORT_API void mpmc_queue_destroy(MPMCQueue* q) MARK_NONNULL_ARGS(1);
+
+#endif /*SSCE_CQUEUE_H*/
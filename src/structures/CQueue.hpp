@@ -0,0 +1,20 @@
+#ifndef SSCE_CQUEUE_HPP
+#define SSCE_CQUEUE_HPP
+/**
+ * @file
+ * @brief Bounded queues which can be shared between threads.
+ */
+
+#include <Macros.h>
+C_DECLS_START
+#include <CQueue.h>
+C_DECLS_END
+
+#include <Interface.hpp>
+
+namespace ssce {
+
+// TODO:
+
+} // namespace ssce
+#endif /*SSCE_CQUEUE_HPP*/
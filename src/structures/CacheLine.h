@@ -0,0 +1,24 @@
+#ifndef SSCE_CACHE_LINE_H
+#define SSCE_CACHE_LINE_H
+/**
+* @file
+* @brief Common code for keeping data of different threads on separate cache lines.
+*/
+
+#include <Macros.h>
+#include <Runtime.h>
+
+#include <stddef.h>
+
+/**
+ * Internal usage only.
+ * Cache line size to pad shared data to.
+ * The runtime may report 0 or less than a real line,
+ * so at least 64 bytes are used, which also fits a few words per line.
+ */
+static inline size_t internal_cache_line_alignment() {
+  size_t alignment = ssce_get_runtime()->cpu_cache_alignment;
+  return alignment < 64 ? 64 : alignment;
+}
+
+#endif /*SSCE_CACHE_LINE_H*/
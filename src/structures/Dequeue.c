@@ -6,30 +6,25 @@
 
 #include <string.h>
 
-struct Node;
-typedef struct Node Node;
-
-struct Node {
-  // Previous node.
-  Node* previous;
-  // Next node.
-  Node* next;
-  // Stored data is after this point.
-  // https://en.wikipedia.org/wiki/Flexible_array_member
-  void* data[];
-};
+/*
+ * Capacity of the first allocated buffer, in elements.
+ */
+#define MIN_CAPACITY 16
 
 /*
  * Implementation node:
- * If you start from head and follow the previous Node, you will eventually reach the tail.
- * If you start from tail and follow the next Node, you will eventually reach the head.
- * If the dequeue has a single element, then both the head and tail are guaranteed to point the same node.
+ * Elements are stored in a circular buffer, whose capacity is always a power of 2.
+ * The head is at index start and the tail at index (start + length - 1), modulo capacity.
+ * If the buffer is full, it is doubled and the part that wrapped around is moved after the old end,
+ * so that pushing is amortized constant time and popping never allocates.
  */
 struct Dequeue {
-  // Start of linked list.
-  Node* head;
-  // End of linked list.
-  Node* tail;
+  // Circular buffer, null if nothing has been allocated.
+  char* buffer;
+  // Size of buffer in elements.
+  size_t capacity;
+  // Index of the head.
+  size_t start;
   // Currently stored items.
   size_t length;
   // Data type definition.
@@ -40,29 +35,63 @@ struct Dequeue {
  * Internal functions.
  */
 
-static inline void internal_free_node(Node* node) {
-  free(node);
+static inline char* internal_slot(Dequeue* dq, size_t index) {
+  return dti_element(dq->interface, dq->buffer, index & (dq->capacity - 1));
 }
 
-static inline void internal_free_nodes(Node* node) {
-  do {
-    Node* next_node = node->previous;
-    internal_free_node(node);
-    node = next_node;
-  } while(node != NULL);
+static inline void internal_copy_slot_data(Dequeue* dq, size_t index, void* dest) {
+  memcpy(dest, internal_slot(dq, index), dq->interface->size);
 }
 
-static inline void internal_copy_node_data(const IDataType* dti, const Node* node, void* dest) {
-  memcpy(dest, node->data, dti->size);
+/**
+ * Copies \p count elements from \p src to the slots starting at \p index.
+ * At most two copies, as the range may wrap around the end of the buffer.
+ */
+static inline void internal_copy_in(Dequeue* dq, size_t index, const void* src, size_t count) {
+  size_t es = dq->interface->size;
+  size_t first = index & (dq->capacity - 1);
+  size_t until_end = dq->capacity - first;
+  size_t head = count < until_end ? count : until_end;
+  memcpy(dq->buffer + first * es, src, head * es);
+  memcpy(dq->buffer, (const char*)src + head * es, (count - head) * es);
 }
 
-static inline Node* internal_prepare_node(const IDataType* dti, const void* data) {
-  Node* new = malloc(sizeof(Node) + dti->size);
-  if(new == NULL) {
-    return NULL;
+/**
+ * Copies \p count elements from the slots starting at \p index to \p dest.
+ */
+static inline void internal_copy_out(Dequeue* dq, size_t index, void* dest, size_t count) {
+  size_t es = dq->interface->size;
+  size_t first = index & (dq->capacity - 1);
+  size_t until_end = dq->capacity - first;
+  size_t head = count < until_end ? count : until_end;
+  memcpy(dest, dq->buffer + first * es, head * es);
+  memcpy((char*)dest + head * es, dq->buffer, (count - head) * es);
+}
+
+/**
+ * Makes space for \p count more elements.
+ */
+static inline int internal_reserve(Dequeue* dq, size_t count) {
+  if(HOT_BRANCH(dq->length + count <= dq->capacity)) {
+    return 0;
   }
-  memcpy(new->data, data, dti->size);
-  return new;
+  size_t es = dq->interface->size;
+  size_t old_capacity = dq->capacity;
+  size_t new_capacity = old_capacity != 0 ? old_capacity * 2 : MIN_CAPACITY;
+  while(new_capacity < dq->length + count) {
+    new_capacity *= 2;
+  }
+  char* new_buffer = realloc(dq->buffer, new_capacity * es);
+  if(new_buffer == NULL) {
+    EARLY_TRACE("dequeue could not grow buffer!");
+    return 1;
+  }
+  // Unwrap: elements before start belong after the old end.
+  size_t wrapped = dq->start + dq->length > old_capacity ? dq->start + dq->length - old_capacity : 0;
+  memcpy(new_buffer + old_capacity * es, new_buffer, wrapped * es);
+  dq->buffer = new_buffer;
+  dq->capacity = new_capacity;
+  return 0;
 }
 
 /*
@@ -72,8 +101,9 @@ static inline Node* internal_prepare_node(const IDataType* dti, const void* data
 Dequeue* dequeue_create(const IDataType* dti) {
   Dequeue* obj = malloc(sizeof(Dequeue));
   if(obj != NULL) {
-    obj->head = NULL;
-    obj->tail = NULL;
+    obj->buffer = NULL;
+    obj->capacity = 0;
+    obj->start = 0;
     obj->length = 0;
     obj->interface = dti;
   }
@@ -85,76 +115,57 @@ size_t dequeue_size(Dequeue* dq) {
 }
 
 int dequeue_push_back(Dequeue* dq, const void* data) {
-  Node* new = internal_prepare_node(dq->interface, data);
-  if(new == NULL) {
+  if(COLD_BRANCH(internal_reserve(dq, 1))) {
     return 1;
   }
-  size_t len = dq->length;
-  if(COLD_BRANCH(len == 0)) {
-    // Nothing in the linked list.
-    new->next = NULL;
-    new->previous = NULL;
-    dq->head = new;
-    dq->tail = new;
-  }
-  else {
-    // Normal case. Make node new tail.
-    new->previous = NULL;
-    new->next = dq->tail;
-    dq->tail->previous = new;
-    dq->tail = new;
-  }
+  memcpy(internal_slot(dq, dq->start + dq->length), data, dq->interface->size);
   dq->length++;
   return 0;
 }
 
 int dequeue_push_front(Dequeue* dq, const void* data) {
-  Node* new = internal_prepare_node(dq->interface, data);
-  if(new == NULL) {
+  if(COLD_BRANCH(internal_reserve(dq, 1))) {
+    return 1;
+  }
+  dq->start = (dq->start - 1) & (dq->capacity - 1);
+  memcpy(internal_slot(dq, dq->start), data, dq->interface->size);
+  dq->length++;
+  return 0;
+}
+
+int dequeue_push_back_many(Dequeue* dq, const void* array, size_t count) {
+  if(COLD_BRANCH(internal_reserve(dq, count))) {
     return 1;
   }
-  size_t len = dq->length;
-  if(COLD_BRANCH(len == 0)) {
-    // Nothing in the linked list.
-    new->next = NULL;
-    new->previous = NULL;
-    dq->head = new;
-    dq->tail = new;
+  if(COLD_BRANCH(count == 0)) {
+    // Capacity may still be 0.
+    return 0;
   }
-  else {
-    // Normal case. Make node new head.
-    new->previous = dq->head;
-    new->next = NULL;
-    dq->head->next = new;
-    dq->head = new;
+  internal_copy_in(dq, dq->start + dq->length, array, count);
+  dq->length += count;
+  return 0;
+}
+
+int dequeue_push_front_many(Dequeue* dq, const void* array, size_t count) {
+  if(COLD_BRANCH(internal_reserve(dq, count))) {
+    return 1;
   }
-  dq->length++;
+  if(COLD_BRANCH(count == 0)) {
+    // Capacity may still be 0.
+    return 0;
+  }
+  dq->start = (dq->start - count) & (dq->capacity - 1);
+  internal_copy_in(dq, dq->start, array, count);
+  dq->length += count;
   return 0;
 }
 
 int dequeue_pop_back(Dequeue* dq, void* data) {
   if(HOT_BRANCH(dq->length != 0)) {
-    // The length this data structure will have.
-    size_t len = dq->length - 1;
-    // First return data from node to be removed.
+    dq->length--;
     if(HOT_BRANCH(data != NULL)) {
-      internal_copy_node_data(dq->interface, dq->tail, data);
-    }
-    if(COLD_BRANCH(len == 0)) {
-      // Dequeue after this will be empty.
-      internal_free_node(dq->tail);
-      dq->head = NULL;
-      dq->tail = NULL;
+      internal_copy_slot_data(dq, dq->start + dq->length, data);
     }
-    else {
-      // Remove node at tail and update links.
-      Node* old_node = dq->tail;
-      dq->tail = old_node->next;
-      dq->tail->previous = NULL;
-      internal_free_node(old_node);
-    }
-    // Save new length.
-    dq->length = len;
     return 0;
   }
   else {
@@ -164,27 +175,11 @@ int dequeue_pop_back(Dequeue* dq, void* data) {
 
 int dequeue_pop_front(Dequeue* dq, void* data) {
   if(HOT_BRANCH(dq->length != 0)) {
-    // The length this data structure will have.
-    size_t len = dq->length - 1;
-    // First return data from node to be removed.
     if(HOT_BRANCH(data != NULL)) {
-      internal_copy_node_data(dq->interface, dq->head, data);
-    }
-    if(COLD_BRANCH(len == 0)) {
-      // Dequeue after this will be empty.
-      internal_free_node(dq->head);
-      dq->head = NULL;
-      dq->tail = NULL;
-    }
-    else {
-      // Remove node at tail and update links.
-      Node* old_node = dq->head;
-      dq->head = old_node->previous;
-      dq->head->next = NULL;
-      internal_free_node(old_node);
+      internal_copy_slot_data(dq, dq->start, data);
     }
-    // Save new length.
-    dq->length = len;
+    dq->start = (dq->start + 1) & (dq->capacity - 1);
+    dq->length--;
     return 0;
   }
   else {
@@ -192,9 +187,22 @@ int dequeue_pop_front(Dequeue* dq, void* data) {
   }
 }
 
+size_t dequeue_pop_front_many(Dequeue* dq, void* array, size_t count) {
+  size_t n = count < dq->length ? count : dq->length;
+  if(COLD_BRANCH(n == 0)) {
+    return 0;
+  }
+  if(HOT_BRANCH(array != NULL)) {
+    internal_copy_out(dq, dq->start, array, n);
+  }
+  dq->start = (dq->start + n) & (dq->capacity - 1);
+  dq->length -= n;
+  return n;
+}
+
 int dequeue_peek_back(Dequeue* dq, void* data) {
   if(HOT_BRANCH(dq->length != 0)) {
-    internal_copy_node_data(dq->interface, dq->tail, data);
+    internal_copy_slot_data(dq, dq->start + dq->length - 1, data);
     return 0;
   }
   else {
@@ -204,7 +212,7 @@ int dequeue_peek_back(Dequeue* dq, void* data) {
 
 int dequeue_peek_front(Dequeue* dq, void* data) {
   if(HOT_BRANCH(dq->length != 0)) {
-    internal_copy_node_data(dq->interface, dq->head, data);
+    internal_copy_slot_data(dq, dq->start, data);
     return 0;
   }
   else {
@@ -213,15 +221,14 @@ int dequeue_peek_front(Dequeue* dq, void* data) {
 }
 
 void dequeue_reset(Dequeue* dq) {
-  if(dq->length != 0) {
-    internal_free_nodes(dq->head);
-    dq->head = NULL;
-    dq->tail = NULL;
-    dq->length = 0;
-  }
+  free(dq->buffer);
+  dq->buffer = NULL;
+  dq->capacity = 0;
+  dq->start = 0;
+  dq->length = 0;
 }
 
 void dequeue_destroy(Dequeue* dq) {
   dequeue_reset(dq);
   free(dq);
-}
\ No newline at end of file
+}
@@ -2,7 +2,8 @@
 #define SSCE_DEQUEUE_H
 /**
  * @file
- * @brief Double ended linked list of fixed type elements.
+ * @brief Double ended queue of fixed type elements,
+ * stored in a growable circular buffer.
  */
 
 #include <Macros.h>
@@ -25,7 +26,7 @@ typedef struct Dequeue Dequeue;
 EXPORT_API MARK_OBJ_ALLOC Dequeue* dequeue_create(const IDataType* dti) MARK_NONNULL_ARGS(1);
 
 /**
- * Returns the number of currently stored nodes.
+ * Returns the number of currently stored elements.
  * 
  * @param dq see \ref dequeue_create.
  * @returns the length of \p dq.
@@ -33,7 +34,7 @@ EXPORT_API MARK_OBJ_ALLOC Dequeue* dequeue_create(const IDataType* dti) MARK_NON
 EXPORT_API size_t dequeue_size(Dequeue* dq) MARK_NONNULL_ARGS(1);
 
 /**
- * Inserts a new node at the end of the list.
+ * Inserts a new element at the end of the queue.
  * 
  * @param dq see \ref dequeue_create.
  * @param data pointer to value to be added.
@@ -42,7 +43,7 @@ EXPORT_API size_t dequeue_size(Dequeue* dq) MARK_NONNULL_ARGS(1);
 EXPORT_API int dequeue_push_back(Dequeue* dq, const void* data) MARK_NONNULL_ARGS(1, 2);
 
 /**
- * Inserts a new node at the start of the list.
+ * Inserts a new element at the start of the queue.
  * 
  * @param dq see \ref dequeue_create.
  * @param data pointer to value to be added.
@@ -51,44 +52,80 @@ EXPORT_API int dequeue_push_back(Dequeue* dq, const void* data) MARK_NONNULL_ARG
 EXPORT_API int dequeue_push_front(Dequeue* dq, const void* data) MARK_NONNULL_ARGS(1, 2);
 
 /**
- * Retrieves and removes the node at the end of the list.
+ * Inserts \p count elements at the end of the queue.
+ * Same as calling \ref dequeue_push_back for each element in order,
+ * but space is made only once and elements are copied in bulk.
  * 
  * @param dq see \ref dequeue_create.
- * @param data where the node's data will be placed. May be null.
+ * @param array pointer to the first of the elements to be added.
+ * @param count how many elements to add.
+ * @returns non zero on error, in which case nothing is added.
+ */
+EXPORT_API int dequeue_push_back_many(Dequeue* dq, const void* array, size_t count) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Inserts \p count elements at the start of the queue.
+ * The elements keep their order, so the first element of \p array becomes the new start.
+ * That is the reverse of calling \ref dequeue_push_front for each element in order.
+ * 
+ * @param dq see \ref dequeue_create.
+ * @param array pointer to the first of the elements to be added.
+ * @param count how many elements to add.
+ * @returns non zero on error, in which case nothing is added.
+ */
+EXPORT_API int dequeue_push_front_many(Dequeue* dq, const void* array, size_t count) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Retrieves and removes the element at the end of the queue.
+ * 
+ * @param dq see \ref dequeue_create.
+ * @param data where the element will be placed. May be null.
  * @returns non zero on error.
  */
 EXPORT_API int dequeue_pop_back(Dequeue* dq, void* data) MARK_NONNULL_ARGS(1);
 
 /**
- * Retrieves and removes the node at the start of the list.
+ * Retrieves and removes the element at the start of the queue.
  * 
  * @param dq see \ref dequeue_create.
- * @param data where the node's data will be placed. May be null.
+ * @param data where the element will be placed. May be null.
  * @returns non zero on error.
  */
 EXPORT_API int dequeue_pop_front(Dequeue* dq, void* data) MARK_NONNULL_ARGS(1);
 
 /**
- * Retrieves the node at the end of the list.
+ * Retrieves and removes up to \p count elements from the start of the queue.
+ * Same as calling \ref dequeue_pop_front until \p count elements are retrieved
+ * or the queue is empty.
+ * 
+ * @param dq see \ref dequeue_create.
+ * @param array where the elements will be placed, in order. May be null.
+ * @param count the most elements to retrieve.
+ * @returns how many elements were retrieved.
+ */
+EXPORT_API size_t dequeue_pop_front_many(Dequeue* dq, void* array, size_t count) MARK_NONNULL_ARGS(1);
+
+/**
+ * Retrieves the element at the end of the queue.
  * 
  * @param dq see \ref dequeue_create.
- * @param data where the node's data will be placed.
+ * @param data where the element will be placed.
  * @returns non zero on error.
  */
 EXPORT_API int dequeue_peek_back(Dequeue* dq, void* data) MARK_NONNULL_ARGS(1, 2);
 
 /**
- * Retrieves the node at the start of the list.
+ * Retrieves the element at the start of the queue.
  * 
  * @param dq see \ref dequeue_create.
- * @param data where the node's data will be placed.
+ * @param data where the element will be placed.
  * @returns non zero on error.
  */
 EXPORT_API int dequeue_peek_front(Dequeue* dq, void* data) MARK_NONNULL_ARGS(1, 2);
 
 /**
  * Empties out a dequeue,
- * while freeing allocated memory by the links.
+ * while freeing its buffer.
  * 
  * @param dq see \ref dequeue_create.
  */
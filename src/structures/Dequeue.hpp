@@ -2,7 +2,7 @@
 #define SSCE_DEQUEUE_HPP
 /**
  * @file
- * @brief Double ended linked list of fixed type elements.
+ * @brief Double ended queue of fixed type elements.
  */
 
 #include <Macros.h>
@@ -1,14 +1,18 @@
 #include "HashSet.h"
+#include "HashSetGroup.h"
 
 #include <Config.h>
 #include <Macros.h>
+#include <Modules.h>
 #include <memory/GAlloc.h>
+#include <structures/Bitfield.h>
 #include <structures/Interface.h>
 
-#ifndef NDEBUG
+#ifdef MODULE_CLOCK
   #include <clock/Clock.h>
 #endif
 
+#include <limits.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -27,34 +31,81 @@ typedef struct {
   void* bucket;
   // How many elements are currently stored in the bucket.
   size_t length;
+  // Cached hash of each element, or NULL if hashes are not cached.
+  size_t* hashes;
 } Bucket;
 
 struct HashSet {
-  // An array of buckets.
+  // An array of buckets(bucket engine only).
   Bucket* array;
-  // How many buckets are currently allocated.
+  // Buckets of an in progress incremental resize(bucket engine only).
+  Bucket* old_array;
+  // How many buckets the old array has.
+  size_t old_size;
+  // Old buckets before this index have already been moved.
+  size_t migrated;
+  // Control bytes, one for each slot(open addressing engine only).
+  uint8_t* ctrl;
+  // Inline element storage(open addressing engine only).
+  void* slots;
+  // Cached hash of each slot(open addressing engine with cached hashes only).
+  size_t* hashes;
+  // How many buckets or slots are currently allocated.
   size_t size;
   // Count of currently stored elements.
   size_t length;
+  // Count of slots marked as deleted(open addressing engine only).
+  size_t deleted;
   // Minimal amount of allocated buckets.
   size_t min_size;
   // When length/size<shrink, then the number of allocated buckets is decreased.
   float shrink;
   // When length/size>expand, then the number of allocated buckets is increased.
   float expand;
+  // Selected engine and options.
+  unsigned int flags;
+  // How many times the table has been rebuilt.
+  size_t resize_count;
+  // Total time spent moving elements between tables in ms.
+  double rehash_time;
+  // Stored keys while in dense mode, otherwise the backing data is NULL.
+  Bitfield dense;
+  // Copy of the element last returned in dense mode.
+  uint64_t dense_element;
+  // Control byte group matching implementation(open addressing engine only).
+  const HashSetGroup* group;
   // Data type definition.
   const IDataType* interface;
 };
 
-static inline SizeBool internal_bucket_find(const IDataType* dti, void* a, size_t n, const void* k) {
+/**
+ * Binary search in a bucket.
+ * Buckets with cached hashes are sorted by hash first, and then by key,
+ * so keys only get compared when their hashes are equal.
+ */
+static inline SizeBool internal_bucket_find(const IDataType* dti, const Bucket* b, const void* k, size_t hash) {
+  size_t n = b->length;
   if(n == 0) {
     // Avoid unsigned underflow.
     return (SizeBool){0, 0};
   }
+  void* a = b->bucket;
+  const size_t* hashes = b->hashes;
   size_t start = 0;
   size_t end_inc = n;
   while(start < end_inc) {
     size_t middle = start + (end_inc - start) / 2;
+    if(hashes != NULL && hashes[middle] != hash) {
+      if(hashes[middle] < hash) {
+        // Right
+        start = middle + 1;
+      }
+      else {
+        // Left
+        end_inc = middle;
+      }
+      continue;
+    }
     void* middle_address = dti_item(dti, a, middle);
     if(dti->cmp_eq(dti, middle_address, k)) {
       // Hit
@@ -72,7 +123,7 @@ static inline SizeBool internal_bucket_find(const IDataType* dti, void* a, size_
   return (SizeBool){start, 0};
 }
 
-static inline int internal_bucket_insert(const IDataType* dti, Bucket* b, const void* v, size_t i) {
+static inline int internal_bucket_insert(const IDataType* dti, Bucket* b, const void* v, size_t i, size_t hash, int cache) {
   // Make space, and then copy value at index.
   if(b->length == 0) {
     // No memory is allocated.
@@ -82,6 +133,16 @@ static inline int internal_bucket_insert(const IDataType* dti, Bucket* b, const
       EARLY_TRACE("internal_bucket_insert could not allocate new bucket!");
       return 0;
     }
+    if(cache) {
+      b->hashes = malloc(sizeof(size_t));
+      if(b->hashes == NULL) {
+        EARLY_TRACE("internal_bucket_insert could not allocate new bucket!");
+        free(b->bucket);
+        b->bucket = NULL;
+        return 0;
+      }
+      b->hashes[0] = hash;
+    }
     memcpy(b->bucket, v, dti->size);
     // Everything was good. Finalize changes.
     b->length++;
@@ -103,6 +164,17 @@ static inline int internal_bucket_insert(const IDataType* dti, Bucket* b, const
       // Realloc moved allocation.
       b->bucket = new_bucket;
     }
+    if(cache) {
+      // A bigger element block is harmless, so there is nothing to rollback on failure.
+      size_t* new_hashes = realloc(b->hashes, sizeof(size_t) * (b->length + 1));
+      if(new_hashes == NULL) {
+        EARLY_TRACE("internal_bucket_insert could not reallocate memory block!");
+        return 0;
+      }
+      b->hashes = new_hashes;
+      memmove(b->hashes + i + 1, b->hashes + i, sizeof(size_t) * (b->length - i));
+      b->hashes[i] = hash;
+    }
     // Make space by moving index to end.
     void* dest = dti_element(dti, b->bucket, i);
     memmove(dti_next(dti, dest), dest, dti->size * (b->length - i));
@@ -119,11 +191,16 @@ static inline void internal_bucket_remove(const IDataType* dti, Bucket* b, size_
   void* after_address = dti_next(dti, index_address);
   size_t bytes = dti->size * (b->length - index - 1);
   memmove(index_address, after_address, bytes);
+  if(b->hashes != NULL) {
+    memmove(b->hashes + index, b->hashes + index + 1, sizeof(size_t) * (b->length - index - 1));
+  }
   // Shrink allocated memory block.
   b->length--;
   if(b->length == 0) {
     free(b->bucket);
+    free(b->hashes);
     b->bucket = NULL;
+    b->hashes = NULL;
   }
   else {
     void* new_allocated = realloc(b->bucket, dti->size * b->length);
@@ -133,12 +210,29 @@ static inline void internal_bucket_remove(const IDataType* dti, Bucket* b, size_
     else if(new_allocated != b->bucket) {
       b->bucket = new_allocated;
     }
+    if(b->hashes != NULL) {
+      size_t* new_hashes = realloc(b->hashes, sizeof(size_t) * b->length);
+      if(new_hashes != NULL) {
+        b->hashes = new_hashes;
+      }
+    }
   }
 }
 
 static inline void internal_bucket_destroy(Bucket* b) {
   // Free accepts NULL pointers.
   free(b->bucket);
+  free(b->hashes);
+}
+
+/**
+ * Frees a bucket's memory and leaves it empty, so it can be destroyed again.
+ */
+static inline void internal_bucket_reset(Bucket* b) {
+  internal_bucket_destroy(b);
+  b->bucket = NULL;
+  b->length = 0;
+  b->hashes = NULL;
 }
 
 static inline void internal_buckets_destroy(Bucket b[], size_t n) {
@@ -148,45 +242,212 @@ static inline void internal_buckets_destroy(Bucket b[], size_t n) {
   }
 }
 
-static inline size_t internal_hash_calc_index(const IDataType* dti, size_t max_index, const void* key) {
-  return dti->hash(dti, key) % max_index;
+static inline size_t internal_round_pow2(size_t n) {
+  size_t p = 1;
+  while(p < n) {
+    p <<= 1;
+  }
+  return p;
 }
 
-static int internal_hash_resize_reloc(const IDataType* dti, Bucket* old_buckets, size_t old_size, Bucket* new_buckets, size_t new_size) {
-  #ifndef NDEBUG
-    PerfClock pc;
-    clock_reset(&pc);
-    clock_start(&pc);
+/**
+ * Scrambles weak user hashes(like identity hashes of integers),
+ * so that both the low and the high bits depend on every input bit.
+ * Fibonacci hashing followed by folding the high half into the low half.
+ */
+static inline size_t internal_hash_mix(size_t h) {
+  #if SIZE_MAX > UINT32_MAX
+    h *= UINT64_C(0x9e3779b97f4a7c15);
+    return h ^ (h >> 32);
+  #else
+    h *= UINT32_C(0x9e3779b9);
+    return h ^ (h >> 16);
   #endif
-  // Iterate over all old buckets.
-  for(size_t i = 0; i < old_size; i++) {
-    Bucket* old_current_bucket = old_buckets + i;
-    size_t old_current_bucket_length = old_current_bucket->length;
-    // Each element of the old buckets gets inserted into the new buckets.
-    for(size_t j = 0; j < old_current_bucket_length; j++) {
-      const void* old_elem = dti_element(dti, old_current_bucket->bucket, j);
-      const void* old_key = add_offset(old_elem, dti->offset);
-      // Calculate destination bucket.
-      size_t new_current_bucket_index = internal_hash_calc_index(dti, new_size, old_key);
-      Bucket* new_current_bucket = new_buckets + new_current_bucket_index;
-      // Calculate where element is going to be inserted inside the new bucket.
-      size_t new_elem_index = internal_bucket_find(dti, new_current_bucket->bucket, new_current_bucket->length, old_key).size;
-      if(!internal_bucket_insert(dti, new_current_bucket, old_elem, new_elem_index)) {
-        EARLY_TRACEF("internal_hash_resize_reloc failure!");
-        // Rollback.
-        internal_buckets_destroy(new_buckets, new_size);
-        return 0;
+}
+
+/**
+ * Calls the user's hash function and applies
+ * \ref HASHSET_MIX_HASH if it is enabled.
+ */
+static inline size_t internal_hash_key(const IDataType* dti, unsigned int flags, const void* key) {
+  size_t h = dti->hash(dti, key);
+  if(flags & HASHSET_MIX_HASH) {
+    h = internal_hash_mix(h);
+  }
+  return h;
+}
+
+/**
+ * Maps \p hash to a bucket index in [0, \p size).
+ * Power of two bucket counts use a mask. Otherwise, mixed hashes
+ * use fast range(multiply and keep the high half), as their high bits are good.
+ * Only unmixed hashes of arbitrary bucket counts need a division.
+ */
+static inline size_t internal_hash_index(unsigned int flags, size_t hash, size_t size) {
+  if(flags & HASHSET_POW2) {
+    return hash & (size - 1);
+  }
+  if(flags & HASHSET_MIX_HASH) {
+    #if SIZE_MAX > UINT32_MAX && defined(INT128_SUPPORTED)
+      return (size_t)(((uint128_t)hash * (uint128_t)size) >> 64);
+    #elif SIZE_MAX <= UINT32_MAX
+      return (size_t)(((uint64_t)hash * (uint64_t)size) >> 32);
+    #endif
+  }
+  return hash % size;
+}
+
+/**
+ * Finds the bucket \p hash belongs to.
+ * While a migration is in progress, buckets which
+ * have not been moved yet are still used from the old array.
+ */
+static inline Bucket* internal_hash_bucket(const HashSet* hs, size_t hash) {
+  if(COLD_BRANCH(hs->old_array != NULL)) {
+    size_t old_index = internal_hash_index(hs->flags, hash, hs->old_size);
+    if(old_index >= hs->migrated) {
+      return hs->old_array + old_index;
+    }
+  }
+  return hs->array + internal_hash_index(hs->flags, hash, hs->size);
+}
+
+static inline size_t internal_bucket_hash(const IDataType* dti, unsigned int flags, const Bucket* b, size_t index) {
+  if(b->hashes != NULL) {
+    return b->hashes[index];
+  }
+  return internal_hash_key(dti, flags, dti_item(dti, b->bucket, index));
+}
+
+/**
+ * Moves all elements of \p old_bucket into \p new_buckets.
+ * On failure, \p new_buckets are left as they were before the call.
+ */
+static int internal_hash_move_bucket(const IDataType* dti, unsigned int flags, Bucket* old_bucket, Bucket* new_buckets, size_t new_size) {
+  int cache = old_bucket->hashes != NULL;
+  for(size_t j = 0; j < old_bucket->length; j++) {
+    const void* old_elem = dti_element(dti, old_bucket->bucket, j);
+    const void* old_key = add_offset(old_elem, dti->offset);
+    size_t hash = internal_bucket_hash(dti, flags, old_bucket, j);
+    // Calculate destination bucket.
+    Bucket* new_bucket = new_buckets + internal_hash_index(flags, hash, new_size);
+    // Calculate where element is going to be inserted inside the new bucket.
+    size_t new_elem_index = internal_bucket_find(dti, new_bucket, old_key, hash).size;
+    if(!internal_bucket_insert(dti, new_bucket, old_elem, new_elem_index, hash, cache)) {
+      // Rollback the elements which already got moved.
+      for(size_t k = 0; k < j; k++) {
+        const void* moved_key = dti_item(dti, old_bucket->bucket, k);
+        size_t moved_hash = internal_bucket_hash(dti, flags, old_bucket, k);
+        Bucket* moved_bucket = new_buckets + internal_hash_index(flags, moved_hash, new_size);
+        size_t moved_index = internal_bucket_find(dti, moved_bucket, moved_key, moved_hash).size;
+        internal_bucket_remove(dti, moved_bucket, moved_index);
       }
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int internal_hash_resize_reloc(const IDataType* dti, unsigned int flags, Bucket* old_buckets, size_t old_size, Bucket* new_buckets, size_t new_size) {
+  // Each element of the old buckets gets inserted into the new buckets.
+  for(size_t i = 0; i < old_size; i++) {
+    if(!internal_hash_move_bucket(dti, flags, old_buckets + i, new_buckets, new_size)) {
+      EARLY_TRACEF("internal_hash_resize_reloc failure!");
+      // Rollback.
+      internal_buckets_destroy(new_buckets, new_size);
+      return 0;
     }
   }
   // Everything got moved safely, so now we can free the old buckets.
   internal_buckets_destroy(old_buckets, old_size);
-  #ifndef NDEBUG
+  // Success!
+  return 1;
+}
+
+/**
+ * Moves up to \p count buckets of an in progress migration.
+ */
+static inline void internal_hash_migrate(HashSet* hs, size_t count) {
+  #ifdef MODULE_CLOCK
+    PerfClock pc;
+    clock_reset(&pc);
+    clock_start(&pc);
+  #endif
+  size_t end = hs->migrated + count;
+  if(end > hs->old_size) {
+    end = hs->old_size;
+  }
+  while(hs->migrated < end) {
+    Bucket* old_bucket = hs->old_array + hs->migrated;
+    if(COLD_BRANCH(!internal_hash_move_bucket(hs->interface, hs->flags, old_bucket, hs->array, hs->size))) {
+      // Try again on the next operation.
+      EARLY_TRACE("internal_hash_migrate failure!");
+      break;
+    }
+    internal_bucket_reset(old_bucket);
+    hs->migrated++;
+  }
+  #ifdef MODULE_CLOCK
+    clock_stop(&pc);
+    hs->rehash_time += pc.delta;
+  #endif
+  if(hs->migrated == hs->old_size) {
+    EARLY_TRACEF("internal_hash_migrate finished (%zu -> %zu)!", hs->old_size, hs->size);
+    free(hs->old_array);
+    hs->old_array = NULL;
+    hs->old_size = 0;
+    hs->migrated = 0;
+  }
+}
+
+static int internal_hash_resize(HashSet* hs, size_t new_bucket_count) {
+  if(hs->flags & HASHSET_POW2) {
+    new_bucket_count = internal_round_pow2(new_bucket_count);
+  }
+  // Allocate new buckets.
+  Bucket* new_array = calloc(new_bucket_count, sizeof(Bucket));
+  if(new_array == NULL) {
+    EARLY_TRACE("internal_hash_resize could not allocate new array!");
+    return 0;
+  }
+  else {
+    EARLY_TRACEF("internal_hash_resize (%zu -> %zu)!", hs->size, new_bucket_count);
+  }
+  if(hs->flags & HASHSET_INCREMENTAL) {
+    // Old buckets get moved a few at a time by the following operations.
+    hs->old_array = hs->array;
+    hs->old_size = hs->size;
+    hs->migrated = 0;
+    hs->array = new_array;
+    hs->size = new_bucket_count;
+    hs->resize_count++;
+    return 1;
+  }
+  #ifdef MODULE_CLOCK
+    PerfClock pc;
+    clock_reset(&pc);
+    clock_start(&pc);
+  #endif
+  // Move old elements to new buckets.
+  int success = internal_hash_resize_reloc(hs->interface, hs->flags, hs->array, hs->size, new_array, new_bucket_count);
+  #ifdef MODULE_CLOCK
     clock_stop(&pc);
+    hs->rehash_time += pc.delta;
     EARLY_TRACEF("internal_hash_resize_reloc took %.4f ms!", pc.delta);
   #endif
-  // Success!
-  return 1;
+  if(success) {
+    // Finalize changes.
+    hs->resize_count++;
+    free(hs->array);
+    hs->array = new_array;
+    hs->size = new_bucket_count;
+    return 1;
+  }
+  else {
+    // Relocation failed. Rollback.
+    free(new_array);
+    return 0;
+  }
 }
 
 static inline int internal_hash_shrink(HashSet* hs) {
@@ -194,6 +455,10 @@ static inline int internal_hash_shrink(HashSet* hs) {
     // Shrinking disabled.
     return 0;
   }
+  if(hs->old_array != NULL) {
+    // Wait until the previous migration completes.
+    return 0;
+  }
   size_t bucket_count = hs->size;
   size_t elem_count = hs->length;
   if(bucket_count <= hs->min_size) {
@@ -201,30 +466,8 @@ static inline int internal_hash_shrink(HashSet* hs) {
     return 0;
   }
   float ratio = ((double)elem_count) / ((double)bucket_count);
-  if(COLD_BRANCH(ratio < hs->expand)) {
-    // Allocate new buckets.
-    size_t new_bucket_count = bucket_count / STRUCTURES_HASHSET_RESIZE_FACTOR;
-    Bucket* new_array = calloc(new_bucket_count, sizeof(Bucket));
-    if(new_array == NULL) {
-      EARLY_TRACE("internal_hash_shrink could not allocate new array!");
-      return 0;
-    }
-    else {
-      EARLY_TRACEF("internal_hash_shrink (%zu -> %zu)!", bucket_count, new_bucket_count);
-    }
-    // Move old elements to new buckets.
-    if(internal_hash_resize_reloc(hs->interface, hs->array, hs->size, new_array, new_bucket_count)) {
-      // Finalize changes.
-      free(hs->array);
-      hs->array = new_array;
-      hs->size = new_bucket_count;
-      return 1;
-    }
-    else {
-      // Relocation failed. Rollback.
-      free(new_array);
-      return 0;
-    }
+  if(COLD_BRANCH(ratio < hs->shrink)) {
+    return internal_hash_resize(hs, bucket_count / STRUCTURES_HASHSET_RESIZE_FACTOR);
   }
   return 0;
 }
@@ -234,38 +477,414 @@ static inline int internal_hash_expand(HashSet* hs) {
     // Expanding disabled.
     return 0;
   }
+  if(hs->old_array != NULL) {
+    // Wait until the previous migration completes.
+    return 0;
+  }
   size_t bucket_count = hs->size;
   size_t elem_count = hs->length;
   float ratio = ((double)elem_count) / ((double)bucket_count);
   if(COLD_BRANCH(ratio > hs->expand)) {
-    // Allocate new buckets.
-    size_t new_bucket_count = bucket_count * STRUCTURES_HASHSET_RESIZE_FACTOR;
-    Bucket* new_array = calloc(new_bucket_count, sizeof(Bucket));
-    if(new_array == NULL) {
-      EARLY_TRACE("internal_hash_expand could not allocate new array!");
-      return 0;
+    return internal_hash_resize(hs, bucket_count * STRUCTURES_HASHSET_RESIZE_FACTOR);
+  }
+  return 0;
+}
+
+/*
+ * Open addressing engine.
+ * Probing happens a group of control bytes at a time,
+ * and only slots whose hash fragment matches get compared.
+ * There is always at least one empty slot, so every probe sequence terminates.
+ */
+
+/**
+ * Top 7 bits of the mixed \p hash.
+ * Always mixed, so that weak hashes(like identity hashes, whose high bits are all 0)
+ * still spread over every fragment, without depending on \ref HASHSET_MIX_HASH.
+ */
+static inline uint8_t internal_open_fragment(size_t hash) {
+  return (uint8_t)(internal_hash_mix(hash) >> (sizeof(size_t) * CHAR_BIT - 7));
+}
+
+static inline size_t internal_open_limit(const HashSet* hs, size_t size) {
+  if(hs->expand == 0.0) {
+    // Expanding disabled, so the table may get filled up, except for the terminating slot.
+    return size - 1;
+  }
+  size_t limit = (size_t)(((double)size) * ((double)hs->expand));
+  return limit < size ? limit : size - 1;
+}
+
+/**
+ * Updates a control byte and its clones at the end of the control array.
+ */
+static inline void internal_open_set_ctrl(uint8_t* ctrl, size_t size, size_t index, uint8_t c) {
+  ctrl[index] = c;
+  for(size_t i = index; i < HASHSET_GROUP_MAX - 1; i += size) {
+    ctrl[size + i] = c;
+  }
+}
+
+static inline SizeBool internal_open_find(const HashSet* hs, const void* key, size_t hash) {
+  const IDataType* dti = hs->interface;
+  size_t mask = hs->size - 1;
+  size_t width = hs->group->width;
+  uint8_t fragment = internal_open_fragment(hash);
+  size_t pos = hash & mask;
+  size_t free_index = INVALID_SIZE_T;
+  while(1) {
+    GroupMask gm = hs->group->match(hs->ctrl + pos, fragment);
+    for(uint32_t match = gm.match; match != 0; match &= match - 1) {
+      size_t index = (pos + __builtin_ctz(match)) & mask;
+      if(hs->hashes != NULL && hs->hashes[index] != hash) {
+        continue;
+      }
+      if(dti->cmp_eq(dti, dti_item(dti, hs->slots, index), key)) {
+        // Hit
+        return (SizeBool){index, 1};
+      }
     }
-    else {
-      EARLY_TRACEF("internal_hash_expand (%zu -> %zu)!", bucket_count, new_bucket_count);
-    }
-    // Move old elements to new buckets.
-    if(internal_hash_resize_reloc(hs->interface, hs->array, hs->size, new_array, new_bucket_count)) {
-      // Finalize changes.
-      free(hs->array);
-      hs->array = new_array;
-      hs->size = new_bucket_count;
-      return 1;
+    if(free_index == INVALID_SIZE_T && gm.vacant != 0) {
+      // Prefer reusing a deleted slot.
+      free_index = (pos + __builtin_ctz(gm.vacant)) & mask;
     }
-    else {
-      // Relocation failed. Rollback.
-      free(new_array);
+    if(gm.empty != 0) {
+      // End of probe sequence.
+      return (SizeBool){free_index, 0};
+    }
+    pos = (pos + width) & mask;
+  }
+}
+
+static inline size_t internal_open_find_free(const HashSetGroup* group, const uint8_t* ctrl, size_t mask, size_t hash) {
+  size_t pos = hash & mask;
+  while(1) {
+    uint32_t free_slots = group->match(ctrl + pos, 0).vacant;
+    if(free_slots != 0) {
+      return (pos + __builtin_ctz(free_slots)) & mask;
+    }
+    pos = (pos + group->width) & mask;
+  }
+}
+
+static int internal_open_resize(HashSet* hs, size_t new_size) {
+  const IDataType* dti = hs->interface;
+  #ifdef MODULE_CLOCK
+    PerfClock pc;
+    clock_reset(&pc);
+    clock_start(&pc);
+  #endif
+  uint8_t* new_ctrl = malloc(new_size + HASHSET_GROUP_MAX - 1);
+  void* new_slots = malloc(new_size * dti->size);
+  size_t* new_hashes = NULL;
+  if(hs->hashes != NULL) {
+    new_hashes = malloc(new_size * sizeof(size_t));
+  }
+  if(new_ctrl == NULL || new_slots == NULL || (hs->hashes != NULL && new_hashes == NULL)) {
+    EARLY_TRACE("internal_open_resize could not allocate new table!");
+    free(new_ctrl);
+    free(new_slots);
+    free(new_hashes);
+    return 0;
+  }
+  memset(new_ctrl, CTRL_EMPTY, new_size + HASHSET_GROUP_MAX - 1);
+  // Move every stored element into the new table.
+  size_t new_mask = new_size - 1;
+  for(size_t i = 0; i < hs->size; i++) {
+    if(ctrl_is_full(hs->ctrl[i])) {
+      const void* old_elem = dti_element(dti, hs->slots, i);
+      size_t hash;
+      if(new_hashes != NULL) {
+        hash = hs->hashes[i];
+      }
+      else {
+        hash = internal_hash_key(dti, hs->flags, add_offset(old_elem, dti->offset));
+      }
+      size_t new_index = internal_open_find_free(hs->group, new_ctrl, new_mask, hash);
+      internal_open_set_ctrl(new_ctrl, new_size, new_index, internal_open_fragment(hash));
+      memcpy(dti_element(dti, new_slots, new_index), old_elem, dti->size);
+      if(new_hashes != NULL) {
+        new_hashes[new_index] = hash;
+      }
+    }
+  }
+  EARLY_TRACEF("internal_open_resize (%zu -> %zu)!", hs->size, new_size);
+  // Finalize changes.
+  free(hs->ctrl);
+  free(hs->slots);
+  free(hs->hashes);
+  hs->ctrl = new_ctrl;
+  hs->slots = new_slots;
+  hs->hashes = new_hashes;
+  hs->size = new_size;
+  hs->deleted = 0;
+  hs->resize_count++;
+  #ifdef MODULE_CLOCK
+    clock_stop(&pc);
+    hs->rehash_time += pc.delta;
+    EARLY_TRACEF("internal_open_resize took %.4f ms!", pc.delta);
+  #endif
+  return 1;
+}
+
+/**
+ * Makes sure there is room for one more element.
+ * Returns 0 on failure.
+ */
+static inline int internal_open_reserve(HashSet* hs) {
+  size_t limit = internal_open_limit(hs, hs->size);
+  if(HOT_BRANCH(hs->length + hs->deleted < limit)) {
+    return 1;
+  }
+  size_t new_size = hs->size;
+  if(hs->length >= limit) {
+    if(COLD_BRANCH(hs->expand == 0.0)) {
+      EARLY_TRACE("internal_open_reserve table is full!");
       return 0;
     }
+    new_size = internal_round_pow2(hs->size * STRUCTURES_HASHSET_RESIZE_FACTOR);
+  }
+  // Either grow, or just purge deleted slots.
+  return internal_open_resize(hs, new_size);
+}
+
+static inline void internal_open_shrink(HashSet* hs) {
+  if(COLD_BRANCH(hs->shrink == 0.0)) {
+    // Shrinking disabled.
+    return;
+  }
+  if(hs->size <= hs->min_size) {
+    // Minimum size.
+    return;
+  }
+  float ratio = ((double)hs->length) / ((double)hs->size);
+  if(COLD_BRANCH(ratio < hs->shrink)) {
+    size_t new_size = internal_round_pow2(hs->size / STRUCTURES_HASHSET_RESIZE_FACTOR);
+    if(new_size < hs->min_size) {
+      new_size = hs->min_size;
+    }
+    if(hs->length < internal_open_limit(hs, new_size)) {
+      internal_open_resize(hs, new_size);
+    }
+  }
+}
+
+static inline void internal_open_erase(HashSet* hs, size_t index) {
+  // If every group containing this slot also contains an empty slot,
+  // then no probe sequence can have continued past it.
+  size_t mask = hs->size - 1;
+  size_t width = hs->group->width;
+  size_t run = 1;
+  for(size_t i = 1; i < width && hs->ctrl[(index - i) & mask] != CTRL_EMPTY; i++) {
+    run++;
+  }
+  for(size_t i = 1; i < width && hs->ctrl[(index + i) & mask] != CTRL_EMPTY; i++) {
+    run++;
+  }
+  if(run < width) {
+    internal_open_set_ctrl(hs->ctrl, hs->size, index, CTRL_EMPTY);
+  }
+  else {
+    internal_open_set_ctrl(hs->ctrl, hs->size, index, CTRL_DELETED);
+    hs->deleted++;
+  }
+  hs->length--;
+}
+
+static inline int internal_open_alloc(HashSet* hs, size_t size) {
+  hs->ctrl = malloc(size + HASHSET_GROUP_MAX - 1);
+  hs->slots = malloc(size * hs->interface->size);
+  hs->hashes = NULL;
+  if(hs->flags & HASHSET_CACHE_HASH) {
+    hs->hashes = malloc(size * sizeof(size_t));
+  }
+  if(hs->ctrl == NULL || hs->slots == NULL || ((hs->flags & HASHSET_CACHE_HASH) && hs->hashes == NULL)) {
+    free(hs->ctrl);
+    free(hs->slots);
+    free(hs->hashes);
+    return 0;
+  }
+  memset(hs->ctrl, CTRL_EMPTY, size + HASHSET_GROUP_MAX - 1);
+  hs->size = size;
+  hs->deleted = 0;
+  return 1;
+}
+
+/**
+ * Allocates empty tables of \p size buckets or slots for the selected engine.
+ * Returns 0 on failure.
+ */
+static int internal_table_alloc(HashSet* hs, size_t size) {
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    return internal_open_alloc(hs, size);
+  }
+  hs->array = calloc(size, sizeof(Bucket));
+  if(hs->array == NULL) {
+    return 0;
+  }
+  hs->size = size;
+  return 1;
+}
+
+/**
+ * Frees the tables of the selected engine, including any in progress migration.
+ */
+static void internal_table_destroy(HashSet* hs) {
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    free(hs->ctrl);
+    free(hs->slots);
+    free(hs->hashes);
+    hs->ctrl = NULL;
+    hs->slots = NULL;
+    hs->hashes = NULL;
+  }
+  else {
+    internal_buckets_destroy(hs->array, hs->size);
+    free(hs->array);
+    hs->array = NULL;
+    if(hs->old_array != NULL) {
+      internal_buckets_destroy(hs->old_array, hs->old_size);
+      free(hs->old_array);
+      hs->old_array = NULL;
+      hs->old_size = 0;
+      hs->migrated = 0;
+    }
+  }
+  hs->size = 0;
+  hs->deleted = 0;
+}
+
+/*
+ * Dense mode.
+ * Keys are used directly as bit indexes of a bitset.
+ * The bitset grows in powers of two, for as long as it stays small compared to the element count.
+ */
+
+#define internal_is_dense(hs) ((hs)->dense.__data != NULL)
+#define DENSE_MIN_WORDS ((STRUCTURES_HASHSET_DENSE_MIN_BITS + SIZE_T_BITS - 1) / SIZE_T_BITS)
+
+static inline int internal_dense_supported(const IDataType* dti) {
+  if(dti->size != dti->key_size) {
+    return 0;
+  }
+  return dti->key_size == 1 || dti->key_size == 2 || dti->key_size == 4 || dti->key_size == 8;
+}
+
+static inline uint64_t internal_dense_key(const IDataType* dti, const void* kv) {
+  switch(dti->key_size) {
+    case 1:
+      return *(const uint8_t*)kv;
+    case 2:
+      return *(const uint16_t*)kv;
+    case 4:
+      return *(const uint32_t*)kv;
+    default:
+      return *(const uint64_t*)kv;
+  }
+}
+
+/**
+ * Returns a pointer to an element equal to \p key.
+ */
+static inline void* internal_dense_element(HashSet* hs, size_t key) {
+  uint8_t k8 = key;
+  uint16_t k16 = key;
+  uint32_t k32 = key;
+  uint64_t k64 = key;
+  switch(hs->interface->key_size) {
+    case 1:
+      memcpy(&hs->dense_element, &k8, sizeof(k8));
+      break;
+    case 2:
+      memcpy(&hs->dense_element, &k16, sizeof(k16));
+      break;
+    case 4:
+      memcpy(&hs->dense_element, &k32, sizeof(k32));
+      break;
+    default:
+      memcpy(&hs->dense_element, &k64, sizeof(k64));
+  }
+  return &hs->dense_element;
+}
+
+static inline int internal_dense_alloc(HashSet* hs, size_t words) {
+  size_t bytes = words * sizeof(size_t);
+  void* data = calloc(words, sizeof(size_t));
+  if(data == NULL) {
+    return 0;
+  }
+  bitfield_init(&hs->dense, data, bytes);
+  return 1;
+}
+
+static inline size_t internal_dense_bits(const HashSet* hs) {
+  return hs->dense.__length * CHAR_BIT;
+}
+
+static inline int internal_dense_contains(const HashSet* hs, const void* kv) {
+  uint64_t key = internal_dense_key(hs->interface, kv);
+  return key < internal_dense_bits(hs) && bitfield_get(&hs->dense, key);
+}
+
+/**
+ * Tries to make room for \p key in the bitset.
+ * Returns 0 if that would make the bitset too sparse, or on failure.
+ */
+static int internal_dense_grow(HashSet* hs, uint64_t key) {
+  if(key >= SIZE_MAX / 2) {
+    return 0;
+  }
+  size_t words = internal_round_pow2(key / SIZE_T_BITS + 1);
+  size_t max_words = (hs->length + 1) * STRUCTURES_HASHSET_DENSE_BITS_PER_ELEMENT / SIZE_T_BITS;
+  if(words > DENSE_MIN_WORDS && words > max_words) {
+    // Too sparse.
+    return 0;
+  }
+  size_t old_bytes = hs->dense.__length;
+  size_t* data = realloc(hs->dense.__data, words * sizeof(size_t));
+  if(data == NULL) {
+    EARLY_TRACE("internal_dense_grow could not allocate bitset!");
+    return 0;
+  }
+  memset(((uint8_t*)data) + old_bytes, 0, words * sizeof(size_t) - old_bytes);
+  bitfield_update(&hs->dense, data, words * sizeof(size_t));
+  return 1;
+}
+
+static int internal_dense_convert(HashSet* hs);
+
+/**
+ * Returns 1 if \p value was added, 0 if it already existed,
+ * -1 on error and -2 if the set has to switch to hashing first.
+ */
+static inline int internal_dense_add(HashSet* hs, const void* kv) {
+  uint64_t key = internal_dense_key(hs->interface, kv);
+  if(COLD_BRANCH(key >= internal_dense_bits(hs)) && !internal_dense_grow(hs, key)) {
+    return internal_dense_convert(hs) ? -2 : -1;
+  }
+  if(bitfield_get(&hs->dense, key)) {
+    return 0;
+  }
+  bitfield_set(&hs->dense, key);
+  hs->length++;
+  return 1;
+}
+
+static inline int internal_dense_remove(HashSet* hs, const void* kv) {
+  uint64_t key = internal_dense_key(hs->interface, kv);
+  if(key < internal_dense_bits(hs) && bitfield_get(&hs->dense, key)) {
+    bitfield_clear(&hs->dense, key);
+    hs->length--;
+    return 1;
   }
   return 0;
 }
 
-HashSet* hashset_create(const IDataType* interface, size_t initial_size, float shrink_ratio, float expand_ratio) {
+/*
+ * Api/Exported functions.
+ */
+
+HashSet* hashset_create(const IDataType* interface, size_t initial_size, float shrink_ratio, float expand_ratio, unsigned int flags) {
   HashSet* obj = malloc(sizeof(HashSet));
   if(obj != NULL) {
     if(initial_size == INVALID_SIZE_T || initial_size == 0) {
@@ -280,19 +899,52 @@ HashSet* hashset_create(const IDataType* interface, size_t initial_size, float s
       // Use default value.
       expand_ratio = STRUCTURES_HASHSET_EXPAND_RATIO;
     }
-    // Allocate initial bucket array.
-    obj->array = calloc(initial_size, sizeof(Bucket));
-    // Not enough memory.
-    if(obj->array == NULL) {
-      free(obj);
-      return NULL;
-    }
-    obj->size = initial_size;
+    obj->array = NULL;
+    obj->old_array = NULL;
+    obj->old_size = 0;
+    obj->migrated = 0;
+    obj->ctrl = NULL;
+    obj->slots = NULL;
+    obj->hashes = NULL;
     obj->length = 0;
-    obj->min_size = initial_size;
+    obj->deleted = 0;
     obj->shrink = shrink_ratio;
     obj->expand = expand_ratio;
+    obj->size = 0;
+    obj->flags = flags;
+    obj->resize_count = 0;
+    obj->rehash_time = 0.0;
+    obj->group = internal_hashset_resolve_group();
     obj->interface = interface;
+    bitfield_init(&obj->dense, NULL, 0);
+    if(flags & HASHSET_ENGINE_OPEN) {
+      // Open addressing requires free slots to terminate probing.
+      if(obj->expand >= STRUCTURES_HASHSET_OPEN_MAX_LOAD) {
+        obj->expand = STRUCTURES_HASHSET_OPEN_MAX_LOAD;
+      }
+      initial_size = internal_round_pow2(initial_size < 2 ? 2 : initial_size);
+    }
+    else if(flags & HASHSET_POW2) {
+      initial_size = internal_round_pow2(initial_size);
+    }
+    obj->min_size = initial_size;
+    if((flags & HASHSET_DENSE_KEYS) && !internal_dense_supported(interface)) {
+      EARLY_TRACE("hashset_create ignoring HASHSET_DENSE_KEYS for unsupported interface!");
+      obj->flags &= ~HASHSET_DENSE_KEYS;
+    }
+    int allocated;
+    if(obj->flags & HASHSET_DENSE_KEYS) {
+      // Tables get allocated when switching to hashing.
+      allocated = internal_dense_alloc(obj, DENSE_MIN_WORDS);
+    }
+    else {
+      allocated = internal_table_alloc(obj, initial_size);
+    }
+    if(!allocated) {
+      // Not enough memory.
+      free(obj);
+      return NULL;
+    }
   }
   return obj;
 }
@@ -301,34 +953,101 @@ size_t hash_size(HashSet* hs) {
   return hs->length;
 }
 
+static inline int internal_contains(HashSet* hs, const void* kv, size_t hash) {
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    return internal_open_find(hs, kv, hash).boolean;
+  }
+  Bucket* buc = internal_hash_bucket(hs, hash);
+  int found = internal_bucket_find(hs->interface, buc, kv, hash).boolean;
+  return found;
+}
+
 int hashset_contains(HashSet* hs, const void* value) {
   const void* kv = add_offset(value, hs->interface->offset);
-  size_t index = internal_hash_calc_index(hs->interface, hs->size, kv);
-  Bucket* buc = hs->array + index;
-  int found = internal_bucket_find(hs->interface, buc->bucket, buc->length, kv).boolean;
-  return found;
+  if(internal_is_dense(hs)) {
+    return internal_dense_contains(hs, kv);
+  }
+  return internal_contains(hs, kv, internal_hash_key(hs->interface, hs->flags, kv));
 }
 
-int hashset_get(HashSet* hs, void* value) {
+void* hashset_find_ptr(HashSet* hs, const void* value) {
   const void* kv = add_offset(value, hs->interface->offset);
-  size_t index = internal_hash_calc_index(hs->interface, hs->size, kv);
-  Bucket* buc = hs->array + index;
-  SizeBool subindex_found = internal_bucket_find(hs->interface, buc->bucket, buc->length, kv);
-  size_t subindex = subindex_found.size;
-  int found = subindex_found.boolean;
-  if(found) {
-    const void* stored = dti_element(hs->interface, buc->bucket, subindex);
+  if(internal_is_dense(hs)) {
+    if(internal_dense_contains(hs, kv)) {
+      return internal_dense_element(hs, internal_dense_key(hs->interface, kv));
+    }
+    return NULL;
+  }
+  size_t hash = internal_hash_key(hs->interface, hs->flags, kv);
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    SizeBool slot_found = internal_open_find(hs, kv, hash);
+    if(slot_found.boolean) {
+      return dti_element(hs->interface, hs->slots, slot_found.size);
+    }
+    return NULL;
+  }
+  Bucket* buc = internal_hash_bucket(hs, hash);
+  SizeBool subindex_found = internal_bucket_find(hs->interface, buc, kv, hash);
+  if(subindex_found.boolean) {
+    return dti_element(hs->interface, buc->bucket, subindex_found.size);
+  }
+  return NULL;
+}
+
+int hashset_get(HashSet* hs, void* value) {
+  const void* stored = hashset_find_ptr(hs, value);
+  if(stored != NULL) {
     memcpy(value, stored, hs->interface->size);
   }
-  return !found;
+  return stored == NULL;
 }
 
-int hashset_add(HashSet* hs, const void* value) {
-  const void* kv = add_offset(value, hs->interface->offset);
+static inline int internal_open_add(HashSet* hs, const void* value, const void* kv, size_t hash) {
+  SizeBool slot_found = internal_open_find(hs, kv, hash);
+  if(slot_found.boolean) {
+    // Replacing.
+    void* stored = dti_element(hs->interface, hs->slots, slot_found.size);
+    memcpy(stored, value, hs->interface->size);
+    EARLY_TRACE("hashset_add replaced element!");
+    return 0;
+  }
+  // Adding.
+  size_t old_size = hs->size;
+  size_t old_deleted = hs->deleted;
+  if(!internal_open_reserve(hs)) {
+    return -1;
+  }
+  size_t index = slot_found.size;
+  if(COLD_BRANCH(old_size != hs->size || old_deleted != hs->deleted)) {
+    // Table got rebuilt, find new free slot.
+    index = internal_open_find_free(hs->group, hs->ctrl, hs->size - 1, hash);
+  }
+  if(hs->ctrl[index] == CTRL_DELETED) {
+    hs->deleted--;
+  }
+  internal_open_set_ctrl(hs->ctrl, hs->size, index, internal_open_fragment(hash));
+  memcpy(dti_element(hs->interface, hs->slots, index), value, hs->interface->size);
+  if(hs->hashes != NULL) {
+    hs->hashes[index] = hash;
+  }
+  // Finalize changes.
+  hs->length++;
+  return 1;
+}
+
+/**
+ * Returns 1 if \p value was added, 0 if it replaced an element and -1 on error.
+ */
+static inline int internal_add(HashSet* hs, const void* value, const void* kv, size_t hash) {
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    return internal_open_add(hs, value, kv, hash);
+  }
+  if(COLD_BRANCH(hs->old_array != NULL)) {
+    internal_hash_migrate(hs, STRUCTURES_HASHSET_REHASH_STEP);
+  }
   // First find out if we are replacing or adding.
-  size_t index = internal_hash_calc_index(hs->interface, hs->size, kv);
-  Bucket* b = hs->array + index;
-  SizeBool subindex_found = internal_bucket_find(hs->interface, b->bucket, b->length, kv);
+  Bucket* b = internal_hash_bucket(hs, hash);
+  SizeBool subindex_found = internal_bucket_find(hs->interface, b, kv, hash);
   size_t subindex = subindex_found.size;
   int found = subindex_found.boolean;
   if(found) {
@@ -340,33 +1059,101 @@ int hashset_add(HashSet* hs, const void* value) {
   }
   else {
     // Adding.
+    int cache = (hs->flags & HASHSET_CACHE_HASH) != 0;
     if(COLD_BRANCH(internal_hash_expand(hs))) {
       // Bucket array got resized, recalculate indexes.
-      size_t index = internal_hash_calc_index(hs->interface, hs->size, kv);
-      Bucket* b = hs->array + index;
-      size_t subindex = internal_bucket_find(hs->interface, b->bucket, b->length, kv).size;
-      if(!internal_bucket_insert(hs->interface, b, value, subindex)) {
-        return 1;
+      Bucket* b = internal_hash_bucket(hs, hash);
+      size_t subindex = internal_bucket_find(hs->interface, b, kv, hash).size;
+      if(!internal_bucket_insert(hs->interface, b, value, subindex, hash, cache)) {
+        return -1;
       }
     }
     else {
       // Bucket array didn't get resized, so we can use the indexes found above.
-      if(!internal_bucket_insert(hs->interface, b, value, subindex)) {
-        return 1;
+      if(!internal_bucket_insert(hs->interface, b, value, subindex, hash, cache)) {
+        return -1;
       }
     }
     // Finalize changes.
     hs->length++;
-    return 0;
+    return 1;
   }
 }
 
-int hashset_remove(HashSet* hs, const void* value) {
+int hashset_add(HashSet* hs, const void* value) {
   const void* kv = add_offset(value, hs->interface->offset);
+  if(internal_is_dense(hs)) {
+    int r = internal_dense_add(hs, kv);
+    if(r != -2) {
+      return r < 0;
+    }
+    // Switched to hashing.
+  }
+  return internal_add(hs, value, kv, internal_hash_key(hs->interface, hs->flags, kv)) < 0;
+}
+
+/**
+ * Moves every stored key from the bitset into the hashing engine.
+ * Returns 0 on failure, in which case the set stays in dense mode.
+ */
+static int internal_dense_convert(HashSet* hs) {
+  const IDataType* dti = hs->interface;
+  Bitfield dense = hs->dense;
+  size_t length = hs->length;
+  // Size the tables for the current elements, to avoid resizing right away.
+  size_t size = hs->min_size;
+  while(hs->expand != 0.0 && ((double)length) >= ((double)size) * ((double)hs->expand)) {
+    size *= STRUCTURES_HASHSET_RESIZE_FACTOR;
+  }
+  if(hs->flags & (HASHSET_ENGINE_OPEN | HASHSET_POW2)) {
+    size = internal_round_pow2(size);
+  }
+  if(!internal_table_alloc(hs, size)) {
+    EARLY_TRACE("internal_dense_convert could not allocate tables!");
+    return 0;
+  }
+  EARLY_TRACEF("internal_dense_convert (%zu elements, %zu bits -> %zu)!", length, internal_dense_bits(hs), size);
+  bitfield_init(&hs->dense, NULL, 0);
+  hs->length = 0;
+  int failed = 0;
+  bitfield_for_each(&dense, 1, 0, {
+    if(!failed) {
+      const void* element = internal_dense_element(hs, bit_index);
+      failed = internal_add(hs, element, element, internal_hash_key(dti, hs->flags, element)) < 0;
+    }
+  });
+  if(failed) {
+    // Rollback.
+    internal_table_destroy(hs);
+    hs->dense = dense;
+    hs->length = length;
+    return 0;
+  }
+  free(dense.__data);
+  hs->resize_count++;
+  return 1;
+}
+
+/**
+ * Returns 1 if an element was removed, 0 if it was not found.
+ */
+static inline int internal_remove(HashSet* hs, const void* kv, size_t hash) {
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    SizeBool slot_found = internal_open_find(hs, kv, hash);
+    if(slot_found.boolean) {
+      internal_open_erase(hs, slot_found.size);
+      internal_open_shrink(hs);
+      return 1;
+    }
+    // Not found.
+    return 0;
+  }
+  if(COLD_BRANCH(hs->old_array != NULL)) {
+    internal_hash_migrate(hs, STRUCTURES_HASHSET_REHASH_STEP);
+  }
   // First find where the element to remove is.
-  size_t index = internal_hash_calc_index(hs->interface, hs->size, kv);
-  Bucket* b = hs->array + index;
-  SizeBool subindex_found = internal_bucket_find(hs->interface, b->bucket, b->length, kv);
+  Bucket* b = internal_hash_bucket(hs, hash);
+  SizeBool subindex_found = internal_bucket_find(hs->interface, b, kv, hash);
   size_t subindex = subindex_found.size;
   int found = subindex_found.boolean;
   if(found) {
@@ -375,27 +1162,347 @@ int hashset_remove(HashSet* hs, const void* value) {
     hs->length--;
     // Resize.
     internal_hash_shrink(hs);
-    return 0;
+    return 1;
   }
   // Not found.
-  return 1;
+  return 0;
 }
 
-int hashset_clear(HashSet* hs) {
-  internal_buckets_destroy(hs->array, hs->size);
-  free(hs->array);
-  // Recreate buckets.
-  hs->array = calloc(sizeof(Bucket), hs->min_size);
-  if(hs->array == NULL) {
-    return 1;
+int hashset_remove(HashSet* hs, const void* value) {
+  const void* kv = add_offset(value, hs->interface->offset);
+  if(internal_is_dense(hs)) {
+    return !internal_dense_remove(hs, kv);
+  }
+  return !internal_remove(hs, kv, internal_hash_key(hs->interface, hs->flags, kv));
+}
+
+/*
+ * Batch operations.
+ * Elements are processed in chunks: the whole chunk gets hashed first,
+ * then the memory each element will touch is prefetched,
+ * so that the cache misses of a chunk overlap instead of happening one by one.
+ */
+
+typedef enum { BATCH_CONTAINS, BATCH_ADD, BATCH_REMOVE } BatchOp;
+
+/**
+ * Hashes and prefetches up to a chunk of elements starting at \p start.
+ * Returns how many elements the chunk has.
+ */
+static inline size_t internal_batch_prepare(const HashSet* hs, const void* values, size_t count, size_t start, size_t hashes[]) {
+  const IDataType* dti = hs->interface;
+  size_t n = count - start;
+  if(n > STRUCTURES_HASHSET_BATCH_SIZE) {
+    n = STRUCTURES_HASHSET_BATCH_SIZE;
+  }
+  const void* chunk = dti_element(dti, values, start);
+  for(size_t i = 0; i < n; i++) {
+    hashes[i] = internal_hash_key(dti, hs->flags, dti_item(dti, chunk, i));
+  }
+  // Prefetching is kept here, because gcc drops calls
+  // to functions whose only side effects are prefetches.
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    size_t mask = hs->size - 1;
+    for(size_t i = 0; i < n; i++) {
+      size_t pos = hashes[i] & mask;
+      PREFETCH(hs->ctrl + pos);
+      PREFETCH(hs->hashes != NULL ? (const void*)(hs->hashes + pos) : dti_element(dti, hs->slots, pos));
+    }
+  }
+  else {
+    // Bucket headers first, and then the sorted arrays they point to.
+    for(size_t i = 0; i < n; i++) {
+      PREFETCH(internal_hash_bucket(hs, hashes[i]));
+    }
+    for(size_t i = 0; i < n; i++) {
+      const Bucket* b = internal_hash_bucket(hs, hashes[i]);
+      PREFETCH(b->hashes != NULL ? (const void*)b->hashes : b->bucket);
+    }
+  }
+  return n;
+}
+
+static int internal_batch(HashSet* hs, const void* values, size_t count, const Bitfield* out, BatchOp op) {
+  const IDataType* dti = hs->interface;
+  // The next chunk is prepared while the current one gets resolved,
+  // so that its prefetches have time to complete.
+  size_t hashes[2][STRUCTURES_HASHSET_BATCH_SIZE];
+  size_t start = 0;
+  size_t c = 0;
+  size_t n = 0;
+  if(count != 0) {
+    n = internal_batch_prepare(hs, values, count, 0, hashes[0]);
+  }
+  while(n != 0) {
+    size_t next_start = start + n;
+    size_t next_n = 0;
+    if(next_start < count) {
+      next_n = internal_batch_prepare(hs, values, count, next_start, hashes[c ^ 1]);
+    }
+    const void* chunk = dti_element(dti, values, start);
+    for(size_t i = 0; i < n; i++) {
+      const void* value = dti_element(dti, chunk, i);
+      const void* kv = add_offset(value, dti->offset);
+      size_t hash = hashes[c][i];
+      int r;
+      switch(op) {
+        case BATCH_CONTAINS:
+          r = internal_contains(hs, kv, hash);
+          break;
+        case BATCH_ADD:
+          r = internal_add(hs, value, kv, hash);
+          if(COLD_BRANCH(r < 0)) {
+            return 1;
+          }
+          break;
+        default:
+          r = internal_remove(hs, kv, hash);
+          break;
+      }
+      if(out != NULL) {
+        bitfield_assign(out, start + i, r);
+      }
+    }
+    // Advance to the prepared chunk.
+    start = next_start;
+    n = next_n;
+    c ^= 1;
   }
-  hs->size = hs->min_size;
-  hs->length = 0;
   return 0;
 }
 
+/**
+ * Dense mode has no hashes to compute or buckets to prefetch,
+ * so elements are processed one at a time.
+ */
+static int internal_dense_batch(HashSet* hs, const void* values, size_t count, const Bitfield* out, BatchOp op) {
+  const IDataType* dti = hs->interface;
+  for(size_t i = 0; i < count; i++) {
+    const void* value = dti_element(dti, values, i);
+    const void* kv = add_offset(value, dti->offset);
+    int r;
+    switch(op) {
+      case BATCH_CONTAINS:
+        r = internal_dense_contains(hs, kv);
+        break;
+      case BATCH_ADD:
+        r = internal_is_dense(hs) ? internal_dense_add(hs, kv) : -2;
+        if(COLD_BRANCH(r == -2)) {
+          // Switched to hashing.
+          r = internal_add(hs, value, kv, internal_hash_key(dti, hs->flags, kv));
+        }
+        if(COLD_BRANCH(r < 0)) {
+          return 1;
+        }
+        break;
+      default:
+        r = internal_dense_remove(hs, kv);
+        break;
+    }
+    if(out != NULL) {
+      bitfield_assign(out, i, r);
+    }
+  }
+  return 0;
+}
+
+int hashset_contains_many(HashSet* hs, const void* values, size_t count, const Bitfield* found) {
+  if(internal_is_dense(hs)) {
+    return internal_dense_batch(hs, values, count, found, BATCH_CONTAINS);
+  }
+  return internal_batch(hs, values, count, found, BATCH_CONTAINS);
+}
+
+int hashset_add_many(HashSet* hs, const void* values, size_t count, const Bitfield* added) {
+  if(internal_is_dense(hs)) {
+    return internal_dense_batch(hs, values, count, added, BATCH_ADD);
+  }
+  return internal_batch(hs, values, count, added, BATCH_ADD);
+}
+
+int hashset_remove_many(HashSet* hs, const void* values, size_t count, const Bitfield* removed) {
+  if(internal_is_dense(hs)) {
+    return internal_dense_batch(hs, values, count, removed, BATCH_REMOVE);
+  }
+  return internal_batch(hs, values, count, removed, BATCH_REMOVE);
+}
+
+void hashset_iterator_init(MARK_UNUSED HashSet* hs, HashSetIterator* it) {
+  it->__array = 0;
+  it->__index = 0;
+  it->__subindex = 0;
+}
+
+static inline void* internal_open_iterator_next(HashSet* hs, HashSetIterator* it) {
+  size_t width = hs->group->width;
+  uint32_t group_mask = width < 32 ? (UINT32_C(1) << width) - 1 : UINT32_MAX;
+  // Whole groups of vacant slots get skipped at once.
+  while(it->__index < hs->size) {
+    uint32_t full = ~hs->group->match(hs->ctrl + it->__index, 0).vacant & group_mask;
+    if(full != 0) {
+      size_t index = it->__index + __builtin_ctz(full);
+      if(index >= hs->size) {
+        // Cloned control bytes.
+        break;
+      }
+      it->__index = index + 1;
+      return dti_element(hs->interface, hs->slots, index);
+    }
+    it->__index += width;
+  }
+  it->__index = hs->size;
+  return NULL;
+}
+
+static inline void* internal_dense_iterator_next(HashSet* hs, HashSetIterator* it) {
+  size_t bits = internal_dense_bits(hs);
+  // Whole words of absent keys get skipped at once.
+  while(it->__index < bits) {
+    size_t word = hs->dense.__data[it->__index / SIZE_T_BITS] >> (it->__index % SIZE_T_BITS);
+    if(word != 0) {
+      size_t key = it->__index + __builtin_ctzll(word);
+      it->__index = key + 1;
+      return internal_dense_element(hs, key);
+    }
+    it->__index = (it->__index / SIZE_T_BITS + 1) * SIZE_T_BITS;
+  }
+  return NULL;
+}
+
+void* hashset_iterator_next(HashSet* hs, HashSetIterator* it) {
+  if(internal_is_dense(hs)) {
+    return internal_dense_iterator_next(hs, it);
+  }
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    return internal_open_iterator_next(hs, it);
+  }
+  // The current bucket array first, and then buckets of an in progress migration.
+  while(1) {
+    Bucket* array;
+    size_t size;
+    if(it->__array == 0) {
+      array = hs->array;
+      size = hs->size;
+    }
+    else if(it->__array == 1 && hs->old_array != NULL) {
+      array = hs->old_array;
+      size = hs->old_size;
+      if(it->__index < hs->migrated) {
+        // Already moved to the current array.
+        it->__index = hs->migrated;
+      }
+    }
+    else {
+      return NULL;
+    }
+    while(it->__index < size) {
+      Bucket* b = array + it->__index;
+      if(it->__subindex < b->length) {
+        return dti_element(hs->interface, b->bucket, it->__subindex++);
+      }
+      it->__index++;
+      it->__subindex = 0;
+    }
+    it->__array++;
+    it->__index = 0;
+    it->__subindex = 0;
+  }
+}
+
+int hashset_clear(HashSet* hs) {
+  internal_table_destroy(hs);
+  hs->length = 0;
+  if(hs->flags & HASHSET_DENSE_KEYS) {
+    // Start over in dense mode.
+    free(hs->dense.__data);
+    bitfield_init(&hs->dense, NULL, 0);
+    return !internal_dense_alloc(hs, DENSE_MIN_WORDS);
+  }
+  // Recreate tables.
+  return !internal_table_alloc(hs, hs->min_size);
+}
+
 void hashset_destroy(HashSet* hs) {
-  internal_buckets_destroy(hs->array, hs->size);
-  free(hs->array);
+  internal_table_destroy(hs);
+  free(hs->dense.__data);
   free(hs);
-}
\ No newline at end of file
+}
+
+static inline size_t internal_alloc_size(void* ptr) {
+  return ptr != NULL ? galloc_size(ptr) : 0;
+}
+
+/**
+ * Adds the allocations and bucket lengths of \p count buckets to \p stats.
+ * Returns how many of the buckets are not empty.
+ */
+static size_t internal_buckets_stats(Bucket* buckets, size_t count, HashSetStats* stats) {
+  size_t used = 0;
+  stats->bytes += internal_alloc_size(buckets);
+  for(size_t i = 0; i < count; i++) {
+    Bucket* b = buckets + i;
+    if(b->length != 0) {
+      stats->bytes += internal_alloc_size(b->bucket) + internal_alloc_size(b->hashes);
+      used++;
+      if(b->length > stats->max_probe) {
+        stats->max_probe = b->length;
+      }
+    }
+  }
+  return used;
+}
+
+void hashset_stats(HashSet* hs, HashSetStats* stats) {
+  const IDataType* dti = hs->interface;
+  stats->bytes = internal_alloc_size(hs);
+  stats->elements = hs->length;
+  stats->capacity = hs->size;
+  stats->load_factor = hs->size != 0 ? ((double)hs->length) / ((double)hs->size) : 0.0f;
+  stats->max_probe = 0;
+  stats->avg_probe = 0.0f;
+  stats->resize_count = hs->resize_count;
+  stats->rehash_time = hs->rehash_time;
+  if(internal_is_dense(hs)) {
+    // Every key has its own bit, so there is no probing.
+    stats->bytes += internal_alloc_size(hs->dense.__data);
+    stats->capacity = internal_dense_bits(hs);
+    stats->load_factor = ((double)hs->length) / ((double)stats->capacity);
+    return;
+  }
+  if(hs->flags & HASHSET_ENGINE_OPEN) {
+    stats->bytes += internal_alloc_size(hs->ctrl) + internal_alloc_size(hs->slots) + internal_alloc_size(hs->hashes);
+    if(hs->ctrl == NULL) {
+      return;
+    }
+    size_t mask = hs->size - 1;
+    double distance_sum = 0.0;
+    for(size_t i = 0; i < hs->size; i++) {
+      if(ctrl_is_full(hs->ctrl[i])) {
+        size_t hash;
+        if(hs->hashes != NULL) {
+          hash = hs->hashes[i];
+        }
+        else {
+          hash = internal_hash_key(dti, hs->flags, dti_item(dti, hs->slots, i));
+        }
+        // Probing wraps around, so the distance does too.
+        size_t distance = (i - (hash & mask)) & mask;
+        distance_sum += distance;
+        if(distance > stats->max_probe) {
+          stats->max_probe = distance;
+        }
+      }
+    }
+    if(hs->length != 0) {
+      stats->avg_probe = distance_sum / hs->length;
+    }
+    return;
+  }
+  size_t used = internal_buckets_stats(hs->array, hs->size, stats);
+  if(hs->old_array != NULL) {
+    used += internal_buckets_stats(hs->old_array, hs->old_size, stats);
+  }
+  if(used != 0) {
+    stats->avg_probe = ((double)hs->length) / ((double)used);
+  }
+}
@@ -5,6 +5,7 @@
  * @brief Can be used as a HashSet or a HashMap.
  */
 
+#include <Bitfield.h>
 #include <Interface.h>
 #include <Macros.h>
 
@@ -16,6 +17,105 @@
 struct HashSet;
 typedef struct HashSet HashSet;
 
+/**
+ * Cursor for walking all stored elements of a \ref HashSet.
+ * The programmer should allocate stack space for it,
+ * and treat it as an opaque data type after that.
+ */
+typedef struct {
+  size_t __array;
+  size_t __index;
+  size_t __subindex;
+} HashSetIterator;
+
+/**
+ * Options for \ref hashset_create.
+ */
+typedef enum {
+  /**
+   * Separate chaining, where each bucket is a sorted array.
+   * This is the default engine.
+   */
+  HASHSET_ENGINE_BUCKETS = 0x0,
+  /**
+   * Open addressing, where all elements are stored inline in a single table.
+   * Avoids per element allocations, but \p expand_ratio is capped below 1.0.
+   */
+  HASHSET_ENGINE_OPEN = 0x1,
+  /**
+   * Spread bucket engine resizes over the following operations,
+   * moving a few buckets each time instead of all at once.
+   * Bounds the latency of a single add or remove.
+   * Ignored by the open addressing engine.
+   */
+  HASHSET_INCREMENTAL = 0x2,
+  /**
+   * Store the full hash next to each element.
+   * Resizes never call the hash function again,
+   * and lookups only compare keys whose hashes are equal.
+   * Costs an extra size_t per element.
+   */
+  HASHSET_CACHE_HASH = 0x4,
+  /**
+   * Keep bucket counts powers of two, so that buckets are selected
+   * with a mask instead of a division.
+   * The open addressing engine always does this.
+   */
+  HASHSET_POW2 = 0x8,
+  /**
+   * Scramble the user's hash before using it.
+   * Protects against weak hashes, like identity hashes of integers,
+   * which would otherwise fill only a few buckets or probe long runs.
+   * Without \ref HASHSET_POW2, buckets are selected with a multiplication instead of a division.
+   */
+  HASHSET_MIX_HASH = 0x10,
+  /**
+   * Keys are small non negative integers, which are mostly dense.
+   * While the largest key stays small compared to the element count,
+   * membership is tracked with a \ref Bitfield, costing one bit per possible key.
+   * When keys become sparse, the set switches to the selected hashing engine.
+   * Requires elements to be unsigned integers of 1, 2, 4 or 8 bytes
+   * without any payload (\p size equal to \p key_size),
+   * which are equal only if their values are equal.
+   * Ignored for any other interface.
+   * In dense mode, \ref hashset_find_ptr and iterators return
+   * a pointer to a copy of the element, which stays valid until the next call.
+   */
+  HASHSET_DENSE_KEYS = 0x20
+} HashSetFlags;
+
+/**
+ * Snapshot of the internal state of a \ref HashSet.
+ * Meant for tuning the initial size and the shrink/expand ratios.
+ */
+typedef struct {
+  /** Bytes allocated by the \ref HashSet, including the structure itself. */
+  size_t bytes;
+  /** Count of currently stored elements. */
+  size_t elements;
+  /** How many buckets or slots are currently allocated. */
+  size_t capacity;
+  /** \p elements divided by \p capacity. */
+  float load_factor;
+  /**
+   * Bucket engine: length of the longest bucket.
+   * Open addressing engine: longest distance of an element from its home slot.
+   */
+  size_t max_probe;
+  /**
+   * Bucket engine: average length of non empty buckets.
+   * Open addressing engine: average distance of an element from its home slot.
+   */
+  float avg_probe;
+  /** How many times the table has been rebuilt since creation. */
+  size_t resize_count;
+  /**
+   * Total time spent moving elements between tables in ms.
+   * Always 0 if the clock module is not built.
+   */
+  double rehash_time;
+} HashSetStats;
+
 /**
  * Allocates a new HashSet object.
  * 
@@ -31,9 +131,10 @@ typedef struct HashSet HashSet;
  *   divided by the current allocated buckets grows above \p expand_ratio
  *   the number of allocated buckets is increased.
  *   Pass 0.0 to disable expanding, or a negative value to use the defaults.
+ * @param flags a combination of \ref HashSetFlags.
  * @returns the allocated HashSet or NULL if there was not enough memory available.
  */
-EXPORT_API MARK_OBJ_ALLOC HashSet* hashset_create(const IDataType* interface, size_t initial_size, float shrink_ratio, float expand_ratio) MARK_NONNULL_ARGS(1);
+EXPORT_API MARK_OBJ_ALLOC HashSet* hashset_create(const IDataType* interface, size_t initial_size, float shrink_ratio, float expand_ratio, unsigned int flags) MARK_NONNULL_ARGS(1);
 
 /**
  * Gets the number of currently stored elements.
@@ -61,6 +162,18 @@ EXPORT_API int hashset_contains(HashSet* hs, const void* value) MARK_NONNULL_ARG
  */
 EXPORT_API int hashset_get(HashSet* hs, void* value) MARK_NONNULL_ARGS(1, 2);
 
+/**
+ * Finds the stored element which matches \p value, without copying it.
+ * The returned pointer stays valid until the next modification of \p hs.
+ * The stored element may be modified through it,
+ * as long as its key does not change.
+ *
+ * @param hs \ref hashset_create.
+ * @param value pointer to value to search.
+ * @returns pointer to the stored element, or NULL if it was not found.
+ */
+EXPORT_API void* hashset_find_ptr(HashSet* hs, const void* value) MARK_NONNULL_ARGS(1, 2);
+
 /**
  * Adds element \p value if it does not exist in the \ref HashSet.
  * Replaces element \p value if it exists in the \ref HashSet.
@@ -80,6 +193,46 @@ EXPORT_API int hashset_add(HashSet* hs, const void* value) MARK_NONNULL_ARGS(1,
  */
 EXPORT_API int hashset_remove(HashSet* hs, const void* value) MARK_NONNULL_ARGS(1, 2);
 
+/**
+ * Checks which of the \p count elements stored contiguously at \p values
+ * exist in the \ref HashSet.
+ * Faster than calling \ref hashset_contains for each element,
+ * as memory accesses of neighbouring elements overlap.
+ *
+ * @param hs \ref hashset_create.
+ * @param values array of elements to search.
+ * @param count how many elements \p values has.
+ * @param found bit i is set if the i-th element was found.
+ *   Must have room for at least \p count bits.
+ * @returns non zero on error.
+ */
+EXPORT_API int hashset_contains_many(HashSet* hs, const void* values, size_t count, const Bitfield* found) MARK_NONNULL_ARGS(1, 4);
+
+/**
+ * Batch version of \ref hashset_add.
+ *
+ * @param hs \ref hashset_create.
+ * @param values array of elements to add.
+ * @param count how many elements \p values has.
+ * @param added optional (may be NULL), bit i is set if the i-th element
+ *   did not already exist and cleared if it replaced an existing element.
+ *   Must have room for at least \p count bits.
+ * @returns non zero on error, in which case only some of the elements were added.
+ */
+EXPORT_API int hashset_add_many(HashSet* hs, const void* values, size_t count, const Bitfield* added) MARK_NONNULL_ARGS(1);
+
+/**
+ * Batch version of \ref hashset_remove.
+ *
+ * @param hs \ref hashset_create.
+ * @param values array of elements to remove.
+ * @param count how many elements \p values has.
+ * @param removed optional (may be NULL), bit i is set if the i-th element existed and got removed.
+ *   Must have room for at least \p count bits.
+ * @returns non zero on error.
+ */
+EXPORT_API int hashset_remove_many(HashSet* hs, const void* values, size_t count, const Bitfield* removed) MARK_NONNULL_ARGS(1);
+
 /**
  * Removes all stored elements in this \ref HashSet.
  * 
@@ -95,6 +248,33 @@ EXPORT_API int hashset_clear(HashSet* hs) MARK_NONNULL_ARGS(1);
  */
 EXPORT_API void hashset_destroy(HashSet* hs) MARK_NONNULL_ARGS(1);
 
-// TODO: iterators
+/**
+ * Collects statistics about \p hs.
+ * Walks every bucket or slot, so it is not meant for hot paths.
+ *
+ * @param hs \ref hashset_create.
+ * @param stats where to store the results.
+ */
+EXPORT_API void hashset_stats(HashSet* hs, HashSetStats* stats) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Places \p it before the first stored element of \p hs.
+ *
+ * @param hs \ref hashset_create.
+ * @param it iterator to initialize.
+ */
+EXPORT_API void hashset_iterator_init(HashSet* hs, HashSetIterator* it) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Advances \p it to the next stored element.
+ * Elements are visited in no particular order.
+ * Modifying \p hs invalidates all of its iterators.
+ *
+ * @param hs \ref hashset_create.
+ * @param it \ref hashset_iterator_init.
+ * @returns pointer to the stored element (same rules as \ref hashset_find_ptr),
+ *   or NULL when all elements have been visited.
+ */
+EXPORT_API void* hashset_iterator_next(HashSet* hs, HashSetIterator* it) MARK_NONNULL_ARGS(1, 2);
 
 #endif /*SSCE_HASHSET_H*/
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef SSCE_HASHSET_GROUP_H
+#define SSCE_HASHSET_GROUP_H
+/**
+* @file
+* @brief Common code for matching groups of HashSet control bytes.
+*/
+
+#include <Macros.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Control bytes of the open addressing engine.
+ * Full slots store a 7 bit fragment of their hash, so the high bit is clear.
+ */
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xfe)
+#define ctrl_is_full(c) (((c)&0x80) == 0)
+
+/*
+ * Biggest group width of any implementation.
+ * Control arrays have this many bytes minus one cloned at their end,
+ * so that groups can be loaded without wrapping around.
+ */
+#define HASHSET_GROUP_MAX 32
+
+/**
+ * Result of matching a group of control bytes.
+ * Bit i refers to the i-th control byte of the group.
+ */
+typedef struct {
+  // Slots whose fragment matches.
+  uint32_t match;
+  // Slots which are empty.
+  uint32_t empty;
+  // Slots which are either empty or deleted.
+  uint32_t vacant;
+} GroupMask;
+
+typedef GroupMask(hashset_group_match_t)(const uint8_t* ctrl, uint8_t fragment);
+
+/**
+ * A group matching implementation.
+ */
+typedef struct {
+  // How many control bytes are matched at once.
+  size_t width;
+  hashset_group_match_t* match;
+} HashSetGroup;
+
+/*
+ * Portable implementation, which treats 8 control bytes as one word.
+ * Matches may have false positives, which is fine as every match is verified.
+ */
+#define GROUP_LSBS ((uint64_t)0x0101010101010101)
+#define GROUP_MSBS ((uint64_t)0x8080808080808080)
+
+static inline uint32_t group_compress_msbs(uint64_t m) {
+  return (uint32_t)((((m >> 7) * (uint64_t)0x0102040810204080) >> 56) & 0xff);
+}
+
+static inline GroupMask hashset_group_match_generic(const uint8_t* ctrl, uint8_t fragment) {
+  uint64_t word;
+  memcpy(&word, ctrl, sizeof(uint64_t));
+  #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+  #endif
+  uint64_t x = word ^ (GROUP_LSBS * fragment);
+  GroupMask r;
+  r.match = group_compress_msbs((x - GROUP_LSBS) & ~x & GROUP_MSBS);
+  r.empty = group_compress_msbs(word & ~(word << 6) & GROUP_MSBS);
+  r.vacant = group_compress_msbs(word & GROUP_MSBS);
+  return r;
+}
+
+/**
+ * Internal usage only.
+ * Selects the best implementation for the current cpu.
+ */
+const HashSetGroup* internal_hashset_resolve_group();
+
+#endif /*SSCE_HASHSET_GROUP_H*/
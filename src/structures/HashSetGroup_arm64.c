@@ -0,0 +1,16 @@
+#include "HashSetGroup.h"
+
+#include <Macros.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+static GroupMask hashset_group_match_generic8(const uint8_t* ctrl, uint8_t fragment) {
+  return hashset_group_match_generic(ctrl, fragment);
+}
+
+static const HashSetGroup GROUP_GENERIC = {8, hashset_group_match_generic8};
+
+MARK_COLD const HashSetGroup* internal_hashset_resolve_group() {
+  return &GROUP_GENERIC;
+}
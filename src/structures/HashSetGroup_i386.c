@@ -0,0 +1,35 @@
+#include "HashSetGroup.h"
+
+#include <Macros.h>
+#include <Runtime.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+static GroupMask hashset_group_match_generic8(const uint8_t* ctrl, uint8_t fragment) {
+  return hashset_group_match_generic(ctrl, fragment);
+}
+
+TARGET_EXT(sse2) static GroupMask hashset_group_match_sse2(const uint8_t* ctrl, uint8_t fragment) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  GroupMask r;
+  r.match = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(fragment)));
+  r.empty = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(CTRL_EMPTY)));
+  r.vacant = _mm_movemask_epi8(group);
+  return r;
+}
+
+static const HashSetGroup GROUP_GENERIC = {8, hashset_group_match_generic8};
+static const HashSetGroup GROUP_SSE2 = {16, hashset_group_match_sse2};
+
+MARK_COLD const HashSetGroup* internal_hashset_resolve_group() {
+  Runtime* features = ssce_get_runtime();
+  if(features->cpu_x86_sse2) {
+    EARLY_TRACE("Selecting hashset_group_match_sse2");
+    return &GROUP_SSE2;
+  } else {
+    EARLY_TRACE("Selecting hashset_group_match_generic");
+    return &GROUP_GENERIC;
+  }
+}
@@ -0,0 +1,42 @@
+#include "HashSetGroup.h"
+
+#include <Macros.h>
+#include <Runtime.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+TARGET_EXT(sse2) static GroupMask hashset_group_match_sse2(const uint8_t* ctrl, uint8_t fragment) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  GroupMask r;
+  r.match = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(fragment)));
+  r.empty = _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(CTRL_EMPTY)));
+  r.vacant = _mm_movemask_epi8(group);
+  return r;
+}
+
+TARGET_EXT(avx2) static GroupMask hashset_group_match_avx2(const uint8_t* ctrl, uint8_t fragment) {
+  __m256i group = _mm256_loadu_si256((const __m256i*)ctrl);
+  GroupMask r;
+  r.match = _mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8(fragment)));
+  r.empty = _mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8(CTRL_EMPTY)));
+  r.vacant = _mm256_movemask_epi8(group);
+  _mm256_zeroupper();
+  return r;
+}
+
+static const HashSetGroup GROUP_SSE2 = {16, hashset_group_match_sse2};
+static const HashSetGroup GROUP_AVX2 = {32, hashset_group_match_avx2};
+
+MARK_COLD const HashSetGroup* internal_hashset_resolve_group() {
+  Runtime* features = ssce_get_runtime();
+  if(features->cpu_x86_avx2) {
+    EARLY_TRACE("Selecting hashset_group_match_avx2");
+    return &GROUP_AVX2;
+  } else {
+    // x86_64 always supports SSE2
+    EARLY_TRACE("Selecting hashset_group_match_sse2");
+    return &GROUP_SSE2;
+  }
+}
@@ -3,7 +3,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <Config.h>
 #include <Interface.h>
+#include <Runtime.h>
 #include <SStrings.h>
 
 #define heap_parent_index(i) ((i - 1) / 2)
@@ -14,8 +16,10 @@
  * The address of the left child of element e is going to be:
  * = array + child_index*size
  * = array + 2*size*[(e-array)/size] + size
+ * Keys are offset from elements, so for the key k of e:
+ * = 2*k - array - offset + size
  */
-#define heap_child_cache(a, dti) (uintptr_t)(dti->offset + dti->size - (uintptr_t)a)
+#define heap_child_cache(a, dti) (uintptr_t)(dti->size - dti->offset - (uintptr_t)a)
 #define heap_left(e, c) (void*)(2 * (uintptr_t)e + c)
 #define heap_right(left, dti) add_offset(left, dti->size)
 
@@ -50,11 +54,121 @@ void heap_sift_down(void* array, void* start, void* end, const IDataType* interf
   }
 }
 
+void* heap_sift_up(void* array, void* element, const IDataType* interface) {
+  size_t index = ((uintptr_t)element - (uintptr_t)array) / interface->size;
+  while(index != 0) {
+    size_t parent_index = heap_parent_index(index);
+    void* parent = dti_element(interface, array, parent_index);
+    if(!interface->cmp_l(interface, add_offset(parent, interface->offset), add_offset(element, interface->offset))) {
+      // Heap property holds.
+      break;
+    }
+    interface->swap(interface, parent, element);
+    element = parent;
+    index = parent_index;
+  }
+  return element;
+}
+
 void heap_create(void* array, size_t size, const IDataType* interface) {
+  if(size < 2) {
+    // Already a heap.
+    return;
+  }
   size_t start = heap_parent_index(size - 1) + 1;
   do {
     start -= 1;
     heap_sift_down(array, dti_element(interface, array, start),
                    dti_element(interface, array, size - 1), interface);
   } while(start != 0);
-}
\ No newline at end of file
+}
+/*
+ * d-ary heaps.
+ * Children of element i are at [i*arity + 1, i*arity + arity],
+ * so picking the greatest child compares neighbouring elements,
+ * which are loaded together when they share a cache line.
+ */
+
+#define heap_key(dti, e) add_offset(e, dti->offset)
+
+size_t heap_arity(const IDataType* interface) {
+  Runtime* rt = ssce_get_runtime();
+  size_t line = rt->cpu_cache_alignment != 0 ? rt->cpu_cache_alignment : 64;
+  size_t arity = 2;
+  // Keep power of two, so that siblings never span more cache lines than needed.
+  while(arity * 2 <= STRUCTURES_HEAP_MAX_ARITY && arity * 2 * interface->size <= line) {
+    arity *= 2;
+  }
+  return arity;
+}
+
+void heap_sift_down_d(void* array, void* start, void* end, size_t arity, const IDataType* interface) {
+  if(arity == 2) {
+    heap_sift_down(array, start, end, interface);
+    return;
+  }
+  size_t es = interface->size;
+  char* base = array;
+  size_t index = ((uintptr_t)start - (uintptr_t)array) / es;
+  size_t last = ((uintptr_t)end - (uintptr_t)array) / es;
+  char* root = start;
+  while(last != 0 && index <= (last - 1) / arity) {
+    size_t first = index * arity + 1;
+    size_t stop = first + arity - 1;
+    if(stop > last) {
+      stop = last;
+    }
+    char* child = base + first * es;
+    char* swap = root;
+    size_t swap_index = index;
+    for(size_t c = first; c <= stop; c++, child += es) {
+      if(interface->cmp_l(interface, heap_key(interface, swap), heap_key(interface, child))) {
+        swap = child;
+        swap_index = c;
+      }
+    }
+    if(swap == root) {
+      // Exit.
+      return;
+    }
+    interface->swap(interface, root, swap);
+    root = swap;
+    index = swap_index;
+  }
+}
+
+void* heap_sift_up_d(void* array, void* element, size_t arity, const IDataType* interface) {
+  if(arity == 2) {
+    return heap_sift_up(array, element, interface);
+  }
+  size_t index = ((uintptr_t)element - (uintptr_t)array) / interface->size;
+  while(index != 0) {
+    size_t parent_index = (index - 1) / arity;
+    void* parent = dti_element(interface, array, parent_index);
+    if(!interface->cmp_l(interface, heap_key(interface, parent), heap_key(interface, element))) {
+      // Heap property holds.
+      break;
+    }
+    interface->swap(interface, parent, element);
+    element = parent;
+    index = parent_index;
+  }
+  return element;
+}
+
+void heap_create_d(void* array, size_t size, size_t arity, const IDataType* interface) {
+  if(arity == 2) {
+    heap_create(array, size, interface);
+    return;
+  }
+  if(size < 2) {
+    // Already a heap.
+    return;
+  }
+  void* end = dti_element(interface, array, size - 1);
+  size_t start = (size - 2) / arity + 1;
+  do {
+    start -= 1;
+    heap_sift_down_d(array, dti_element(interface, array, start), end, arity, interface);
+  } while(start != 0);
+}
@@ -20,6 +20,19 @@
  */
 EXPORT_API void heap_sift_down(void* array, void* start, void* end, const IDataType* interface);
 
+/**
+ * Moves an element towards the root,
+ * until its parent is no longer smaller than it.
+ * Used for inserting into a heap.
+ * 
+ * @param array A pointer to the start of the heap.
+ * @param element A pointer to the element to move.
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ * @returns a pointer to the final position of the element.
+ */
+EXPORT_API void* heap_sift_up(void* array, void* element, const IDataType* interface);
+
 /**
  * Given an array, move the elements around so the array is also a heap.
  * By default it generates a max heap.
@@ -31,4 +44,50 @@ EXPORT_API void heap_sift_down(void* array, void* start, void* end, const IDataT
  */
 EXPORT_API void heap_create(void* array, size_t size, const IDataType* interface);
 
+/**
+ * Picks how many children each element of a d-ary heap should have,
+ * so that all children of an element fit in a single cache line.
+ * The result is a power of two, from 2 up to STRUCTURES_HEAP_MAX_ARITY.
+ * 
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ * @returns the arity to use with the *_d heap functions.
+ */
+EXPORT_API size_t heap_arity(const IDataType* interface) MARK_NONNULL_ARGS(1);
+
+/**
+ * Same as \ref heap_sift_down, but for a heap where every element has \p arity children.
+ * 
+ * @param array A pointer to the start of the heap.
+ * @param start A pointer to the root element.
+ * @param end A pointer to the end of the tree.
+ * @param arity How many children every element has. At least 2.
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ */
+EXPORT_API void heap_sift_down_d(void* array, void* start, void* end, size_t arity, const IDataType* interface);
+
+/**
+ * Same as \ref heap_sift_up, but for a heap where every element has \p arity children.
+ * 
+ * @param array A pointer to the start of the heap.
+ * @param element A pointer to the element to move.
+ * @param arity How many children every element has. At least 2.
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ * @returns a pointer to the final position of the element.
+ */
+EXPORT_API void* heap_sift_up_d(void* array, void* element, size_t arity, const IDataType* interface);
+
+/**
+ * Same as \ref heap_create, but for a heap where every element has \p arity children.
+ * 
+ * @param array A pointer to the start of the array.
+ * @param size Element count.
+ * @param arity How many children every element has. At least 2.
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ */
+EXPORT_API void heap_create_d(void* array, size_t size, size_t arity, const IDataType* interface);
+
 #endif /*SSCE_HEAP_H*/
\ No newline at end of file
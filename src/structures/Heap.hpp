@@ -3,6 +3,7 @@
 /**
  * @file
  * @brief Binary heap implementation.
+ * Unlike the C heap, there are no d-ary versions like \ref heap_sift_down_d.
  */
 
 #include <Macros.h>
@@ -12,9 +13,65 @@ C_DECLS_END
 
 #include <Interface.hpp>
 
+#include <cstddef>
+#include <functional>
+#include <utility>
+
 namespace ssce {
 
-// TODO:
+/**
+ * Same as the binary C \ref heap_sift_down, but \p less and swaps get inlined.
+ *
+ * @param array A pointer to the start of the heap.
+ * @param start A pointer to the root element.
+ * @param end A pointer to the last element of the tree.
+ * @param less Strict weak ordering of elements.
+ */
+template<typename T, typename Compare = std::less<T>>
+inline void heap_sift_down(T* array, T* start, T* end, Compare less = Compare()) {
+  using std::swap;
+  std::size_t last = end - array;
+  std::size_t root = start - array;
+  while(2 * root + 1 <= last) {
+    std::size_t child = 2 * root + 1;
+    std::size_t target = root;
+    // Test left child.
+    if(less(array[target], array[child])) {
+      target = child;
+    }
+    // Test right child.
+    child++;
+    if(child <= last && less(array[target], array[child])) {
+      target = child;
+    }
+    if(target == root) {
+      // Exit.
+      return;
+    }
+    swap(array[root], array[target]);
+    root = target;
+  }
+}
+
+/**
+ * Same as the C \ref heap_create, but \p less and swaps get inlined.
+ * Generates a max heap with the default \p less.
+ *
+ * @param array A pointer to the start of the array.
+ * @param size Element count.
+ * @param less Strict weak ordering of elements.
+ */
+template<typename T, typename Compare = std::less<T>>
+inline void heap_create(T* array, std::size_t size, Compare less = Compare()) {
+  if(size < 2) {
+    return;
+  }
+  std::size_t start = (size - 2) / 2 + 1;
+  do {
+    start -= 1;
+    heap_sift_down(array, array + start, array + size - 1, less);
+  } while(start != 0);
+}
 
 } // namespace ssce
 #endif /*SSCE_HEAP_HPP*/
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #include <Macros.h>
 
+#include <limits.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -37,6 +38,27 @@ typedef void (*Operate)(const IDataType*, void*, void*);
  */
 typedef size_t (*Calculate)(const IDataType*, const void*);
 
+/**
+ * How the bytes of a key can be interpreted,
+ * so that algorithms can work on keys directly, instead of calling \ref Compare functions.
+ * Keys are in native byte order.
+ */
+typedef enum {
+  /** Nothing is known about the key, only \ref Compare functions may be used. */
+  KEY_KIND_OPAQUE = 0,
+  /** Unsigned integer of 1, 2, 4 or 8 bytes. */
+  KEY_KIND_UNSIGNED,
+  /** Two's complement signed integer of 1, 2, 4 or 8 bytes. */
+  KEY_KIND_SIGNED,
+  /**
+   * IEEE 754 float or double.
+   * -0.0 and +0.0 are equal.
+   * NaNs have no consistent order with \ref Compare functions,
+   * so keys must not be NaN.
+   */
+  KEY_KIND_FLOAT
+} KeyKind;
+
 /**
  * An interface for abstract data types.
  * Every element is of \ref size bytes.
@@ -65,6 +87,12 @@ struct IDataType {
   Operate swap;
   /** A pointer to a function which calculates the hash of a key */
   Calculate hash;
+  /**
+   * How the key can be interpreted.
+   * Must be consistent with the \ref Compare functions.
+   * Left out initializers leave it at \ref KEY_KIND_OPAQUE.
+   */
+  KeyKind key_kind;
 };
 
 #define add_offset(p, offset) (void*)(((char*)p) + offset)
@@ -74,4 +102,68 @@ struct IDataType {
 #define dti_previous(dti, item) add_offset(item, (-dti->size))
 #define dti_next(dti, item) add_offset(item, (dti->size))
 
+/**
+ * Checks if keys of \p dti can be mapped with \ref dti_ordered_key.
+ */
+static inline int dti_has_ordered_key(const IDataType* dti) {
+  switch(dti->key_kind) {
+    case KEY_KIND_UNSIGNED:
+    case KEY_KIND_SIGNED:
+      return dti->key_size == 1 || dti->key_size == 2 || dti->key_size == 4 || dti->key_size == 8;
+    case KEY_KIND_FLOAT:
+      return dti->key_size == sizeof(float) || dti->key_size == sizeof(double);
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Maps the key at \p key_address to an unsigned integer, which orders the same way.
+ * Receives a pointer to the key(offset preapplied).
+ * Both float zeros map to the same integer.
+ * NaNs map past the infinities with the same sign, but see \ref KEY_KIND_FLOAT.
+ */
+static inline uint64_t dti_ordered_key(const IDataType* dti, const void* key_address) {
+  // The library is built with -fno-builtin-memcpy, but these copies must become plain loads.
+  uint64_t key;
+  switch(dti->key_size) {
+    case 1: {
+      uint8_t v;
+      __builtin_memcpy(&v, key_address, sizeof(v));
+      key = v;
+      break;
+    }
+    case 2: {
+      uint16_t v;
+      __builtin_memcpy(&v, key_address, sizeof(v));
+      key = v;
+      break;
+    }
+    case 4: {
+      uint32_t v;
+      __builtin_memcpy(&v, key_address, sizeof(v));
+      key = v;
+      break;
+    }
+    default:
+      __builtin_memcpy(&key, key_address, sizeof(key));
+      break;
+  }
+  uint64_t sign = UINT64_C(1) << (dti->key_size * CHAR_BIT - 1);
+  if(dti->key_kind == KEY_KIND_SIGNED) {
+    // Negative numbers go before positive ones.
+    key ^= sign;
+  }
+  else if(dti->key_kind == KEY_KIND_FLOAT) {
+    // Negative floats are stored as sign and magnitude, so their order is reversed.
+    uint64_t mask = sign | (sign - 1);
+    if(key == sign) {
+      // -0.0 equals +0.0.
+      key = 0;
+    }
+    key = (key & sign) ? (~key & mask) : (key | sign);
+  }
+  return key;
+}
+
 #endif /*SSCE_INTERFACE_H*/
\ No newline at end of file
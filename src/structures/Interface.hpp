@@ -12,6 +12,8 @@ C_DECLS_END
 
 #include <cstddef>
 #include <functional>
+#include <type_traits>
+#include <utility>
 
 namespace ssce {
 
@@ -23,72 +25,75 @@ class IDataTypeCpp {
  private:
   /**
    * Maps directly to \ref IDataType.cmp_eq
-   * Override to change default behaviour.
    */
-  virtual int compare_equal(const IDataType* idt, const void* ap, const void* bp) {
+  static int compare_equal(MARK_UNUSED const IDataType* idt, const void* ap, const void* bp) {
     // Convert pointers to references.
-    T& a = *((T*)ap);
-    T& b = *((T*)bp);
-    return std::equal<T>()(a, b);
+    const T& a = *((const T*)ap);
+    const T& b = *((const T*)bp);
+    return std::equal_to<T>()(a, b);
   }
   /**
    * Maps directly to \ref IDataType.cmp_l
-   * Override to change default behaviour.
    */
-  virtual int compare_less(const IDataType* idt, const void* ap, const void* bp) {
+  static int compare_less(MARK_UNUSED const IDataType* idt, const void* ap, const void* bp) {
     // Convert pointers to references.
-    T& a = *((T*)ap);
-    T& b = *((T*)bp);
+    const T& a = *((const T*)ap);
+    const T& b = *((const T*)bp);
     return std::less<T>()(a, b);
   }
   /**
    * Maps directly to \ref IDataType.cmp_le
-   * Override to change default behaviour.
    */
-  virtual int compare_less_equal(const IDataType* idt, const void* ap, const void* bp) {
+  static int compare_less_equal(MARK_UNUSED const IDataType* idt, const void* ap, const void* bp) {
     // Convert pointers to references.
-    T& a = *((T*)ap);
-    T& b = *((T*)bp);
+    const T& a = *((const T*)ap);
+    const T& b = *((const T*)bp);
     return std::less_equal<T>()(a, b);
   }
   /**
    * Maps directly to \ref IDataType.swap
-   * Override to change default behaviour.
    */
-  virtual void operation_swap(const IDataType* idt, void* ap, void* bp) {
+  static void operation_swap(MARK_UNUSED const IDataType* idt, void* ap, void* bp) {
     // Convert pointers to references.
-    T& ar = *((T*)ap);
-    T& br = *((T*)bp);
-    T a = ar;
-    T b = br;
-    ar = b;
-    br = a;
+    T& a = *((T*)ap);
+    T& b = *((T*)bp);
+    std::swap(a, b);
   }
   /**
    * Maps directly to \ref IDataType.hash
-   * Override to change default behaviour.
    */
-  virtual std::size_t operation_hash(const IDataType* idt, const void* kp) {
+  static std::size_t operation_hash(MARK_UNUSED const IDataType* idt, const void* kp) {
     // Convert pointers to references.
-    T& k = *((T*)kp);
+    const T& k = *((const T*)kp);
     return std::hash<T>()(k);
   }
+  /**
+   * Maps to \ref IDataType.key_kind
+   */
+  static constexpr KeyKind key_kind() {
+    return std::is_floating_point<T>::value ? KEY_KIND_FLOAT
+           : !std::is_integral<T>::value    ? KEY_KIND_OPAQUE
+           : std::is_signed<T>::value       ? KEY_KIND_SIGNED
+                                            : KEY_KIND_UNSIGNED;
+  }
+
  public:
   /**
    * Constructs an \ref IDataType from the current template.
    */
-  MARK_CONST IDataType constructIDataType() {
-    IDataType ret = { sizeof(T),
-                      0,
-                      sizeof(T),
-                      this->compare_equal,
-                      this->compare_less,
-                      this->compare_less_equal,
-                      this->operation_less
-    }
+  MARK_CONST IDataType constructIDataType() const {
+    IDataType ret = {sizeof(T),
+                     0,
+                     sizeof(T),
+                     compare_equal,
+                     compare_less,
+                     compare_less_equal,
+                     operation_swap,
+                     operation_hash,
+                     key_kind()};
     return ret;
   }
-}
+};
 
 }  // namespace ssce
 #endif /*SSCE_INTERFACE_HPP*/
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "PriorityQueue.h"
+
+#include <Macros.h>
+#include <Runtime.h>
+#include <memory/GAlloc.h>
+#include <structures/Heap.h>
+#include <structures/Interface.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Smallest amount of elements to allocate space for.
+ */
+#define MIN_CAPACITY 16
+
+struct PriorityQueue;
+
+/*
+ * Interface used with the heap primitives.
+ * Swaps also keep the positions of handles up to date.
+ */
+typedef struct {
+  IDataType dti;
+  const IDataType* old;
+  struct PriorityQueue* pq;
+} PQDataType;
+
+/*
+ * Implementation details:
+ * The heap stores records, which are a handle followed by the element.
+ * Records start one record before a cache line boundary, so the children of the root start at a cache line.
+ * The children of every record start at a cache line too
+ * only when the arity times the record size is a multiple of the line size.
+ * positions[handle] is the heap index of the record with that handle,
+ * or for handles not in use, the next unused handle.
+ */
+struct PriorityQueue {
+  // Start of allocated memory block.
+  char* allocated;
+  // Heap of records, inside the allocated block.
+  char* records;
+  // Amount of elements currently stored.
+  size_t length;
+  // Amount of records allocated.
+  size_t capacity;
+  // Heap index of each handle.
+  size_t* positions;
+  // Handles given out so far.
+  size_t handle_count;
+  // Allocated length of positions.
+  size_t handle_capacity;
+  // First unused handle below handle_count.
+  size_t free_handle;
+  // Children of every heap element.
+  size_t arity;
+  // Cache line size.
+  size_t alignment;
+  // Interface of records.
+  PQDataType record_interface;
+};
+
+/*
+ * Internal functions.
+ */
+
+#define RECORD_HEADER sizeof(size_t)
+
+#define internal_record(pq, index) (pq->records + (index)*pq->record_interface.dti.size)
+#define internal_record_data(record) ((record) + RECORD_HEADER)
+
+static inline size_t internal_record_handle(const char* record) {
+  size_t handle;
+  memcpy(&handle, record, sizeof(size_t));
+  return handle;
+}
+
+static inline void internal_record_set_handle(char* record, size_t handle) {
+  memcpy(record, &handle, sizeof(size_t));
+}
+
+static inline size_t internal_record_index(PriorityQueue* pq, const char* record) {
+  return (size_t)(record - pq->records) / pq->record_interface.dti.size;
+}
+
+static int internal_record_cmp_l(const PQDataType* dti, const void* a, const void* b) {
+  return dti->old->cmp_l(dti->old, a, b);
+}
+
+static void internal_record_swap(const PQDataType* dti, char* a, char* b) {
+  PriorityQueue* pq = dti->pq;
+  dti->old->swap(dti->old, internal_record_data(a), internal_record_data(b));
+  size_t handle_a = internal_record_handle(a);
+  size_t handle_b = internal_record_handle(b);
+  internal_record_set_handle(a, handle_b);
+  internal_record_set_handle(b, handle_a);
+  pq->positions[handle_b] = internal_record_index(pq, a);
+  pq->positions[handle_a] = internal_record_index(pq, b);
+}
+
+/**
+ * Makes space for at least \p records elements and \p handles handles.
+ */
+static int internal_priority_queue_reserve(PriorityQueue* pq, size_t records, size_t handles) {
+  if(records > pq->capacity) {
+    size_t capacity = pq->capacity * 2;
+    if(capacity < records) {
+      capacity = records;
+    }
+    if(capacity < MIN_CAPACITY) {
+      capacity = MIN_CAPACITY;
+    }
+    size_t record_size = pq->record_interface.dti.size;
+    size_t padding = pq->records - pq->allocated;
+    char* new_allocated = realloc(pq->allocated, capacity * record_size + pq->alignment);
+    if(new_allocated == NULL) {
+      return 1;
+    }
+    uintptr_t children = ((uintptr_t)new_allocated + record_size + pq->alignment - 1) & ~(uintptr_t)(pq->alignment - 1);
+    char* new_records = (char*)(children - record_size);
+    if(new_records != new_allocated + padding) {
+      // Realloc does not keep alignment.
+      memmove(new_records, new_allocated + padding, pq->length * record_size);
+    }
+    pq->allocated = new_allocated;
+    pq->records = new_records;
+    pq->capacity = capacity;
+  }
+  if(handles > pq->handle_capacity) {
+    size_t capacity = pq->handle_capacity * 2;
+    if(capacity < handles) {
+      capacity = handles;
+    }
+    if(capacity < MIN_CAPACITY) {
+      capacity = MIN_CAPACITY;
+    }
+    size_t* new_positions = realloc(pq->positions, capacity * sizeof(size_t));
+    if(new_positions == NULL) {
+      return 1;
+    }
+    pq->positions = new_positions;
+    pq->handle_capacity = capacity;
+  }
+  return 0;
+}
+
+/**
+ * Appends an element at the end of the heap, without restoring the heap property.
+ * Space must have already been reserved.
+ */
+static inline char* internal_priority_queue_append(PriorityQueue* pq, const void* value, size_t* handle_out) {
+  size_t handle = pq->free_handle;
+  if(handle != INVALID_SIZE_T) {
+    pq->free_handle = pq->positions[handle];
+  }
+  else {
+    handle = pq->handle_count++;
+  }
+  char* record = internal_record(pq, pq->length);
+  internal_record_set_handle(record, handle);
+  memcpy(internal_record_data(record), value, pq->record_interface.old->size);
+  pq->positions[handle] = pq->length;
+  pq->length++;
+  *handle_out = handle;
+  return record;
+}
+
+/**
+ * Returns the record of \p handle, or null if it is not in use.
+ */
+static inline char* internal_priority_queue_lookup(PriorityQueue* pq, size_t handle) {
+  if(handle >= pq->handle_count) {
+    return NULL;
+  }
+  size_t index = pq->positions[handle];
+  if(index >= pq->length) {
+    return NULL;
+  }
+  char* record = internal_record(pq, index);
+  // Unused handles store the next unused handle, which may happen to be a valid index.
+  return internal_record_handle(record) == handle ? record : NULL;
+}
+
+/*
+ * Interface | Public Api.
+ */
+
+PriorityQueue* priority_queue_create(const IDataType* dti, size_t capacity, size_t arity) {
+  PriorityQueue* obj = malloc(sizeof(PriorityQueue));
+  if(obj != NULL) {
+    size_t element_size = (dti->size + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+    obj->allocated = NULL;
+    obj->records = NULL;
+    obj->length = 0;
+    obj->capacity = 0;
+    obj->positions = NULL;
+    obj->handle_count = 0;
+    obj->handle_capacity = 0;
+    obj->free_handle = INVALID_SIZE_T;
+    obj->record_interface.dti = (IDataType){RECORD_HEADER + element_size,
+                                            RECORD_HEADER + dti->offset,
+                                            dti->key_size,
+                                            NULL,
+                                            (Compare)internal_record_cmp_l,
+                                            NULL,
+                                            (Operate)internal_record_swap,
+                                            NULL,
+                                            dti->key_kind};
+    obj->record_interface.old = dti;
+    obj->record_interface.pq = obj;
+    obj->arity = arity != 0 ? arity : heap_arity(&obj->record_interface.dti);
+    size_t alignment = ssce_get_runtime()->cpu_cache_alignment;
+    obj->alignment = alignment != 0 ? alignment : 64;
+    if(capacity != 0 && internal_priority_queue_reserve(obj, capacity, capacity)) {
+      priority_queue_destroy(obj);
+      return NULL;
+    }
+  }
+  return obj;
+}
+
+size_t priority_queue_size(PriorityQueue* pq) {
+  return pq->length;
+}
+
+size_t priority_queue_push(PriorityQueue* pq, const void* value) {
+  if(COLD_BRANCH(internal_priority_queue_reserve(pq, pq->length + 1, pq->handle_count + 1))) {
+    return INVALID_SIZE_T;
+  }
+  size_t handle;
+  char* record = internal_priority_queue_append(pq, value, &handle);
+  heap_sift_up_d(pq->records, record, pq->arity, &pq->record_interface.dti);
+  return handle;
+}
+
+int priority_queue_push_many(PriorityQueue* pq, const void* array, size_t count, size_t* handles) {
+  if(count == 0) {
+    return 0;
+  }
+  if(internal_priority_queue_reserve(pq, pq->length + count, pq->handle_count + count)) {
+    return 1;
+  }
+  const IDataType* dti = pq->record_interface.old;
+  size_t old_length = pq->length;
+  size_t handle;
+  for(size_t i = 0; i < count; i++) {
+    internal_priority_queue_append(pq, dti_element(dti, array, i), &handle);
+    if(handles != NULL) {
+      handles[i] = handle;
+    }
+  }
+  if(count > old_length) {
+    // Rebuilding takes linear time.
+    heap_create_d(pq->records, pq->length, pq->arity, &pq->record_interface.dti);
+  }
+  else {
+    for(size_t i = old_length; i < pq->length; i++) {
+      heap_sift_up_d(pq->records, internal_record(pq, i), pq->arity, &pq->record_interface.dti);
+    }
+  }
+  return 0;
+}
+
+int priority_queue_peek(PriorityQueue* pq, void* result) {
+  if(COLD_BRANCH(pq->length == 0)) {
+    return 1;
+  }
+  memcpy(result, internal_record_data(pq->records), pq->record_interface.old->size);
+  return 0;
+}
+
+int priority_queue_pop(PriorityQueue* pq, void* result) {
+  if(COLD_BRANCH(pq->length == 0)) {
+    return 1;
+  }
+  char* top = pq->records;
+  if(result != NULL) {
+    memcpy(result, internal_record_data(top), pq->record_interface.old->size);
+  }
+  // Release handle.
+  size_t handle = internal_record_handle(top);
+  pq->positions[handle] = pq->free_handle;
+  pq->free_handle = handle;
+  pq->length--;
+  if(pq->length != 0) {
+    // Move last element to the top, and restore heap property.
+    char* last = internal_record(pq, pq->length);
+    memcpy(top, last, pq->record_interface.dti.size);
+    pq->positions[internal_record_handle(top)] = 0;
+    heap_sift_down_d(pq->records, top, internal_record(pq, pq->length - 1), pq->arity, &pq->record_interface.dti);
+  }
+  return 0;
+}
+
+int priority_queue_update(PriorityQueue* pq, size_t handle, const void* value) {
+  char* record = internal_priority_queue_lookup(pq, handle);
+  if(record == NULL) {
+    return 1;
+  }
+  memcpy(internal_record_data(record), value, pq->record_interface.old->size);
+  // Only one of these can actually move the element.
+  record = heap_sift_up_d(pq->records, record, pq->arity, &pq->record_interface.dti);
+  heap_sift_down_d(pq->records, record, internal_record(pq, pq->length - 1), pq->arity, &pq->record_interface.dti);
+  return 0;
+}
+
+int priority_queue_get(PriorityQueue* pq, size_t handle, void* result) {
+  char* record = internal_priority_queue_lookup(pq, handle);
+  if(record == NULL) {
+    return 1;
+  }
+  memcpy(result, internal_record_data(record), pq->record_interface.old->size);
+  return 0;
+}
+
+void priority_queue_clear(PriorityQueue* pq) {
+  pq->length = 0;
+  pq->handle_count = 0;
+  pq->free_handle = INVALID_SIZE_T;
+}
+
+void priority_queue_destroy(PriorityQueue* pq) {
+  free(pq->allocated);
+  free(pq->positions);
+  free(pq);
+}
@@ -0,0 +1,118 @@
+#ifndef SSCE_PRIORITY_QUEUE_H
+#define SSCE_PRIORITY_QUEUE_H
+/**
+ * @file
+ * @brief d-ary heap backed priority queue of fixed type elements.
+ */
+
+#include <Interface.h>
+#include <Macros.h>
+
+#include <stddef.h>
+
+/**
+ * Opaque structure containing internal data.
+ */
+struct PriorityQueue;
+typedef struct PriorityQueue PriorityQueue;
+
+/**
+ * Allocates a new empty PriorityQueue object.
+ * The greatest element, as defined by \ref IDataType.cmp_l, is always at the top.
+ * 
+ * @param dti A pointer to a \ref IDataType structure.
+ * @param capacity How many elements to allocate space for. May be 0.
+ * @param arity How many children every element of the heap has,
+ * or 0 to pick with \ref heap_arity, so that siblings share a cache line.
+ * @returns allocated object or null if we are out of memory.
+ */
+EXPORT_API MARK_OBJ_ALLOC PriorityQueue* priority_queue_create(const IDataType* dti, size_t capacity, size_t arity) MARK_NONNULL_ARGS(1);
+
+/**
+ * Returns the number of currently stored elements.
+ * 
+ * @param pq see \ref priority_queue_create.
+ * @returns the length of \p pq.
+ */
+EXPORT_API size_t priority_queue_size(PriorityQueue* pq) MARK_NONNULL_ARGS(1);
+
+/**
+ * Inserts a new element.
+ * 
+ * @param pq see \ref priority_queue_create.
+ * @param value pointer to the value to add.
+ * @returns a handle which refers to the new element until it gets popped,
+ * or \ref INVALID_SIZE_T if an error occurred.
+ */
+EXPORT_API size_t priority_queue_push(PriorityQueue* pq, const void* value) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Inserts many elements at once.
+ * When adding more elements than are already stored,
+ * the heap is rebuilt in linear time instead of inserting them one by one.
+ * 
+ * @param pq see \ref priority_queue_create.
+ * @param array pointer to the start of the array of the elements to add.
+ * @param count how many elements from \p array to add.
+ * @param handles where to write the handle of every added element. May be null.
+ * @returns non zero on error, in which case \p pq is not modified.
+ */
+EXPORT_API int priority_queue_push_many(PriorityQueue* pq, const void* array, size_t count, size_t* handles) MARK_NONNULL_ARGS(1);
+
+/**
+ * Retrieves the element at the top.
+ * 
+ * @param pq see \ref priority_queue_create.
+ * @param result where the element will be placed.
+ * @returns non zero if \p pq is empty.
+ */
+EXPORT_API int priority_queue_peek(PriorityQueue* pq, void* result) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Retrieves and removes the element at the top.
+ * Its handle becomes invalid.
+ * 
+ * @param pq see \ref priority_queue_create.
+ * @param result where the element will be placed. May be null.
+ * @returns non zero if \p pq is empty.
+ */
+EXPORT_API int priority_queue_pop(PriorityQueue* pq, void* result) MARK_NONNULL_ARGS(1);
+
+/**
+ * Replaces the value of a stored element, and moves it to its new place.
+ * Can both raise (decrease-key of a min-queue) and lower its priority.
+ * 
+ * @param pq see \ref priority_queue_create.
+ * @param handle returned by \ref priority_queue_push or \ref priority_queue_push_many.
+ * @param value pointer to the new value.
+ * @returns non zero if \p handle does not refer to a stored element.
+ */
+EXPORT_API int priority_queue_update(PriorityQueue* pq, size_t handle, const void* value) MARK_NONNULL_ARGS(1, 3);
+
+/**
+ * Retrieves a stored element.
+ * 
+ * @param pq see \ref priority_queue_create.
+ * @param handle returned by \ref priority_queue_push or \ref priority_queue_push_many.
+ * @param result where the element will be placed.
+ * @returns non zero if \p handle does not refer to a stored element.
+ */
+EXPORT_API int priority_queue_get(PriorityQueue* pq, size_t handle, void* result) MARK_NONNULL_ARGS(1, 3);
+
+/**
+ * Removes all elements, while keeping allocated memory.
+ * Every handle becomes invalid.
+ * 
+ * @param pq see \ref priority_queue_create.
+ */
+EXPORT_API void priority_queue_clear(PriorityQueue* pq) MARK_NONNULL_ARGS(1);
+
+/**
+ * Destroys a previously created priority queue,
+ * and frees all allocated memory.
+ * 
+ * @param pq see \ref priority_queue_create.
+ */
+EXPORT_API void priority_queue_destroy(PriorityQueue* pq) MARK_NONNULL_ARGS(1);
+
+#endif /*SSCE_PRIORITY_QUEUE_H*/
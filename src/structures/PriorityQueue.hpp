@@ -0,0 +1,18 @@
+#ifndef SSCE_PRIORITY_QUEUE_HPP
+#define SSCE_PRIORITY_QUEUE_HPP
+/**
+ * @file
+ * @brief d-ary heap backed priority queue of fixed type elements.
+ */
+
+#include <Macros.h>
+C_DECLS_START
+#include <PriorityQueue.h>
+C_DECLS_END
+
+namespace ssce {
+
+// TODO:
+
+} // namespace ssce
+#endif /*SSCE_PRIORITY_QUEUE_HPP*/
@@ -1,17 +1,691 @@
 #include "Sort.h"
 
+#include <Config.h>
 #include <Heap.h>
 #include <Interface.h>
+#include <Macros.h>
+#include <Runtime.h>
+#include <core/PosixThreads.h>
+#include <memory/FAlloc.h>
+#include <memory/GAlloc.h>
 
+#include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Allocates scratch space for sorting.
+ * The thread local stack is preferred, as it is faster to allocate from.
+ * Sets \p fast if it was used.
+ */
+static char* internal_scratch_alloc(size_t bytes, int* fast) {
+  char* scratch = falloc_malloc(bytes);
+  *fast = scratch != NULL;
+  if(scratch == NULL) {
+    scratch = malloc(bytes);
+  }
+  return scratch;
+}
+
+static void internal_scratch_free(char* scratch, int fast) {
+  if(fast) {
+    falloc_free(scratch);
+  }
+  else {
+    free(scratch);
+  }
+}
 
 void sort_heap(void* array, size_t size, const IDataType* interface) {
-  heap_create(array, size, interface);
+  if(size < 2) {
+    // Already sorted.
+    return;
+  }
+  // Wider heaps are shallower, and siblings share a cache line.
+  size_t arity = heap_arity(interface);
+  heap_create_d(array, size, arity, interface);
   void* first = dti_element(interface, array, 0);
   void* end = dti_element(interface, array, size - 1);
   while(end > array) {
     interface->swap(interface, end, first);
     end = dti_previous(interface, end);
-    heap_sift_down(array, first, end, interface);
+    heap_sift_down_d(array, first, end, arity, interface);
+  }
+}
+
+/*
+ * Pattern-defeating quicksort, see SortPdq.h.
+ */
+
+#define pdq_key(dti, e) add_offset(e, dti->offset)
+#define pdq_less(dti, a, b) dti->cmp_l(dti, pdq_key(dti, a), pdq_key(dti, b))
+#define pdq_count(dti, begin, end) ((size_t)((end) - (begin)) / dti->size)
+#define pdq_at(dti, begin, i) ((begin) + (i)*dti->size)
+
+#define PDQ_FUNCTION static inline
+#define PDQ_CONTEXT const IDataType*
+#define PDQ_POINTER char*
+#define PDQ_LESS(dti, a, b) pdq_less(dti, a, b)
+#define PDQ_SWAP(dti, a, b) dti->swap(dti, a, b)
+#define PDQ_FORWARD(dti, p, i) pdq_at(dti, p, i)
+#define PDQ_BACKWARD(dti, p, i) ((p) - (i)*dti->size)
+#define PDQ_COUNT(dti, begin, end) pdq_count(dti, begin, end)
+#define PDQ_HEAPSORT(dti, begin, n) sort_heap(begin, n, dti)
+#include "SortPdq.h"
+
+void sort_pdq(void* array, size_t size, const IDataType* interface) {
+  if(size < 2) {
+    // Already sorted.
+    return;
+  }
+  char* begin = array;
+  pdq_loop(interface, begin, pdq_at(interface, begin, size), pdq_bad_allowed(size), 1);
+}
+
+/*
+ * Timsort.
+ * Naturally occurring runs are found and extended to a minimum length with binary insertion sort,
+ * then adjacent runs are merged while keeping their lengths balanced.
+ * Merges gallop, when one run keeps winning, so nearly sorted input takes close to linear time.
+ */
+
+/*
+ * Enough for any array, as run lengths on the stack grow at least as fast as Fibonacci numbers.
+ */
+#define TIM_MAX_RUNS 85
+
+#define tim_less(dti, a, b) dti->cmp_l(dti, pdq_key(dti, a), pdq_key(dti, b))
+
+typedef struct {
+  const IDataType* dti;
+  // Merge buffer, big enough for half of the array.
+  char* buffer;
+  // Space for one element.
+  char* tmp;
+  size_t run_count;
+  char* run_start[TIM_MAX_RUNS];
+  size_t run_length[TIM_MAX_RUNS];
+} TimState;
+
+static inline size_t tim_min_run(size_t n) {
+  // Makes n / min_run a power of two, or slightly smaller than one.
+  size_t r = 0;
+  while(n >= 64) {
+    r |= n & 1;
+    n >>= 1;
+  }
+  return n + r;
+}
+
+/**
+ * How many elements of [base, base + n) should go before \p key.
+ * If \p after_equal, elements equal to \p key are counted too.
+ * Searches exponentially from the end of the range if \p from_end,
+ * otherwise from its start, and then does a binary search.
+ */
+static inline size_t tim_gallop(const IDataType* dti, const char* key, char* base, size_t n, int after_equal, int from_end) {
+  size_t lo = 0;
+  size_t hi = n;
+  #define tim_goes_before(i) (after_equal ? !tim_less(dti, key, pdq_at(dti, base, i)) : tim_less(dti, pdq_at(dti, base, i), key))
+  if(from_end) {
+    size_t dist = 1;
+    while(dist <= n && !tim_goes_before(n - dist)) {
+      hi = n - dist;
+      dist <<= 1;
+    }
+    lo = dist <= n ? n - dist + 1 : 0;
+  }
+  else {
+    size_t dist = 1;
+    while(dist <= n && tim_goes_before(dist - 1)) {
+      lo = dist;
+      dist <<= 1;
+    }
+    hi = dist <= n ? dist - 1 : n;
+  }
+  while(lo < hi) {
+    size_t middle = lo + (hi - lo) / 2;
+    if(tim_goes_before(middle)) {
+      lo = middle + 1;
+    }
+    else {
+      hi = middle;
+    }
+  }
+  #undef tim_goes_before
+  return lo;
+}
+
+/**
+ * Extends the sorted prefix [begin, begin + sorted) to [begin, begin + n).
+ */
+static void tim_binary_insertion_sort(TimState* ts, char* begin, size_t sorted, size_t n) {
+  const IDataType* dti = ts->dti;
+  size_t es = dti->size;
+  for(size_t i = sorted; i < n; i++) {
+    char* cur = pdq_at(dti, begin, i);
+    // After equal elements, to stay stable.
+    size_t pos = tim_gallop(dti, cur, begin, i, 1, 1);
+    if(pos != i) {
+      char* dst = pdq_at(dti, begin, pos);
+      memcpy(ts->tmp, cur, es);
+      memmove(dst + es, dst, (i - pos) * es);
+      memcpy(dst, ts->tmp, es);
+    }
+  }
+}
+
+/**
+ * Returns the length of the run starting at \p begin.
+ * Strictly descending runs get reversed, which keeps equal elements in order.
+ */
+static size_t tim_count_run(const IDataType* dti, char* begin, size_t n) {
+  size_t es = dti->size;
+  if(n < 2) {
+    return n;
+  }
+  size_t len = 2;
+  if(tim_less(dti, begin + es, begin)) {
+    while(len < n && tim_less(dti, pdq_at(dti, begin, len), pdq_at(dti, begin, len - 1))) {
+      len++;
+    }
+    for(char *lo = begin, *hi = pdq_at(dti, begin, len - 1); lo < hi; lo += es, hi -= es) {
+      dti->swap(dti, lo, hi);
+    }
+  }
+  else {
+    while(len < n && !tim_less(dti, pdq_at(dti, begin, len), pdq_at(dti, begin, len - 1))) {
+      len++;
+    }
+  }
+  return len;
+}
+
+/**
+ * Merges [a, a + na) with the following [b, b + nb), where na <= nb.
+ * The first run gets copied to the buffer, and merging happens front to back.
+ */
+static void tim_merge_lo(TimState* ts, char* a, size_t na, char* b, size_t nb) {
+  const IDataType* dti = ts->dti;
+  size_t es = dti->size;
+  memcpy(ts->buffer, a, na * es);
+  char* pa = ts->buffer;
+  char* end_a = pdq_at(dti, ts->buffer, na);
+  char* pb = b;
+  char* end_b = pdq_at(dti, b, nb);
+  char* dst = a;
+  while(pa < end_a && pb < end_b) {
+    // One element at a time, until a run keeps winning.
+    size_t wins_a = 0;
+    size_t wins_b = 0;
+    while(pa < end_a && pb < end_b && wins_a < STRUCTURES_SORT_MIN_GALLOP && wins_b < STRUCTURES_SORT_MIN_GALLOP) {
+      if(tim_less(dti, pb, pa)) {
+        memcpy(dst, pb, es);
+        pb += es;
+        wins_b++;
+        wins_a = 0;
+      }
+      else {
+        memcpy(dst, pa, es);
+        pa += es;
+        wins_a++;
+        wins_b = 0;
+      }
+      dst += es;
+    }
+    // Copy whole blocks, for as long as galloping pays off.
+    size_t k_a = STRUCTURES_SORT_MIN_GALLOP;
+    size_t k_b = STRUCTURES_SORT_MIN_GALLOP;
+    while(pa < end_a && pb < end_b && (k_a >= STRUCTURES_SORT_MIN_GALLOP || k_b >= STRUCTURES_SORT_MIN_GALLOP)) {
+      k_a = tim_gallop(dti, pb, pa, pdq_count(dti, pa, end_a), 1, 0);
+      memcpy(dst, pa, k_a * es);
+      dst += k_a * es;
+      pa += k_a * es;
+      if(pa == end_a) {
+        break;
+      }
+      k_b = tim_gallop(dti, pa, pb, pdq_count(dti, pb, end_b), 0, 0);
+      memmove(dst, pb, k_b * es);
+      dst += k_b * es;
+      pb += k_b * es;
+    }
+  }
+  // What is left of the second run is already in place.
+  memcpy(dst, pa, end_a - pa);
+}
+
+/**
+ * Merges [a, a + na) with the following [b, b + nb), where na > nb.
+ * The second run gets copied to the buffer, and merging happens back to front.
+ */
+static void tim_merge_hi(TimState* ts, char* a, MARK_UNUSED size_t na, char* b, size_t nb) {
+  const IDataType* dti = ts->dti;
+  size_t es = dti->size;
+  memcpy(ts->buffer, b, nb * es);
+  // Pointers one past the last unmerged element.
+  char* pa = b;
+  char* pb = pdq_at(dti, ts->buffer, nb);
+  char* dst = pdq_at(dti, b, nb);
+  while(pa > a && pb > ts->buffer) {
+    size_t wins_a = 0;
+    size_t wins_b = 0;
+    while(pa > a && pb > ts->buffer && wins_a < STRUCTURES_SORT_MIN_GALLOP && wins_b < STRUCTURES_SORT_MIN_GALLOP) {
+      dst -= es;
+      if(tim_less(dti, pb - es, pa - es)) {
+        pa -= es;
+        memcpy(dst, pa, es);
+        wins_a++;
+        wins_b = 0;
+      }
+      else {
+        pb -= es;
+        memcpy(dst, pb, es);
+        wins_b++;
+        wins_a = 0;
+      }
+    }
+    size_t k_a = STRUCTURES_SORT_MIN_GALLOP;
+    size_t k_b = STRUCTURES_SORT_MIN_GALLOP;
+    while(pa > a && pb > ts->buffer && (k_a >= STRUCTURES_SORT_MIN_GALLOP || k_b >= STRUCTURES_SORT_MIN_GALLOP)) {
+      // Elements of the first run which are bigger than the last of the second.
+      size_t rem_a = pdq_count(dti, a, pa);
+      k_a = rem_a - tim_gallop(dti, pb - es, a, rem_a, 1, 1);
+      dst -= k_a * es;
+      pa -= k_a * es;
+      memmove(dst, pa, k_a * es);
+      if(pa == a) {
+        break;
+      }
+      // Elements of the second run which are bigger or equal to the last of the first.
+      size_t rem_b = pdq_count(dti, ts->buffer, pb);
+      k_b = rem_b - tim_gallop(dti, pa - es, ts->buffer, rem_b, 0, 1);
+      dst -= k_b * es;
+      pb -= k_b * es;
+      memcpy(dst, pb, k_b * es);
+    }
+  }
+  // What is left of the first run is already in place.
+  memcpy(a, ts->buffer, pb - ts->buffer);
+}
+
+static void tim_merge_at(TimState* ts, size_t i) {
+  const IDataType* dti = ts->dti;
+  char* a = ts->run_start[i];
+  size_t na = ts->run_length[i];
+  char* b = ts->run_start[i + 1];
+  size_t nb = ts->run_length[i + 1];
+  ts->run_length[i] = na + nb;
+  if(i + 2 < ts->run_count) {
+    ts->run_start[i + 1] = ts->run_start[i + 2];
+    ts->run_length[i + 1] = ts->run_length[i + 2];
+  }
+  ts->run_count--;
+  // Elements of the first run, which are not bigger than the start of the second, are already in place.
+  size_t skip = tim_gallop(dti, b, a, na, 1, 0);
+  a = pdq_at(dti, a, skip);
+  na -= skip;
+  if(na == 0) {
+    return;
+  }
+  // Same for elements at the end of the second run, which are not smaller than the end of the first.
+  nb = tim_gallop(dti, pdq_at(dti, a, na - 1), b, nb, 0, 1);
+  if(nb == 0) {
+    return;
+  }
+  if(na <= nb) {
+    tim_merge_lo(ts, a, na, b, nb);
+  }
+  else {
+    tim_merge_hi(ts, a, na, b, nb);
+  }
+}
+
+/**
+ * Merges runs until every run is longer than the sum of the next two,
+ * and longer than the next one.
+ */
+static void tim_merge_collapse(TimState* ts) {
+  while(ts->run_count > 1) {
+    size_t n = ts->run_count - 2;
+    size_t* len = ts->run_length;
+    if((n > 0 && len[n - 1] <= len[n] + len[n + 1]) || (n > 1 && len[n - 2] <= len[n - 1] + len[n])) {
+      if(len[n - 1] < len[n + 1]) {
+        n--;
+      }
+    }
+    else if(len[n] > len[n + 1]) {
+      break;
+    }
+    tim_merge_at(ts, n);
+  }
+}
+
+int sort_tim(void* array, size_t size, const IDataType* interface) {
+  size_t es = interface->size;
+  if(size < 2) {
+    // Already sorted.
+    return 0;
+  }
+  // Scratch space: half of the array for merging, and one more element.
+  int fast;
+  char* scratch = internal_scratch_alloc((size / 2 + 1) * es, &fast);
+  if(scratch == NULL) {
+    EARLY_TRACE("sort_tim could not allocate merge buffer!");
+    return 1;
+  }
+  TimState ts;
+  ts.dti = interface;
+  ts.buffer = scratch;
+  ts.tmp = scratch + (size / 2) * es;
+  ts.run_count = 0;
+  size_t min_run = tim_min_run(size);
+  char* cur = array;
+  size_t remaining = size;
+  while(remaining != 0) {
+    size_t run = tim_count_run(interface, cur, remaining);
+    if(run < min_run) {
+      size_t forced = remaining < min_run ? remaining : min_run;
+      tim_binary_insertion_sort(&ts, cur, run, forced);
+      run = forced;
+    }
+    ts.run_start[ts.run_count] = cur;
+    ts.run_length[ts.run_count] = run;
+    ts.run_count++;
+    tim_merge_collapse(&ts);
+    cur = pdq_at(interface, cur, run);
+    remaining -= run;
+  }
+  // Merge whatever is left, from the end.
+  while(ts.run_count > 1) {
+    size_t n = ts.run_count - 2;
+    if(n > 0 && ts.run_length[n - 1] < ts.run_length[n + 1]) {
+      n--;
+    }
+    tim_merge_at(&ts, n);
+  }
+  internal_scratch_free(scratch, fast);
+  return 0;
+}
+
+/*
+ * LSD radix sort.
+ * Keys get mapped to unsigned integers with the same order,
+ * and elements get distributed by one byte of that integer at a time, starting from the least significant.
+ */
+
+/*
+ * Smaller arrays are faster to sort with comparisons.
+ */
+#define RADIX_MIN_SIZE 256
+#define RADIX_BUCKETS 256
+
+#define radix_supported(dti) dti_has_ordered_key(dti)
+#define radix_key(dti, e) dti_ordered_key(dti, pdq_key(dti, e))
+
+static inline void radix_copy(char* dst, const char* src, size_t es) {
+  // Constant sizes get inlined.
+  switch(es) {
+    case 4:
+      memcpy(dst, src, 4);
+      break;
+    case 8:
+      memcpy(dst, src, 8);
+      break;
+    default:
+      memcpy(dst, src, es);
+  }
+}
+
+int sort_radix(void* array, size_t size, const IDataType* interface) {
+  if(!radix_supported(interface) || size < RADIX_MIN_SIZE) {
+    sort_pdq(array, size, interface);
+    return 0;
+  }
+  size_t es = interface->size;
+  size_t passes = interface->key_size;
+  int fast;
+  char* scratch = internal_scratch_alloc(size * es, &fast);
+  if(scratch == NULL) {
+    EARLY_TRACE("sort_radix could not allocate buffer!");
+    return 1;
+  }
+  // All histograms are counted in a single pass.
+  size_t(*counts)[RADIX_BUCKETS] = calloc(passes, sizeof(*counts));
+  if(counts == NULL) {
+    internal_scratch_free(scratch, fast);
+    EARLY_TRACE("sort_radix could not allocate histograms!");
+    return 1;
+  }
+  char* src = array;
+  for(size_t i = 0; i < size; i++) {
+    uint64_t key = radix_key(interface, pdq_at(interface, src, i));
+    for(size_t p = 0; p < passes; p++) {
+      counts[p][(key >> (p * CHAR_BIT)) & 0xff]++;
+    }
+  }
+  char* dst = scratch;
+  for(size_t p = 0; p < passes; p++) {
+    size_t* count = counts[p];
+    size_t first = radix_key(interface, src) >> (p * CHAR_BIT) & 0xff;
+    if(count[first] == size) {
+      // Every element has the same byte here, so this pass would not move anything.
+      continue;
+    }
+    // Counts become the start of each bucket.
+    size_t offset = 0;
+    for(size_t b = 0; b < RADIX_BUCKETS; b++) {
+      size_t c = count[b];
+      count[b] = offset;
+      offset += c;
+    }
+    for(size_t i = 0; i < size; i++) {
+      const char* e = pdq_at(interface, src, i);
+      size_t b = radix_key(interface, e) >> (p * CHAR_BIT) & 0xff;
+      radix_copy(pdq_at(interface, dst, count[b]++), e, es);
+    }
+    char* tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+  if(src != array) {
+    memcpy(array, src, size * es);
+  }
+  free(counts);
+  internal_scratch_free(scratch, fast);
+  return 0;
+}
+
+/*
+ * Parallel sort.
+ * The array is split into one chunk per task and every chunk gets sorted by its own thread.
+ * Then sorted runs are merged in pairs, until only one is left.
+ * Every task of a merge round produces an equal slice of the output,
+ * so all threads stay busy even when the last two runs get merged.
+ */
+
+typedef enum { PARALLEL_SORT_CHUNKS, PARALLEL_MERGE } ParallelPhase;
+
+typedef struct {
+  const IDataType* dti;
+  ParallelPhase phase;
+  char* src;
+  char* dst;
+  // Runs are [bounds[i], bounds[i + 1]).
+  const size_t* bounds;
+  size_t run_count;
+  size_t size;
+  size_t task;
+  size_t tasks;
+} ParallelTask;
+
+/**
+ * How many of the first \p k merged elements come from \p a,
+ * when stably merging \p a with \p b.
+ */
+static size_t parallel_co_rank(const IDataType* dti, const char* a, size_t na, const char* b, size_t nb, size_t k) {
+  size_t lo = k > nb ? k - nb : 0;
+  size_t hi = k < na ? k : na;
+  while(lo < hi) {
+    size_t i = lo + (hi - lo) / 2;
+    size_t j = k - i;
+    // Elements of a go first when equal.
+    if(j > 0 && !tim_less(dti, pdq_at(dti, b, j - 1), pdq_at(dti, a, i))) {
+      lo = i + 1;
+    }
+    else {
+      hi = i;
+    }
+  }
+  return lo;
+}
+
+static void parallel_merge(const IDataType* dti, const char* a, const char* end_a, const char* b, const char* end_b, char* dst) {
+  size_t es = dti->size;
+  while(a < end_a && b < end_b) {
+    if(tim_less(dti, b, a)) {
+      memcpy(dst, b, es);
+      b += es;
+    }
+    else {
+      memcpy(dst, a, es);
+      a += es;
+    }
+    dst += es;
+  }
+  memcpy(dst, a, end_a - a);
+  dst += end_a - a;
+  memcpy(dst, b, end_b - b);
+}
+
+/**
+ * Produces this task's slice of the output of one merge round.
+ */
+static void parallel_merge_slice(ParallelTask* t) {
+  const IDataType* dti = t->dti;
+  size_t out_begin = t->size * t->task / t->tasks;
+  size_t out_end = t->size * (t->task + 1) / t->tasks;
+  for(size_t r = 0; r < t->run_count; r += 2) {
+    size_t pair_begin = t->bounds[r];
+    size_t middle = t->bounds[r + 1];
+    size_t pair_end = r + 2 <= t->run_count ? t->bounds[r + 2] : middle;
+    if(pair_end <= out_begin || pair_begin >= out_end) {
+      // Not part of this slice.
+      continue;
+    }
+    size_t k_begin = (out_begin > pair_begin ? out_begin : pair_begin) - pair_begin;
+    size_t k_end = (out_end < pair_end ? out_end : pair_end) - pair_begin;
+    const char* a = pdq_at(dti, t->src, pair_begin);
+    const char* b = pdq_at(dti, t->src, middle);
+    size_t na = middle - pair_begin;
+    size_t nb = pair_end - middle;
+    size_t i_begin = parallel_co_rank(dti, a, na, b, nb, k_begin);
+    size_t i_end = parallel_co_rank(dti, a, na, b, nb, k_end);
+    parallel_merge(dti, pdq_at(dti, a, i_begin), pdq_at(dti, a, i_end), pdq_at(dti, b, k_begin - i_begin), pdq_at(dti, b, k_end - i_end),
+                   pdq_at(dti, t->dst, pair_begin + k_begin));
+  }
+}
+
+static void* parallel_task_main(void* arg) {
+  ParallelTask* t = arg;
+  if(t->phase == PARALLEL_SORT_CHUNKS) {
+    char* chunk = pdq_at(t->dti, t->src, t->bounds[t->task]);
+    size_t n = t->bounds[t->task + 1] - t->bounds[t->task];
+    // Radix sort falls back to sort_pdq for keys it can not handle.
+    if(sort_radix(chunk, n, t->dti)) {
+      sort_pdq(chunk, n, t->dti);
+    }
+  }
+  else {
+    parallel_merge_slice(t);
+  }
+  return NULL;
+}
+
+/**
+ * Runs every task of a phase, the first one on the calling thread.
+ */
+static void parallel_run(ParallelTask* tasks, size_t count) {
+  pthread_t threads[count];
+  int started[count];
+  for(size_t i = 1; i < count; i++) {
+    started[i] = pthread_create(&threads[i], NULL, parallel_task_main, &tasks[i]) == 0;
+    if(!started[i]) {
+      EARLY_TRACE("sort_parallel could not create thread!");
+      parallel_task_main(&tasks[i]);
+    }
+  }
+  parallel_task_main(&tasks[0]);
+  for(size_t i = 1; i < count; i++) {
+    if(started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+}
+
+int sort_parallel(void* array, size_t size, const IDataType* interface, size_t threads) {
+  size_t es = interface->size;
+  size_t min_chunk = STRUCTURES_SORT_INSERTION_SIZE;
+  if(threads == 0) {
+    // One thread per core, as long as each one has at least a L2 cache worth of elements.
+    Runtime* rt = ssce_get_runtime();
+    threads = rt->cpu_core_count;
+    size_t l2 = rt->cpu_cache_size_l2 != 0 ? rt->cpu_cache_size_l2 : STRUCTURES_SORT_PARALLEL_CHUNK;
+    min_chunk = l2 / es + 1;
+  }
+  if(threads > STRUCTURES_SORT_PARALLEL_MAX_THREADS) {
+    threads = STRUCTURES_SORT_PARALLEL_MAX_THREADS;
+  }
+  size_t tasks = size / min_chunk;
+  if(tasks > threads) {
+    tasks = threads;
+  }
+  if(tasks < 2) {
+    // Not worth the threads.
+    if(sort_radix(array, size, interface)) {
+      sort_pdq(array, size, interface);
+    }
+    return 0;
+  }
+  char* scratch = malloc(size * es);
+  if(scratch == NULL) {
+    EARLY_TRACE("sort_parallel could not allocate buffer!");
+    return 1;
+  }
+  size_t bounds[STRUCTURES_SORT_PARALLEL_MAX_THREADS + 1];
+  for(size_t i = 0; i <= tasks; i++) {
+    bounds[i] = size * i / tasks;
+  }
+  ParallelTask task_data[STRUCTURES_SORT_PARALLEL_MAX_THREADS];
+  for(size_t i = 0; i < tasks; i++) {
+    task_data[i] = (ParallelTask){interface, PARALLEL_SORT_CHUNKS, array, scratch, bounds, tasks, size, i, tasks};
+  }
+  parallel_run(task_data, tasks);
+  // Merge pairs of runs, until only one is left.
+  char* src = array;
+  char* dst = scratch;
+  size_t run_count = tasks;
+  while(run_count > 1) {
+    for(size_t i = 0; i < tasks; i++) {
+      task_data[i].phase = PARALLEL_MERGE;
+      task_data[i].src = src;
+      task_data[i].dst = dst;
+      task_data[i].run_count = run_count;
+    }
+    parallel_run(task_data, tasks);
+    // Every pair became a single run.
+    size_t merged = 0;
+    for(size_t r = 0; r < run_count; r += 2) {
+      bounds[++merged] = r + 2 <= run_count ? bounds[r + 2] : bounds[r + 1];
+    }
+    run_count = merged;
+    char* tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+  if(src != array) {
+    memcpy(array, src, size * es);
   }
-}
\ No newline at end of file
+  free(scratch);
+  return 0;
+}
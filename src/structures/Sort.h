@@ -12,6 +12,7 @@
 
 /**
  * Sort an array using the heapsort algorithm.
+ * The heap is d-ary, with as many children per element as fit in a cache line.
  * 
  * @param array A pointer to the start of the array.
  * @param size Element count.
@@ -21,8 +22,80 @@
 EXPORT_API void sort_heap(void* array, size_t size, const IDataType* interface);
 
 /**
- * TODO: write a proper sort.
+ * Sort an array using pattern-defeating quicksort.
+ * Small ranges are sorted with insertion sort,
+ * sorted and reverse sorted patterns are detected,
+ * and ranges which keep getting bad pivots fall back to heapsort,
+ * so worst case time is O(n log n).
+ * Not stable.
+ *
+ * @param array A pointer to the start of the array.
+ * @param size Element count.
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ */
+EXPORT_API void sort_pdq(void* array, size_t size, const IDataType* interface);
+
+/**
+ * Sort an array using timsort.
+ * Equal elements keep their relative order.
+ * Already sorted runs are detected and merged,
+ * so nearly sorted input takes close to linear time.
+ * Worst case time is O(n log n).
+ * Needs scratch space for half of the array,
+ * which comes from the thread local stack if possible.
+ *
+ * @param array A pointer to the start of the array.
+ * @param size Element count.
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ * @returns non zero on error (not enough memory), in which case \p array is left unchanged.
+ */
+EXPORT_API int sort_tim(void* array, size_t size, const IDataType* interface);
+
+/**
+ * Sort an array using LSD radix sort, without calling any \ref Compare function.
+ * Requires \ref IDataType.key_kind to describe the key,
+ * otherwise (and for small arrays) it falls back to \ref sort_pdq.
+ * Equal elements keep their relative order.
+ * Both float zeros are equal, so -0.0 and 0.0 keep their input order.
+ * Float keys must not be NaN, see \ref KEY_KIND_FLOAT.
+ * Needs scratch space as big as the array,
+ * which comes from the thread local stack if possible.
+ *
+ * @param array A pointer to the start of the array.
+ * @param size Element count.
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ * @returns non zero on error (not enough memory), in which case \p array is left unchanged.
+ */
+EXPORT_API int sort_radix(void* array, size_t size, const IDataType* interface);
+
+/**
+ * Sorts using multiple threads.
+ * Each thread sorts a chunk of the array, then sorted chunks are merged in rounds,
+ * with every thread producing an equal slice of each round's output.
+ * Arrays too small to give every thread enough work are sorted on the calling thread.
+ * Not stable.
+ *
+ * @param array A pointer to the start of the array.
+ * @param size Element count.
+ * @param interface A pointer to a IDataType structure
+ * defining how interpret array elements.
+ * @param threads How many threads to use,
+ * or 0 for one per core with at least a L2 cache worth of elements each.
+ * @returns non zero on error (not enough memory), in which case \p array is left unchanged.
+ */
+EXPORT_API int sort_parallel(void* array, size_t size, const IDataType* interface, size_t threads);
+
+/**
+ * Default sorting algorithm.
+ */
+#define sort sort_pdq
+
+/**
+ * Default stable sorting algorithm.
  */
-#define sort sort_heap
+#define sort_stable sort_tim
 
 #endif /*SSCE_SORT_H*/
\ No newline at end of file
@@ -7,11 +7,20 @@
 
 #include <Macros.h>
 C_DECLS_START
+#include <Config.h>
 #include <Sort.h>
 C_DECLS_END
 
+// C++ callers get the ssce::sort template instead.
+#undef sort
+
+#include <Heap.hpp>
 #include <Interface.hpp>
 
+#include <cstddef>
+#include <functional>
+#include <utility>
+
 namespace ssce {
 
 /**
@@ -24,8 +33,83 @@ template<typename T>
 void heapsort(T array[], size_t size) {
   IDataTypeCpp<T> cpptype;
   IDataType type = cpptype.constructIDataType();
-  sort_heap(array, size, &type);
+  ::sort_heap(array, size, &type);
+}
+
+/**
+ * Like the C \ref sort_heap, but \p less and swaps get inlined.
+ * Uses a binary heap, while the C version picks the arity with \ref heap_arity.
+ *
+ * @param array A pointer to the start of the array.
+ * @param size Element count.
+ * @param less Strict weak ordering of elements.
+ */
+template<typename T, typename Compare = std::less<T>>
+inline void sort_heap(T* array, std::size_t size, Compare less = Compare()) {
+  using std::swap;
+  if(size < 2) {
+    // Already sorted.
+    return;
+  }
+  heap_create(array, size, less);
+  for(T* end = array + size - 1; end > array; end--) {
+    swap(*end, *array);
+    heap_sift_down(array, array, end - 1, less);
+  }
+}
+
+namespace detail {
+
+template<typename T>
+inline void pdq_swap(T& a, T& b) {
+  using std::swap;
+  swap(a, b);
+}
+
+/*
+ * Same pattern-defeating quicksort as the C sort_pdq, see SortPdq.h.
+ */
+#define PDQ_FUNCTION template<typename T, typename Compare> inline
+#define PDQ_CONTEXT Compare&
+#define PDQ_POINTER T*
+#define PDQ_LESS(less, a, b) less(*(a), *(b))
+#define PDQ_SWAP(less, a, b) pdq_swap(*(a), *(b))
+#define PDQ_FORWARD(less, p, i) ((p) + (i))
+#define PDQ_BACKWARD(less, p, i) ((p) - (i))
+#define PDQ_COUNT(less, begin, end) ((std::size_t)((end) - (begin)))
+#define PDQ_HEAPSORT(less, begin, n) ssce::sort_heap(begin, n, less)
+#include <SortPdq.h>
+#undef PDQ_FUNCTION
+#undef PDQ_CONTEXT
+#undef PDQ_POINTER
+#undef PDQ_LESS
+#undef PDQ_SWAP
+#undef PDQ_FORWARD
+#undef PDQ_BACKWARD
+#undef PDQ_COUNT
+#undef PDQ_HEAPSORT
+#undef PDQ_NINTHER_SIZE
+#undef PDQ_PARTIAL_LIMIT
+
+}  // namespace detail
+
+/**
+ * Same as the C \ref sort_pdq, but \p less and swaps get inlined,
+ * which for small elements is a lot faster than calling through a \ref IDataType.
+ * Not stable.
+ *
+ * @param array A pointer to the start of the array.
+ * @param size Element count.
+ * @param less Strict weak ordering of elements.
+ */
+template<typename T, typename Compare = std::less<T>>
+inline void sort(T* array, std::size_t size, Compare less = Compare()) {
+  if(size < 2) {
+    // Already sorted.
+    return;
+  }
+  detail::pdq_loop(less, array, array + size, detail::pdq_bad_allowed(size), 1);
 }
 
 } // namespace ssce
-#endif /*SSCE_SORT_HPP*/
\ No newline at end of file
+#endif /*SSCE_SORT_HPP*/
@@ -0,0 +1,254 @@
+#ifndef SSCE_SORT_PDQ_H
+#define SSCE_SORT_PDQ_H
+/**
+ * @file
+ * @brief Pattern-defeating quicksort, shared by the C and C++ sorts.
+ *
+ * Internal usage only.
+ * The includer defines how elements are accessed, before including this file:
+ * - PDQ_FUNCTION: prefix of every function, like static inline or a template declaration.
+ * - PDQ_CONTEXT: type of the first argument of every function, passed to every macro.
+ * - PDQ_POINTER: type of a pointer to an element.
+ * - PDQ_LESS(ctx, a, b): non zero if the element at \p a goes before the element at \p b.
+ * - PDQ_SWAP(ctx, a, b): swaps the elements at \p a and \p b.
+ * - PDQ_FORWARD(ctx, p, i) and PDQ_BACKWARD(ctx, p, i): pointer \p i elements after or before \p p.
+ * - PDQ_COUNT(ctx, begin, end): element count of a range.
+ * - PDQ_HEAPSORT(ctx, begin, n): heapsort fallback.
+ *
+ * All pointers point to the start of elements,
+ * and ranges are given as [begin, end).
+ */
+
+/*
+ * Ranges bigger than this select their pivot as the median of three medians.
+ */
+#define PDQ_NINTHER_SIZE 128
+/*
+ * How many elements partial insertion sort may move, before giving up.
+ */
+#define PDQ_PARTIAL_LIMIT 8
+
+PDQ_FUNCTION void pdq_sort2(PDQ_CONTEXT ctx, PDQ_POINTER a, PDQ_POINTER b) {
+  if(PDQ_LESS(ctx, b, a)) {
+    PDQ_SWAP(ctx, a, b);
+  }
+}
+
+PDQ_FUNCTION void pdq_sort3(PDQ_CONTEXT ctx, PDQ_POINTER a, PDQ_POINTER b, PDQ_POINTER c) {
+  pdq_sort2(ctx, a, b);
+  pdq_sort2(ctx, b, c);
+  pdq_sort2(ctx, a, b);
+}
+
+PDQ_FUNCTION void pdq_insertion_sort(PDQ_CONTEXT ctx, PDQ_POINTER begin, PDQ_POINTER end) {
+  for(PDQ_POINTER cur = PDQ_FORWARD(ctx, begin, 1); cur < end; cur = PDQ_FORWARD(ctx, cur, 1)) {
+    for(PDQ_POINTER sift = cur; sift > begin && PDQ_LESS(ctx, sift, PDQ_BACKWARD(ctx, sift, 1)); sift = PDQ_BACKWARD(ctx, sift, 1)) {
+      PDQ_SWAP(ctx, sift, PDQ_BACKWARD(ctx, sift, 1));
+    }
+  }
+}
+
+/**
+ * Same as \ref pdq_insertion_sort, but requires the element before \p begin
+ * to be smaller or equal than every element in the range, so that sifting needs no bounds check.
+ */
+PDQ_FUNCTION void pdq_unguarded_insertion_sort(PDQ_CONTEXT ctx, PDQ_POINTER begin, PDQ_POINTER end) {
+  for(PDQ_POINTER cur = PDQ_FORWARD(ctx, begin, 1); cur < end; cur = PDQ_FORWARD(ctx, cur, 1)) {
+    for(PDQ_POINTER sift = cur; PDQ_LESS(ctx, sift, PDQ_BACKWARD(ctx, sift, 1)); sift = PDQ_BACKWARD(ctx, sift, 1)) {
+      PDQ_SWAP(ctx, sift, PDQ_BACKWARD(ctx, sift, 1));
+    }
+  }
+}
+
+/**
+ * Insertion sort which gives up after moving \ref PDQ_PARTIAL_LIMIT elements.
+ * Returns non zero if the range got sorted.
+ */
+PDQ_FUNCTION int pdq_partial_insertion_sort(PDQ_CONTEXT ctx, PDQ_POINTER begin, PDQ_POINTER end) {
+  size_t moved = 0;
+  for(PDQ_POINTER cur = PDQ_FORWARD(ctx, begin, 1); cur < end; cur = PDQ_FORWARD(ctx, cur, 1)) {
+    for(PDQ_POINTER sift = cur; sift > begin && PDQ_LESS(ctx, sift, PDQ_BACKWARD(ctx, sift, 1)); sift = PDQ_BACKWARD(ctx, sift, 1)) {
+      PDQ_SWAP(ctx, sift, PDQ_BACKWARD(ctx, sift, 1));
+      moved++;
+    }
+    if(moved > PDQ_PARTIAL_LIMIT) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Partitions around the pivot at \p begin.
+ * Elements equal to the pivot go to the right side.
+ * Returns the final position of the pivot,
+ * and sets \p already_partitioned if no element had to be swapped.
+ */
+PDQ_FUNCTION PDQ_POINTER pdq_partition_right(PDQ_CONTEXT ctx, PDQ_POINTER begin, PDQ_POINTER end, int* already_partitioned) {
+  PDQ_POINTER pivot = begin;
+  PDQ_POINTER first = PDQ_FORWARD(ctx, begin, 1);
+  PDQ_POINTER last = end;
+  // Median selection guarantees that an element bigger or equal to the pivot exists.
+  while(PDQ_LESS(ctx, first, pivot)) {
+    first = PDQ_FORWARD(ctx, first, 1);
+  }
+  if(PDQ_BACKWARD(ctx, first, 1) == begin) {
+    // No smaller element got found yet, so last must be bounds checked.
+    do {
+      last = PDQ_BACKWARD(ctx, last, 1);
+    } while(first < last && !PDQ_LESS(ctx, last, pivot));
+  }
+  else {
+    do {
+      last = PDQ_BACKWARD(ctx, last, 1);
+    } while(!PDQ_LESS(ctx, last, pivot));
+  }
+  *already_partitioned = first >= last;
+  while(first < last) {
+    PDQ_SWAP(ctx, first, last);
+    do {
+      first = PDQ_FORWARD(ctx, first, 1);
+    } while(PDQ_LESS(ctx, first, pivot));
+    do {
+      last = PDQ_BACKWARD(ctx, last, 1);
+    } while(!PDQ_LESS(ctx, last, pivot));
+  }
+  PDQ_POINTER pivot_pos = PDQ_BACKWARD(ctx, first, 1);
+  if(pivot_pos != begin) {
+    PDQ_SWAP(ctx, begin, pivot_pos);
+  }
+  return pivot_pos;
+}
+
+/**
+ * Partitions around the pivot at \p begin, when it is equal to the element before \p begin.
+ * Elements equal to the pivot go to the left side, where they are already in their final positions.
+ * Returns the final position of the pivot.
+ */
+PDQ_FUNCTION PDQ_POINTER pdq_partition_left(PDQ_CONTEXT ctx, PDQ_POINTER begin, PDQ_POINTER end) {
+  PDQ_POINTER pivot = begin;
+  PDQ_POINTER first = begin;
+  PDQ_POINTER last = end;
+  do {
+    last = PDQ_BACKWARD(ctx, last, 1);
+  } while(PDQ_LESS(ctx, pivot, last));
+  if(PDQ_FORWARD(ctx, last, 1) == end) {
+    do {
+      first = PDQ_FORWARD(ctx, first, 1);
+    } while(first < last && !PDQ_LESS(ctx, pivot, first));
+  }
+  else {
+    do {
+      first = PDQ_FORWARD(ctx, first, 1);
+    } while(!PDQ_LESS(ctx, pivot, first));
+  }
+  while(first < last) {
+    PDQ_SWAP(ctx, first, last);
+    do {
+      last = PDQ_BACKWARD(ctx, last, 1);
+    } while(PDQ_LESS(ctx, pivot, last));
+    do {
+      first = PDQ_FORWARD(ctx, first, 1);
+    } while(!PDQ_LESS(ctx, pivot, first));
+  }
+  if(last != begin) {
+    PDQ_SWAP(ctx, begin, last);
+  }
+  return last;
+}
+
+/**
+ * Swaps a few elements of an unbalanced side around,
+ * so that the following pivot selection is less likely to repeat the same mistake.
+ * Only swaps, so \p ctx goes unused when swapping does not need it.
+ */
+PDQ_FUNCTION void pdq_break_patterns(MARK_UNUSED PDQ_CONTEXT ctx, PDQ_POINTER begin, PDQ_POINTER end) {
+  size_t n = PDQ_COUNT(ctx, begin, end);
+  if(n < STRUCTURES_SORT_INSERTION_SIZE) {
+    return;
+  }
+  size_t quarter = n / 4;
+  PDQ_SWAP(ctx, begin, PDQ_FORWARD(ctx, begin, quarter));
+  PDQ_SWAP(ctx, PDQ_FORWARD(ctx, begin, n - 1), PDQ_FORWARD(ctx, begin, n - quarter));
+  if(n > PDQ_NINTHER_SIZE) {
+    PDQ_SWAP(ctx, PDQ_FORWARD(ctx, begin, 1), PDQ_FORWARD(ctx, begin, quarter + 1));
+    PDQ_SWAP(ctx, PDQ_FORWARD(ctx, begin, 2), PDQ_FORWARD(ctx, begin, quarter + 2));
+    PDQ_SWAP(ctx, PDQ_FORWARD(ctx, begin, n - 2), PDQ_FORWARD(ctx, begin, n - (quarter + 1)));
+    PDQ_SWAP(ctx, PDQ_FORWARD(ctx, begin, n - 3), PDQ_FORWARD(ctx, begin, n - (quarter + 2)));
+  }
+}
+
+PDQ_FUNCTION void pdq_loop(PDQ_CONTEXT ctx, PDQ_POINTER begin, PDQ_POINTER end, int bad_allowed, int leftmost) {
+  while(1) {
+    size_t n = PDQ_COUNT(ctx, begin, end);
+    if(n < STRUCTURES_SORT_INSERTION_SIZE) {
+      if(leftmost) {
+        pdq_insertion_sort(ctx, begin, end);
+      }
+      else {
+        pdq_unguarded_insertion_sort(ctx, begin, end);
+      }
+      return;
+    }
+    // Move the pivot to begin.
+    PDQ_POINTER middle = PDQ_FORWARD(ctx, begin, n / 2);
+    if(n > PDQ_NINTHER_SIZE) {
+      pdq_sort3(ctx, begin, middle, PDQ_BACKWARD(ctx, end, 1));
+      pdq_sort3(ctx, PDQ_FORWARD(ctx, begin, 1), PDQ_BACKWARD(ctx, middle, 1), PDQ_BACKWARD(ctx, end, 2));
+      pdq_sort3(ctx, PDQ_FORWARD(ctx, begin, 2), PDQ_FORWARD(ctx, middle, 1), PDQ_BACKWARD(ctx, end, 3));
+      pdq_sort3(ctx, PDQ_BACKWARD(ctx, middle, 1), middle, PDQ_FORWARD(ctx, middle, 1));
+      PDQ_SWAP(ctx, begin, middle);
+    }
+    else {
+      pdq_sort3(ctx, middle, begin, PDQ_BACKWARD(ctx, end, 1));
+    }
+    if(!leftmost && !PDQ_LESS(ctx, PDQ_BACKWARD(ctx, begin, 1), begin)) {
+      // The pivot is equal to an element of a previous partition,
+      // so there is no smaller element in this range.
+      // Putting all elements equal to the pivot in place defeats many duplicates.
+      begin = PDQ_FORWARD(ctx, pdq_partition_left(ctx, begin, end), 1);
+      continue;
+    }
+    int already_partitioned;
+    PDQ_POINTER pivot_pos = pdq_partition_right(ctx, begin, end, &already_partitioned);
+    size_t left_n = PDQ_COUNT(ctx, begin, pivot_pos);
+    size_t right_n = PDQ_COUNT(ctx, PDQ_FORWARD(ctx, pivot_pos, 1), end);
+    if(left_n < n / 8 || right_n < n / 8) {
+      // Too many bad pivots mean quadratic time, so fall back to heapsort.
+      if(--bad_allowed == 0) {
+        PDQ_HEAPSORT(ctx, begin, n);
+        return;
+      }
+      pdq_break_patterns(ctx, begin, pivot_pos);
+      pdq_break_patterns(ctx, PDQ_FORWARD(ctx, pivot_pos, 1), end);
+    }
+    else if(already_partitioned && pdq_partial_insertion_sort(ctx, begin, pivot_pos) &&
+            pdq_partial_insertion_sort(ctx, PDQ_FORWARD(ctx, pivot_pos, 1), end)) {
+      // Input was already (nearly) sorted.
+      return;
+    }
+    // Recurse into the smaller side, so that stack depth stays logarithmic.
+    if(left_n < right_n) {
+      pdq_loop(ctx, begin, pivot_pos, bad_allowed, leftmost);
+      begin = PDQ_FORWARD(ctx, pivot_pos, 1);
+      leftmost = 0;
+    }
+    else {
+      pdq_loop(ctx, PDQ_FORWARD(ctx, pivot_pos, 1), end, bad_allowed, 0);
+      end = pivot_pos;
+    }
+  }
+}
+
+/**
+ * Depth of bad pivots after which \ref pdq_loop falls back to heapsort.
+ */
+static inline int pdq_bad_allowed(size_t size) {
+  int log2 = 0;
+  for(size_t n = size; n > 1; n >>= 1) {
+    log2++;
+  }
+  return log2;
+}
+
+#endif /*SSCE_SORT_PDQ_H*/
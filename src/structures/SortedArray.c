@@ -1,6 +1,8 @@
 #include "SortedArray.h"
 
+#include <Config.h>
 #include <Macros.h>
+#include <Runtime.h>
 #include <memory/FAlloc.h>
 #include <memory/GAlloc.h>
 #include <structures/Interface.h>
@@ -12,10 +14,29 @@
 #include <strings.h>
 
 #define OFFSET_THRESHOLD 128
+#define MIN_CAPACITY 8
+
+/*
+ * A piece of a chunked SortedArray.
+ */
+typedef struct {
+  // Sorted elements, with space for chunk_elements of them.
+  char* data;
+  // Amount of elements currently stored in this chunk.
+  size_t count;
+  // Index of the first element of this chunk in the whole array.
+  size_t first;
+} Chunk;
 
 /*
  * Implementation details:
- * if allocated is null, then length is also 0 and vise versa.
+ * if allocated is null, then capacity is also 0 and vise versa.
+ * Capacity grows geometrically and is only given back by compact,
+ * so that inserting and removing single elements does not reallocate.
+ * Big arrays are instead stored in chunks, so that inserting and removing
+ * only moves elements of a single chunk. Then allocated is null.
+ * After \ref sorted_array_pointer joins the chunks, the array stays flat
+ * until it doubles, so alternating it with inserts does not rebuild chunks every time.
  */
 struct SortedArray {
   // Start of allocated memory block.
@@ -24,8 +45,18 @@ struct SortedArray {
   size_t length;
   // Offset in elements in the start of the allocated memory block.
   size_t start_offset;
+  // Size in elements of the allocated memory block, including start_offset.
+  size_t capacity;
   // Interface with which this SortedArray is created.
   const IDataType* interface;
+  // Chunks in order, or null when not chunked.
+  Chunk* chunks;
+  // Amount of chunks in use.
+  size_t chunk_count;
+  // Amount of chunks allocated.
+  size_t chunk_capacity;
+  // Size in bytes at which a flat array switches to chunks.
+  size_t chunked_bytes;
 };
 
 /**
@@ -51,7 +82,38 @@ static inline void* internal_sorted_array_pointer(SortedArray* sa) {
   return fixed_address;
 }
 
+/**
+ * Branchless bound for keys which support \ref dti_ordered_key.
+ * Returns the index of the first element whose key is not smaller than \p key,
+ * or if \p upper is set, the first element whose key is greater.
+ */
+static inline size_t internal_scalar_bound(const IDataType* dti, void* base_address, size_t n, uint64_t key, int upper) {
+  if(n == 0) {
+    return 0;
+  }
+  const char* base = dti_item(dti, base_address, 0);
+  size_t length = n;
+  // Every step halves the range, with a conditional move instead of a branch.
+  while(length > 1) {
+    size_t half = length / 2;
+    // Both possible next middles, as the branch is not predicted.
+    PREFETCH(base + (half / 2) * dti->size);
+    PREFETCH(base + (half + half / 2) * dti->size);
+    uint64_t middle = dti_ordered_key(dti, base + half * dti->size);
+    base += (upper ? middle <= key : middle < key) ? half * dti->size : 0;
+    length -= half;
+  }
+  uint64_t last = dti_ordered_key(dti, base);
+  size_t index = ((uintptr_t)base - (uintptr_t)dti_item(dti, base_address, 0)) / dti->size;
+  return index + (upper ? last <= key : last < key);
+}
+
 static inline SizeBool internal_sorted_array_find(const IDataType* dti, void* base_address, size_t n, const void* key_address) {
+  if(dti_has_ordered_key(dti)) {
+    size_t index = internal_scalar_bound(dti, base_address, n, dti_ordered_key(dti, key_address), 0);
+    int hit = index < n && dti->cmp_eq(dti, dti_item(dti, base_address, index), key_address);
+    return (SizeBool){index, hit};
+  }
   if(n == 0) {
     // Avoid unsigned underflow.
     return (SizeBool){0, 0};
@@ -77,54 +139,75 @@ static inline SizeBool internal_sorted_array_find(const IDataType* dti, void* ba
   return (SizeBool){start, 0};
 }
 
-static inline SizeBool internal_sorted_array_find_stable(const IDataType* dti, void* base_address, size_t n, const void* key_address, int fwd) {
-  SizeBool result = internal_sorted_array_find(dti, base_address, n, key_address);
-  if(result.boolean) {
-    // If we've got a hit, then find the last or first of the same element.
-    size_t index = result.size;
-    // Check bounds.
-    if(index == (n - 1)) {
-      // We are already at the end of the array.
-      return result;
-    }
-    // Generate iterator.
-    void* current = dti_item(dti, base_address, index);
-    current = fwd ? dti_next(dti, current) : dti_previous(dti, current);
-    index++;
-    // Start search.
-    while(dti->cmp_eq(dti, current, key_address)) {
-      // Recheck bounds.
-      if(index == (n - 1)) {
-        // We are going to shoot past the array.
-        result.size = index;
-        return result;
-      }
-      current = fwd ? dti_next(dti, current) : dti_previous(dti, current);
-      index++;
+/**
+ * Returns the index of the first element not smaller than the key,
+ * or if \p upper is set, of the first element greater than the key.
+ */
+static inline size_t internal_sorted_array_bound(const IDataType* dti, void* base_address, size_t n, const void* key_address, int upper) {
+  if(dti_has_ordered_key(dti)) {
+    return internal_scalar_bound(dti, base_address, n, dti_ordered_key(dti, key_address), upper);
+  }
+  size_t start = 0;
+  size_t end = n;
+  while(start < end) {
+    size_t middle = start + (end - start) / 2;
+    void* middle_address = dti_item(dti, base_address, middle);
+    int right = upper ? !dti->cmp_l(dti, key_address, middle_address) : dti->cmp_l(dti, middle_address, key_address);
+    if(right) {
+      start = middle + 1;
+    }
+    else {
+      end = middle;
     }
-    // We've hit something different. Go back one and return.
-    result.size = index - 1;
-    return result;
+  }
+  return start;
+}
+
+/**
+ * Makes sure that the memory block has space for \p count elements after start_offset.
+ * Unless \p exact is set, capacity is at least doubled, to amortize reallocations.
+ * Returns non zero when out of memory, in which case nothing changes.
+ */
+static int internal_sorted_array_grow(SortedArray* sa, size_t count, int exact) {
+  size_t needed = sa->start_offset + count;
+  if(needed <= sa->capacity) {
+    return 0;
+  }
+  size_t capacity = needed;
+  if(!exact) {
+    size_t geometric = sa->capacity * 2;
+    if(geometric < MIN_CAPACITY) {
+      geometric = MIN_CAPACITY;
+    }
+    if(capacity < geometric) {
+      capacity = geometric;
+    }
+  }
+  void* new_allocated = realloc(sa->allocated, sa->interface->size * capacity);
+  if(new_allocated == NULL) {
+    // Out of memory.
+    EARLY_TRACE("internal_sorted_array_grow could not reallocate memory block!");
+    return 1;
+  }
+  else if(new_allocated != sa->allocated) {
+    EARLY_TRACE("internal_sorted_array_grow relocated memory block!");
+    sa->allocated = new_allocated;
   }
   else {
-    // Key does not exist in array.
-    return result;
+    EARLY_TRACE("internal_sorted_array_grow reallocated memory block in place!");
   }
+  sa->capacity = capacity;
+  return 0;
 }
 
 static inline int internal_sorted_array_insert(SortedArray* sa, void* start_address, size_t length, const void* value, size_t index) {
   // Make space, and then copy value at index.
   if(length == 0) {
-    // No memory is allocated.
-    sa->allocated = malloc(sa->interface->size);
-    if(sa->allocated == NULL) {
-      // Out of memory.
-      EARLY_TRACE("internal_sorted_array_insert could not allocate new memory block!");
+    // Start from the beginning of the memory block, if there is one.
+    sa->start_offset = 0;
+    if(internal_sorted_array_grow(sa, 1, 0)) {
       return 0;
     }
-    else {
-      EARLY_TRACE("internal_sorted_array_insert allocated new memory block!");
-    }
     memcpy(sa->allocated, value, sa->interface->size);
     // Everything was good. Finalize changes.
     sa->length++;
@@ -146,23 +229,11 @@ static inline int internal_sorted_array_insert(SortedArray* sa, void* start_addr
   // We have to move the end of the array to make space.
   else {
     EARLY_TRACE("internal_sorted_array_insert at back!");
-    // Make space by reallocating memory block.
-    void* new_allocated = realloc(sa->allocated, sa->interface->size * (sa->length + sa->start_offset + 1));
-    if(new_allocated == NULL) {
-      // Out of memory.
-      EARLY_TRACE("internal_sorted_array_insert could not reallocate memory block!");
+    // Make space at the end of memory block, if there is none left.
+    if(internal_sorted_array_grow(sa, sa->length + 1, 0)) {
       return 0;
     }
-    else if(new_allocated != sa->allocated) {
-      // Realloc moved allocation.
-      EARLY_TRACE("internal_sorted_array_insert relocated memory block!");
-      sa->allocated = new_allocated;
-      start_address = internal_sorted_array_pointer(sa);
-    }
-    else {
-      // Realloc just gave us access to more of the previously allocated memory.
-      EARLY_TRACE("internal_sorted_array_insert reallocated memory block in place!");
-    }
+    start_address = internal_sorted_array_pointer(sa);
     // Make space by moving index to end.
     void* dest = dti_element(sa->interface, start_address, index);
     memmove(dti_next(sa->interface, dest), dest, sa->interface->size * (sa->length - index));
@@ -220,29 +291,453 @@ static inline void internal_sorted_array_remove(SortedArray* sa, size_t index) {
     void* after_address = dti_next(sa->interface, index_address);
     size_t bytes = sa->interface->size * (sa->length - index - 1);
     memmove(index_address, after_address, bytes);
-    // Shrink allocated memory block.
+    // Memory block is kept, until the next compact.
     sa->length--;
     if(sa->length == 0) {
-      free(sa->allocated);
-      sa->allocated = NULL;
       sa->start_offset = 0;
     }
+  }
+}
+
+/*
+ * Chunked storage.
+ */
+
+#define internal_is_chunked(sa) (sa->chunks != NULL)
+
+/**
+ * How many elements fit in a chunk.
+ */
+static inline size_t internal_chunk_elements(const IDataType* dti) {
+  size_t n = STRUCTURES_SORTED_ARRAY_CHUNK_BYTES / dti->size;
+  return n < 4 ? 4 : n;
+}
+
+#define internal_chunk_item(dti, chunk, index) dti_item(dti, (chunk)->data, index)
+
+/**
+ * Finds the chunk which should contain the key.
+ * That is the first chunk whose last element is not smaller than the key,
+ * or if \p upper is set, the first chunk whose last element is greater than the key.
+ * Returns the last chunk if there is no such chunk.
+ */
+static inline size_t internal_chunk_find_key(SortedArray* sa, const void* key_address, int upper) {
+  const IDataType* dti = sa->interface;
+  size_t start = 0;
+  size_t end = sa->chunk_count;
+  while(start < end) {
+    size_t middle = start + (end - start) / 2;
+    Chunk* chunk = &sa->chunks[middle];
+    void* last = internal_chunk_item(dti, chunk, chunk->count - 1);
+    int right = upper ? !dti->cmp_l(dti, key_address, last) : dti->cmp_l(dti, last, key_address);
+    if(right) {
+      start = middle + 1;
+    }
+    else {
+      end = middle;
+    }
+  }
+  return start == sa->chunk_count ? start - 1 : start;
+}
+
+/**
+ * Finds the chunk which contains the element at \p index.
+ */
+static inline size_t internal_chunk_find_index(SortedArray* sa, size_t index) {
+  size_t start = 0;
+  size_t end = sa->chunk_count;
+  while(end - start > 1) {
+    size_t middle = start + (end - start) / 2;
+    if(sa->chunks[middle].first <= index) {
+      start = middle;
+    }
     else {
-      void* new_allocated = realloc(sa->allocated, sa->interface->size * (sa->length + sa->start_offset));
-      if(new_allocated == NULL) {
-        EARLY_TRACE("internal_sorted_array_remove could not reallocate memory block!");
+      end = middle;
+    }
+  }
+  return start;
+}
+
+static inline void internal_chunks_shift_first(SortedArray* sa, size_t from, int delta) {
+  for(size_t i = from; i < sa->chunk_count; i++) {
+    sa->chunks[i].first += delta;
+  }
+}
+
+static int internal_chunks_reserve(SortedArray* sa, size_t count) {
+  if(count <= sa->chunk_capacity) {
+    return 0;
+  }
+  size_t capacity = sa->chunk_capacity * 2;
+  if(capacity < count) {
+    capacity = count;
+  }
+  Chunk* new_chunks = realloc(sa->chunks, capacity * sizeof(Chunk));
+  if(new_chunks == NULL) {
+    EARLY_TRACE("internal_chunks_reserve could not reallocate chunk list!");
+    return 1;
+  }
+  sa->chunks = new_chunks;
+  sa->chunk_capacity = capacity;
+  return 0;
+}
+
+static void internal_chunks_free(SortedArray* sa) {
+  for(size_t i = 0; i < sa->chunk_count; i++) {
+    free(sa->chunks[i].data);
+  }
+  free(sa->chunks);
+  sa->chunks = NULL;
+  sa->chunk_count = 0;
+  sa->chunk_capacity = 0;
+}
+
+/**
+ * Moves the elements of a flat array into chunks which are filled up to \p fill elements.
+ * On failure nothing changes.
+ */
+static int internal_chunks_from(SortedArray* sa, char* elements, size_t length, size_t fill) {
+  const IDataType* dti = sa->interface;
+  size_t chunk_elements = internal_chunk_elements(dti);
+  size_t count = (length + fill - 1) / fill;
+  Chunk* chunks = malloc(count * sizeof(Chunk));
+  if(chunks == NULL) {
+    EARLY_TRACE("internal_chunks_from could not allocate chunk list!");
+    return 1;
+  }
+  for(size_t i = 0; i < count; i++) {
+    chunks[i].data = malloc(chunk_elements * dti->size);
+    if(chunks[i].data == NULL) {
+      EARLY_TRACE("internal_chunks_from could not allocate chunk!");
+      while(i-- > 0) {
+        free(chunks[i].data);
       }
-      else if(new_allocated != sa->allocated) {
-        EARLY_TRACE("internal_sorted_array_remove relocated memory block!");
-        sa->allocated = new_allocated;
+      free(chunks);
+      return 1;
+    }
+    chunks[i].first = i * fill;
+    chunks[i].count = i == count - 1 ? length - i * fill : fill;
+    memcpy(chunks[i].data, dti_element(dti, elements, i * fill), chunks[i].count * dti->size);
+  }
+  sa->chunks = chunks;
+  sa->chunk_count = count;
+  sa->chunk_capacity = count;
+  return 0;
+}
+
+/**
+ * Switches a flat array to chunks.
+ * Chunks are left partially empty, so that inserts do not immediately split them.
+ */
+static void internal_sorted_array_chunk(SortedArray* sa) {
+  size_t chunk_elements = internal_chunk_elements(sa->interface);
+  size_t fill = chunk_elements - chunk_elements / 4;
+  if(internal_chunks_from(sa, internal_sorted_array_pointer(sa), sa->length, fill)) {
+    // Not fatal, keep using the flat array.
+    return;
+  }
+  EARLY_TRACE("internal_sorted_array_chunk switched to chunks!");
+  sa->chunked_bytes = STRUCTURES_SORTED_ARRAY_CHUNKED_BYTES;
+  free(sa->allocated);
+  sa->allocated = NULL;
+  sa->start_offset = 0;
+  sa->capacity = 0;
+}
+
+/**
+ * Switches a chunked array back to a single memory block.
+ * Returns non zero on failure, in which case it stays chunked.
+ */
+static int internal_sorted_array_flatten(SortedArray* sa) {
+  const IDataType* dti = sa->interface;
+  char* flat = malloc(sa->length * dti->size);
+  if(flat == NULL) {
+    EARLY_TRACE("internal_sorted_array_flatten could not allocate memory block!");
+    return 1;
+  }
+  for(size_t i = 0; i < sa->chunk_count; i++) {
+    Chunk* chunk = &sa->chunks[i];
+    memcpy(dti_element(dti, flat, chunk->first), chunk->data, chunk->count * dti->size);
+  }
+  internal_chunks_free(sa);
+  sa->allocated = flat;
+  sa->start_offset = 0;
+  sa->capacity = sa->length;
+  return 0;
+}
+
+/**
+ * Switches to chunks if the array got big enough.
+ */
+static inline void internal_sorted_array_check_grow(SortedArray* sa) {
+  if(!internal_is_chunked(sa) && sa->length * sa->interface->size >= sa->chunked_bytes) {
+    internal_sorted_array_chunk(sa);
+  }
+}
+
+/**
+ * Inserts \p value at position \p index of chunk \p c, splitting it when full.
+ * Returns the index in the whole array, or \ref INVALID_SIZE_T when out of memory.
+ */
+static size_t internal_chunks_insert(SortedArray* sa, size_t c, size_t index, const void* value) {
+  const IDataType* dti = sa->interface;
+  size_t chunk_elements = internal_chunk_elements(dti);
+  if(sa->chunks[c].count == chunk_elements) {
+    // Split in half.
+    if(internal_chunks_reserve(sa, sa->chunk_count + 1)) {
+      return INVALID_SIZE_T;
+    }
+    char* data = malloc(chunk_elements * dti->size);
+    if(data == NULL) {
+      EARLY_TRACE("internal_chunks_insert could not allocate chunk!");
+      return INVALID_SIZE_T;
+    }
+    memmove(&sa->chunks[c + 2], &sa->chunks[c + 1], (sa->chunk_count - c - 1) * sizeof(Chunk));
+    sa->chunk_count++;
+    Chunk* left = &sa->chunks[c];
+    Chunk* right = &sa->chunks[c + 1];
+    size_t half = chunk_elements / 2;
+    memcpy(data, dti_element(dti, left->data, half), (chunk_elements - half) * dti->size);
+    right->data = data;
+    right->count = chunk_elements - half;
+    right->first = left->first + half;
+    left->count = half;
+    if(index > half) {
+      c++;
+      index -= half;
+    }
+  }
+  Chunk* chunk = &sa->chunks[c];
+  void* dest = dti_element(dti, chunk->data, index);
+  memmove(dti_next(dti, dest), dest, (chunk->count - index) * dti->size);
+  memcpy(dest, value, dti->size);
+  chunk->count++;
+  internal_chunks_shift_first(sa, c + 1, 1);
+  sa->length++;
+  return chunk->first + index;
+}
+
+/**
+ * Removes the element at position \p index of chunk \p c.
+ * Chunks which become too empty get merged with their neighbour,
+ * and small arrays switch back to a single memory block.
+ */
+static void internal_chunks_remove(SortedArray* sa, size_t c, size_t index) {
+  const IDataType* dti = sa->interface;
+  Chunk* chunk = &sa->chunks[c];
+  void* dest = dti_element(dti, chunk->data, index);
+  memmove(dest, dti_next(dti, dest), (chunk->count - index - 1) * dti->size);
+  chunk->count--;
+  internal_chunks_shift_first(sa, c + 1, -1);
+  sa->length--;
+  size_t chunk_elements = internal_chunk_elements(dti);
+  if(chunk->count == 0 && sa->chunk_count > 1) {
+    // Searches expect every chunk to have a last element, so empty chunks always go.
+    free(chunk->data);
+    memmove(chunk, chunk + 1, (sa->chunk_count - c - 1) * sizeof(Chunk));
+    sa->chunk_count--;
+  }
+  else if(chunk->count < chunk_elements / 4 && sa->chunk_count > 1) {
+    // Merge with the smaller neighbour, if both fit in half a chunk.
+    size_t left = c;
+    if(c == sa->chunk_count - 1 || (c > 0 && sa->chunks[c - 1].count < sa->chunks[c + 1].count)) {
+      left = c - 1;
+    }
+    Chunk* a = &sa->chunks[left];
+    Chunk* b = &sa->chunks[left + 1];
+    if(a->count + b->count <= chunk_elements / 2) {
+      memcpy(dti_element(dti, a->data, a->count), b->data, b->count * dti->size);
+      a->count += b->count;
+      free(b->data);
+      memmove(b, b + 1, (sa->chunk_count - left - 2) * sizeof(Chunk));
+      sa->chunk_count--;
+    }
+  }
+  if(sa->length * dti->size < STRUCTURES_SORTED_ARRAY_CHUNKED_BYTES / 4) {
+    internal_sorted_array_flatten(sa);
+  }
+}
+
+/**
+ * Forward merge of \p a and \p b into \p count buffers, each filled with \p fill elements except the last.
+ * Elements of \p b go before equal elements of \p a, like \ref internal_sorted_array_merge.
+ */
+static void internal_chunks_spread(const IDataType* dti, char** buffers, size_t count, size_t fill, const char* a, size_t na,
+                                   const char* b, size_t nb) {
+  const char* end_a = dti_element(dti, a, na);
+  const char* end_b = dti_element(dti, b, nb);
+  for(size_t i = 0; i < count; i++) {
+    char* dest = buffers[i];
+    for(size_t j = 0; j < fill && (a < end_a || b < end_b); j++) {
+      if(b == end_b || (a < end_a && dti->cmp_l(dti, add_offset(a, dti->offset), add_offset(b, dti->offset)))) {
+        memcpy(dest, a, dti->size);
+        a += dti->size;
       }
       else {
-        EARLY_TRACE("internal_sorted_array_remove reallocated memory block in place!");
+        memcpy(dest, b, dti->size);
+        b += dti->size;
       }
+      dest += dti->size;
     }
   }
 }
 
+/**
+ * Merges \p count sorted elements into a chunked array, without joining its chunks.
+ * Every chunk is merged with the elements which belong in it, in place when they fit,
+ * or else it is split into chunks filled like \ref internal_sorted_array_chunk does.
+ * Everything is allocated up front, so that the array is unchanged on failure.
+ */
+static int internal_chunks_merge(SortedArray* sa, const char* array, size_t count) {
+  const IDataType* dti = sa->interface;
+  size_t chunk_elements = internal_chunk_elements(dti);
+  size_t fill = chunk_elements - chunk_elements / 4;
+  size_t old_count = sa->chunk_count;
+  // Elements before ends[c] of array, and after the previous end, go in chunk c.
+  size_t* ends = falloc_malloc(old_count * sizeof(size_t));
+  if(ends == NULL) {
+    EARLY_TRACE("internal_chunks_merge could not allocate temp storage!");
+    return 1;
+  }
+  size_t extra = 0;
+  size_t begin = 0;
+  for(size_t c = 0; c < old_count; c++) {
+    Chunk* chunk = &sa->chunks[c];
+    size_t end = count;
+    if(c != old_count - 1) {
+      // Same chunk as a stable insert would pick.
+      void* last = internal_chunk_item(dti, chunk, chunk->count - 1);
+      end = begin + internal_sorted_array_bound(dti, (void*)dti_element(dti, array, begin), count - begin, last, 1);
+    }
+    ends[c] = end;
+    size_t merged = chunk->count + end - begin;
+    if(merged > chunk_elements) {
+      extra += (merged + fill - 1) / fill - 1;
+    }
+    begin = end;
+  }
+  char** buffers = NULL;
+  char* scratch = NULL;
+  size_t allocated = 0;
+  if(extra != 0) {
+    buffers = falloc_malloc((extra + 1) * sizeof(char*));
+    scratch = malloc(chunk_elements * dti->size);
+    if(buffers != NULL && scratch != NULL && internal_chunks_reserve(sa, old_count + extra) == 0) {
+      for(; allocated < extra; allocated++) {
+        buffers[allocated + 1] = malloc(chunk_elements * dti->size);
+        if(buffers[allocated + 1] == NULL) {
+          break;
+        }
+      }
+    }
+    if(allocated != extra) {
+      EARLY_TRACE("internal_chunks_merge could not allocate chunks!");
+      for(size_t i = 0; i < allocated; i++) {
+        free(buffers[i + 1]);
+      }
+      free(scratch);
+      if(buffers != NULL) {
+        falloc_free(buffers);
+      }
+      falloc_free(ends);
+      return 1;
+    }
+  }
+  // Nothing fails from here on.
+  // Chunks are moved to their final slots from the last one, so unprocessed chunks are never overwritten.
+  char** fresh = buffers == NULL ? NULL : buffers + 1 + extra;
+  size_t slot = old_count + extra;
+  for(size_t c = old_count; c > 0; c--) {
+    Chunk chunk = sa->chunks[c - 1];
+    size_t first = c == 1 ? 0 : ends[c - 2];
+    const char* slice = dti_element(dti, array, first);
+    size_t slice_count = ends[c - 1] - first;
+    size_t merged = chunk.count + slice_count;
+    if(merged <= chunk_elements) {
+      if(slice_count != 0) {
+        internal_sorted_array_merge(chunk.data, chunk.count, slice, slice_count, dti);
+        chunk.count = merged;
+      }
+      sa->chunks[--slot] = chunk;
+      continue;
+    }
+    size_t pieces = (merged + fill - 1) / fill;
+    // The chunk's own buffer gets written first, so its elements are read from a copy.
+    memcpy(scratch, chunk.data, chunk.count * dti->size);
+    fresh -= pieces - 1;
+    char** targets = fresh - 1;
+    char* reused = targets[0];
+    targets[0] = chunk.data;
+    internal_chunks_spread(dti, targets, pieces, fill, scratch, chunk.count, slice, slice_count);
+    targets[0] = reused;
+    slot -= pieces;
+    for(size_t i = 0; i < pieces; i++) {
+      sa->chunks[slot + i].data = i == 0 ? chunk.data : fresh[i - 1];
+      sa->chunks[slot + i].count = i == pieces - 1 ? merged - (pieces - 1) * fill : fill;
+    }
+  }
+  sa->chunk_count = old_count + extra;
+  sa->length += count;
+  size_t index = 0;
+  for(size_t c = 0; c < sa->chunk_count; c++) {
+    sa->chunks[c].first = index;
+    index += sa->chunks[c].count;
+  }
+  free(scratch);
+  if(buffers != NULL) {
+    falloc_free(buffers);
+  }
+  falloc_free(ends);
+  return 0;
+}
+
+/**
+ * Merges an already sorted array in.
+ */
+static int internal_sorted_array_merge_sorted(SortedArray* sa, const void* array, size_t count) {
+  const IDataType* dti = sa->interface;
+  if(count == 0) {
+    return 0;
+  }
+  if(internal_is_chunked(sa)) {
+    if(count < sa->length / 16) {
+      // Few elements, so insert them one by one.
+      for(size_t i = 0; i < count; i++) {
+        const void* value = dti_element(dti, array, i);
+        size_t c = internal_chunk_find_key(sa, add_offset(value, dti->offset), 1);
+        Chunk* chunk = &sa->chunks[c];
+        size_t index = internal_sorted_array_bound(dti, chunk->data, chunk->count, add_offset(value, dti->offset), 1);
+        if(internal_chunks_insert(sa, c, index, value) == INVALID_SIZE_T) {
+          return 1;
+        }
+      }
+      return 0;
+    }
+    // Many elements, so merge them chunk by chunk.
+    return internal_chunks_merge(sa, array, count);
+  }
+  if(sa->length == 0) {
+    sa->start_offset = 0;
+    if(internal_sorted_array_grow(sa, count, 1)) {
+      return 1;
+    }
+    memcpy(sa->allocated, array, dti->size * count);
+    sa->length = count;
+  }
+  else {
+    // Ensure destination has enough space.
+    if(internal_sorted_array_grow(sa, sa->length + count, 0)) {
+      return 1;
+    }
+    // Merge sorted input array to destination.
+    void* start_address = internal_sorted_array_pointer(sa);
+    internal_sorted_array_merge(start_address, sa->length, array, count, dti);
+    sa->length += count;
+  }
+  internal_sorted_array_check_grow(sa);
+  return 0;
+}
+
 /*
  * Api/Exported functions.
  */
@@ -253,7 +748,12 @@ SortedArray* sorted_array_create(const IDataType* interface) {
     ret->allocated = NULL;
     ret->length = 0;
     ret->start_offset = 0;
+    ret->capacity = 0;
     ret->interface = interface;
+    ret->chunks = NULL;
+    ret->chunk_count = 0;
+    ret->chunk_capacity = 0;
+    ret->chunked_bytes = STRUCTURES_SORTED_ARRAY_CHUNKED_BYTES;
   }
   return ret;
 }
@@ -263,15 +763,27 @@ size_t sorted_array_size(SortedArray* sa) {
 }
 
 void* sorted_array_pointer(SortedArray* sa) {
+  if(internal_is_chunked(sa)) {
+    if(internal_sorted_array_flatten(sa)) {
+      return NULL;
+    }
+    // Joining took linear time, so stay flat until as many elements were added.
+    sa->chunked_bytes = 2 * sa->length * sa->interface->size;
+  }
   return internal_sorted_array_pointer(sa);
 }
 
 size_t sorted_array_find(SortedArray* sa, const void* value) {
+  // Add offset to value.
+  const void* value_key = add_offset(value, sa->interface->offset);
+  if(internal_is_chunked(sa)) {
+    Chunk* chunk = &sa->chunks[internal_chunk_find_key(sa, value_key, 0)];
+    SizeBool index_bool = internal_sorted_array_find(sa->interface, chunk->data, chunk->count, value_key);
+    return index_bool.boolean ? chunk->first + index_bool.size : INVALID_SIZE_T;
+  }
   // Get current state.
   void* start_address = internal_sorted_array_pointer(sa);
   size_t length = internal_sorted_array_size(sa);
-  // Add offset to value.
-  const void* value_key = add_offset(value, sa->interface->offset);
   // Perform binary search.
   SizeBool index_bool = internal_sorted_array_find(sa->interface, start_address, length, value_key);
   // Test mask if value was actually found.
@@ -284,43 +796,44 @@ size_t sorted_array_find(SortedArray* sa, const void* value) {
 }
 
 int sorted_array_get(SortedArray* sa, void* result, size_t index) {
-  // Get base address.
-  void* start_address = internal_sorted_array_pointer(sa);
   // Perform bound checking.
   size_t length = internal_sorted_array_size(sa);
   if(COLD_BRANCH(index >= length)) {
     return 1;
   }
-  void* index_address = dti_element(sa->interface, start_address, index);
+  void* index_address;
+  if(internal_is_chunked(sa)) {
+    Chunk* chunk = &sa->chunks[internal_chunk_find_index(sa, index)];
+    index_address = dti_element(sa->interface, chunk->data, index - chunk->first);
+  }
+  else {
+    index_address = dti_element(sa->interface, internal_sorted_array_pointer(sa), index);
+  }
   memcpy(result, index_address, sa->interface->size);
   return 0;
 }
 
-size_t sorted_array_insert(SortedArray* sa, const void* value) {
-  // Get current state.
-  void* start_address = internal_sorted_array_pointer(sa);
-  size_t length = internal_sorted_array_size(sa);
+/**
+ * Common part of \ref sorted_array_insert and \ref sorted_array_insert_stable.
+ */
+static inline size_t internal_sorted_array_insert_value(SortedArray* sa, const void* value, int stable) {
   // Add offset to value.
   const void* value_key = add_offset(value, sa->interface->offset);
-  // First find the address the new item is going to go in.
-  size_t index = internal_sorted_array_find(sa->interface, start_address, length, value_key).size;
-  if(internal_sorted_array_insert(sa, start_address, length, value, index)) {
-    return index;
-  }
-  else {
-    return INVALID_SIZE_T;
+  if(internal_is_chunked(sa)) {
+    size_t c = internal_chunk_find_key(sa, value_key, stable);
+    Chunk* chunk = &sa->chunks[c];
+    size_t index = stable ? internal_sorted_array_bound(sa->interface, chunk->data, chunk->count, value_key, 1)
+                          : internal_sorted_array_find(sa->interface, chunk->data, chunk->count, value_key).size;
+    return internal_chunks_insert(sa, c, index, value);
   }
-}
-
-size_t sorted_array_insert_stable(SortedArray* sa, const void* value) {
   // Get current state.
   void* start_address = internal_sorted_array_pointer(sa);
   size_t length = internal_sorted_array_size(sa);
-  // Add offset to value.
-  const void* value_key = add_offset(value, sa->interface->offset);
   // First find the address the new item is going to go in.
-  size_t index = internal_sorted_array_find_stable(sa->interface, start_address, length, value_key, 1).size;
+  size_t index = stable ? internal_sorted_array_bound(sa->interface, start_address, length, value_key, 1)
+                        : internal_sorted_array_find(sa->interface, start_address, length, value_key).size;
   if(internal_sorted_array_insert(sa, start_address, length, value, index)) {
+    internal_sorted_array_check_grow(sa);
     return index;
   }
   else {
@@ -328,18 +841,26 @@ size_t sorted_array_insert_stable(SortedArray* sa, const void* value) {
   }
 }
 
+size_t sorted_array_insert(SortedArray* sa, const void* value) {
+  return internal_sorted_array_insert_value(sa, value, 0);
+}
+
+size_t sorted_array_insert_stable(SortedArray* sa, const void* value) {
+  return internal_sorted_array_insert_value(sa, value, 1);
+}
+
 int sorted_array_merge(SortedArray* sa, const void* array, size_t count) {
   // Empty dest case.
-  if(sa->allocated == NULL) {
-    sa->allocated = malloc(sa->interface->size * count);
-    if(sa->allocated == NULL) {
-      EARLY_TRACE("sorted_array_merge could not allocate new memory block!");
+  if(sa->length == 0) {
+    sa->start_offset = 0;
+    if(internal_sorted_array_grow(sa, count, 1)) {
       return 1;
     }
     // Just copy contents and sort.
     memcpy(sa->allocated, array, sa->interface->size * count);
     sort(sa->allocated, count, sa->interface);
     sa->length = count;
+    internal_sorted_array_check_grow(sa);
     return 0;
   }
   // Create a copy of the input array.
@@ -351,30 +872,12 @@ int sorted_array_merge(SortedArray* sa, const void* array, size_t count) {
   memcpy(array_rw, array, sa->interface->size * count);
   // First sort input array.
   sort(array_rw, count, sa->interface);
-  // Ensure destination has enough space.
-  void* new_allocated = realloc(sa->allocated, sa->interface->size * (sa->start_offset + sa->length + count));
-  if(new_allocated == NULL) {
-    EARLY_TRACE("sorted_array_merge could not reallocate memory block!");
-    return 1;
-  }
-  else if(new_allocated != sa->allocated) {
-    EARLY_TRACE("sorted_array_merge relocated memory block!");
-    sa->allocated = new_allocated;
-  }
-  else {
-    EARLY_TRACE("sorted_array_merge reallocated memory block in place!");
-  }
-  // Merge sorted input array to destination.
-  void* start_address = internal_sorted_array_pointer(sa);
-  internal_sorted_array_merge(start_address, sa->length, array_rw, count, sa->interface);
-  sa->length += count;
-  // Success!
+  int ret = internal_sorted_array_merge_sorted(sa, array_rw, count);
   falloc_free(array_rw);
-  return 0;
+  return ret;
 }
 
 int sorted_array_merge_sorted(SortedArray* a, SortedArray* b) {
-  const IDataType* interface = a->interface;
   if(COLD_BRANCH(a == b)) {
     EARLY_TRACE("sorted_array_merge_sorted got the same array!");
     return 1;
@@ -383,36 +886,29 @@ int sorted_array_merge_sorted(SortedArray* a, SortedArray* b) {
     // Nothing to do.
     return 0;
   }
-  if(a->length == 0) {
-    // Just copy b into a.
-    size_t bytes = interface->size * b->length;
-    a->allocated = malloc(bytes);
-    if(a->allocated == NULL) {
-      EARLY_TRACE("sorted_array_merge_sorted could not allocate new memory block!");
+  if(!internal_is_chunked(b)) {
+    return internal_sorted_array_merge_sorted(a, internal_sorted_array_pointer(b), b->length);
+  }
+  // Merge chunk by chunk.
+  for(size_t i = 0; i < b->chunk_count; i++) {
+    if(internal_sorted_array_merge_sorted(a, b->chunks[i].data, b->chunks[i].count)) {
       return 1;
     }
-    memcpy(a->allocated, b->allocated, bytes);
-    return 0;
-  }
-  // Nothing special is going on, so just do a normal merge into a.
-  // First expand a.
-  void* new_a = realloc(a->allocated, interface->size * (a->start_offset + a->length + b->length));
-  if(new_a == NULL) {
-    EARLY_TRACE("sorted_array_merge_sorted could not reallocate memory block!");
-    return 1;
   }
-  else if(new_a != a->allocated) {
-    EARLY_TRACE("sorted_array_merge_sorted relocated memory block!");
-    a->allocated = new_a;
+  return 0;
+}
+
+/**
+ * Removes the element at \p index, which must be in bounds.
+ */
+static inline void internal_sorted_array_erase(SortedArray* sa, size_t index) {
+  if(internal_is_chunked(sa)) {
+    size_t c = internal_chunk_find_index(sa, index);
+    internal_chunks_remove(sa, c, index - sa->chunks[c].first);
   }
   else {
-    EARLY_TRACE("sorted_array_merge_sorted reallocated memory block in place!");
+    internal_sorted_array_remove(sa, index);
   }
-  void* start_a = internal_sorted_array_pointer(a);
-  void* start_b = internal_sorted_array_pointer(b);
-  internal_sorted_array_merge(start_a, a->length, start_b, b->length, interface);
-  a->length += b->length;
-  return 0;
 }
 
 int sorted_array_erase(SortedArray* sa, size_t index) {
@@ -421,35 +917,41 @@ int sorted_array_erase(SortedArray* sa, size_t index) {
     return 1;
   }
   // Actual remove.
-  internal_sorted_array_remove(sa, index);
+  internal_sorted_array_erase(sa, index);
   return 0;
 }
 
 size_t sorted_array_delete(SortedArray* sa, const void* value) {
-  void* start_address = internal_sorted_array_pointer(sa);
-  size_t length = internal_sorted_array_size(sa);
-  const void* key_address = add_offset(value, sa->interface->offset);
-  SizeBool index_bool = internal_sorted_array_find(sa->interface, start_address, length, key_address);
-  if(index_bool.boolean) {
+  size_t index = sorted_array_find(sa, value);
+  if(index != INVALID_SIZE_T) {
     // Value found.
-    size_t index = index_bool.size;
-    internal_sorted_array_remove(sa, index);
-    return index;
+    internal_sorted_array_erase(sa, index);
   }
-  // Value not found.
-  return INVALID_SIZE_T;
+  return index;
 }
 
 size_t sorted_array_delete_stable(SortedArray* sa, const void* value) {
-  void* start_address = internal_sorted_array_pointer(sa);
-  size_t length = internal_sorted_array_size(sa);
-  const void* key_address = add_offset(value, sa->interface->offset);
-  SizeBool index_bool = internal_sorted_array_find_stable(sa->interface, start_address, length, key_address, 0);
-  if(index_bool.boolean) {
+  const IDataType* dti = sa->interface;
+  const void* key_address = add_offset(value, dti->offset);
+  void* base_address;
+  size_t length;
+  size_t first;
+  if(internal_is_chunked(sa)) {
+    Chunk* chunk = &sa->chunks[internal_chunk_find_key(sa, key_address, 0)];
+    base_address = chunk->data;
+    length = chunk->count;
+    first = chunk->first;
+  }
+  else {
+    base_address = internal_sorted_array_pointer(sa);
+    length = internal_sorted_array_size(sa);
+    first = 0;
+  }
+  size_t index = internal_sorted_array_bound(dti, base_address, length, key_address, 0);
+  if(index < length && dti->cmp_eq(dti, dti_item(dti, base_address, index), key_address)) {
     // Value found.
-    size_t index = index_bool.size;
-    internal_sorted_array_remove(sa, index);
-    return index;
+    internal_sorted_array_erase(sa, first + index);
+    return first + index;
   }
   // Value not found.
   return INVALID_SIZE_T;
@@ -457,22 +959,76 @@ size_t sorted_array_delete_stable(SortedArray* sa, const void* value) {
 
 void sorted_array_clear(SortedArray* sa) {
   // Most efficient way you say?
+  internal_chunks_free(sa);
   free(sa->allocated);
   sa->allocated = NULL;
   sa->length = 0;
   sa->start_offset = 0;
+  sa->capacity = 0;
+  sa->chunked_bytes = STRUCTURES_SORTED_ARRAY_CHUNKED_BYTES;
+}
+
+int sorted_array_reserve(SortedArray* sa, size_t count) {
+  if(internal_is_chunked(sa)) {
+    // Chunks are at least half full after splitting.
+    size_t half = internal_chunk_elements(sa->interface) / 2;
+    return internal_chunks_reserve(sa, (count + half - 1) / half);
+  }
+  // Past this, the array switches to chunks anyway.
+  size_t flat_max = sa->chunked_bytes / sa->interface->size;
+  if(count > flat_max) {
+    count = flat_max;
+  }
+  if(count <= sa->length) {
+    return 0;
+  }
+  return internal_sorted_array_grow(sa, count, 1);
 }
 
 void sorted_array_compact(SortedArray* sa) {
+  if(internal_is_chunked(sa)) {
+    // Repack into full chunks.
+    char* flat = malloc(sa->length * sa->interface->size);
+    if(flat == NULL) {
+      EARLY_TRACE("sorted_array_compact could not allocate memory block!");
+      return;
+    }
+    for(size_t i = 0; i < sa->chunk_count; i++) {
+      Chunk* chunk = &sa->chunks[i];
+      memcpy(dti_element(sa->interface, flat, chunk->first), chunk->data, chunk->count * sa->interface->size);
+    }
+    Chunk* old_chunks = sa->chunks;
+    size_t old_count = sa->chunk_count;
+    if(internal_chunks_from(sa, flat, sa->length, internal_chunk_elements(sa->interface)) == 0) {
+      for(size_t i = 0; i < old_count; i++) {
+        free(old_chunks[i].data);
+      }
+      free(old_chunks);
+    }
+    free(flat);
+    return;
+  }
+  if(sa->length == 0) {
+    free(sa->allocated);
+    sa->allocated = NULL;
+    sa->start_offset = 0;
+    sa->capacity = 0;
+    return;
+  }
   if(sa->start_offset > 0) {
     // Remove offset by moving all the elements to the start.
     void* start_address = internal_sorted_array_pointer(sa);
     memmove(sa->allocated, start_address, sa->interface->size * sa->length);
     sa->start_offset = 0;
-    // Free unused space.
-    void* new_allocated = realloc(sa->allocated, sa->interface->size * sa->length);
+  }
+  // Free unused space, only when less than half is used.
+  // Some space is left, so that growing again does not immediately reallocate.
+  if(sa->capacity / 2 > sa->length) {
+    size_t capacity = sa->length + sa->length / 2;
+    void* new_allocated = realloc(sa->allocated, sa->interface->size * capacity);
     if(new_allocated == NULL) {
       EARLY_TRACE("sorted_array_compact could not reallocate memory block!");
+      return;
     }
     else if(new_allocated != sa->allocated) {
       EARLY_TRACE("sorted_array_compact relocated memory block!");
@@ -481,10 +1037,185 @@ void sorted_array_compact(SortedArray* sa) {
     else {
       EARLY_TRACE("sorted_array_compact reallocated memory block in place!");
     }
+    sa->capacity = capacity;
   }
 }
 
 void sorted_array_destroy(SortedArray* sa) {
+  internal_chunks_free(sa);
   free(sa->allocated);
   free(sa);
-}
\ No newline at end of file
+}
+
+/*
+ * Read optimized lookup snapshots.
+ * Elements are stored in Eytzinger order, starting from index 1:
+ * the children of element k are 2k and 2k + 1, so the first levels
+ * of every search share the same few cache lines.
+ */
+
+struct SortedArrayLookup {
+  // Elements in Eytzinger order, element 0 is unused.
+  char* elements;
+  // Start of allocated memory for elements.
+  void* elements_allocated;
+  // Ordered keys of elements, when they are smaller than the elements.
+  uint64_t* keys;
+  // Start of allocated memory for keys.
+  void* keys_allocated;
+  // If keys can be compared as ordered keys, instead of with the compare functions.
+  int scalar;
+  // Nodes which fit in a cache line. The descendants of node k, log2(stride) levels down, start at stride * k.
+  size_t stride;
+  // Amount of elements stored.
+  size_t length;
+  // Interface of the SortedArray the snapshot was taken from.
+  const IDataType* interface;
+};
+
+/*
+ * Walks the elements of a SortedArray in order, whether it is chunked or not.
+ */
+typedef struct {
+  SortedArray* sa;
+  size_t chunk;
+  size_t index;
+} Cursor;
+
+static inline const void* internal_cursor_next(Cursor* cursor) {
+  SortedArray* sa = cursor->sa;
+  if(!internal_is_chunked(sa)) {
+    return dti_element(sa->interface, internal_sorted_array_pointer(sa), cursor->index++);
+  }
+  if(cursor->index == sa->chunks[cursor->chunk].count) {
+    cursor->chunk++;
+    cursor->index = 0;
+  }
+  return dti_element(sa->interface, sa->chunks[cursor->chunk].data, cursor->index++);
+}
+
+/**
+ * In order traversal of the implicit tree, which visits elements in sorted order.
+ */
+static void internal_lookup_build(SortedArrayLookup* lookup, Cursor* cursor, size_t k) {
+  if(k <= lookup->length) {
+    internal_lookup_build(lookup, cursor, 2 * k);
+    memcpy(dti_element(lookup->interface, lookup->elements, k), internal_cursor_next(cursor), lookup->interface->size);
+    internal_lookup_build(lookup, cursor, 2 * k + 1);
+  }
+}
+
+/**
+ * Allocates \p bytes starting at a cache line.
+ * The pointer to free is stored at \p allocated.
+ */
+static inline void* internal_lookup_alloc(size_t bytes, size_t alignment, void** allocated) {
+  *allocated = malloc(bytes + alignment);
+  if(*allocated == NULL) {
+    return NULL;
+  }
+  return (void*)(((uintptr_t)*allocated + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+SortedArrayLookup* sorted_array_lookup_create(SortedArray* sa) {
+  const IDataType* dti = sa->interface;
+  SortedArrayLookup* lookup = malloc(sizeof(SortedArrayLookup));
+  if(lookup == NULL) {
+    return NULL;
+  }
+  size_t alignment = ssce_get_runtime()->cpu_cache_alignment;
+  alignment = alignment != 0 ? alignment : 64;
+  lookup->length = sa->length;
+  lookup->interface = dti;
+  lookup->keys = NULL;
+  lookup->keys_allocated = NULL;
+  lookup->scalar = dti_has_ordered_key(dti);
+  lookup->elements = internal_lookup_alloc((sa->length + 1) * dti->size, alignment, &lookup->elements_allocated);
+  if(lookup->elements == NULL) {
+    EARLY_TRACE("sorted_array_lookup_create could not allocate elements!");
+    free(lookup);
+    return NULL;
+  }
+  Cursor cursor = {sa, 0, 0};
+  internal_lookup_build(lookup, &cursor, 1);
+  size_t node_size = dti->size;
+  if(lookup->scalar && dti->size > sizeof(uint64_t)) {
+    // Big elements, so search a denser copy of the keys.
+    lookup->keys = internal_lookup_alloc((sa->length + 1) * sizeof(uint64_t), alignment, &lookup->keys_allocated);
+    if(lookup->keys == NULL) {
+      // Not fatal, search the elements instead.
+      EARLY_TRACE("sorted_array_lookup_create could not allocate keys!");
+    }
+    else {
+      for(size_t k = 1; k <= lookup->length; k++) {
+        lookup->keys[k] = dti_ordered_key(dti, dti_item(dti, lookup->elements, k));
+      }
+      node_size = sizeof(uint64_t);
+    }
+  }
+  lookup->stride = 1;
+  while(lookup->stride * 2 * node_size <= alignment) {
+    lookup->stride *= 2;
+  }
+  return lookup;
+}
+
+size_t sorted_array_lookup_size(SortedArrayLookup* lookup) {
+  return lookup->length;
+}
+
+/**
+ * Returns the Eytzinger index of the first element not smaller than the key, or 0 if there is none.
+ */
+static inline size_t internal_lookup_lower_bound(SortedArrayLookup* lookup, const void* key_address) {
+  const IDataType* dti = lookup->interface;
+  size_t n = lookup->length;
+  size_t stride = lookup->stride;
+  size_t k = 1;
+  // Descendants a few levels down share a cache line, so it gets prefetched early.
+  if(lookup->keys != NULL) {
+    const uint64_t* keys = lookup->keys;
+    uint64_t key = dti_ordered_key(dti, key_address);
+    while(k <= n) {
+      PREFETCH((const void*)((uintptr_t)keys + stride * k * sizeof(uint64_t)));
+      k = 2 * k + (keys[k] < key);
+    }
+  }
+  else if(lookup->scalar) {
+    uint64_t key = dti_ordered_key(dti, key_address);
+    while(k <= n) {
+      PREFETCH(dti_element(dti, lookup->elements, stride * k));
+      k = 2 * k + (dti_ordered_key(dti, dti_item(dti, lookup->elements, k)) < key);
+    }
+  }
+  else {
+    while(k <= n) {
+      PREFETCH(dti_element(dti, lookup->elements, stride * k));
+      k = 2 * k + (dti->cmp_l(dti, dti_item(dti, lookup->elements, k), key_address) != 0);
+    }
+  }
+  // Going right means smaller, so undo the right turns after the last left turn.
+  k >>= __builtin_ctzll(~(unsigned long long)k) + 1;
+  return k;
+}
+
+const void* sorted_array_lookup_lower_bound(SortedArrayLookup* lookup, const void* value) {
+  size_t k = internal_lookup_lower_bound(lookup, add_offset(value, lookup->interface->offset));
+  return k != 0 ? dti_element(lookup->interface, lookup->elements, k) : NULL;
+}
+
+const void* sorted_array_lookup_find(SortedArrayLookup* lookup, const void* value) {
+  const IDataType* dti = lookup->interface;
+  const void* value_key = add_offset(value, dti->offset);
+  size_t k = internal_lookup_lower_bound(lookup, value_key);
+  if(k != 0 && dti->cmp_eq(dti, dti_item(dti, lookup->elements, k), value_key)) {
+    return dti_element(dti, lookup->elements, k);
+  }
+  return NULL;
+}
+
+void sorted_array_lookup_destroy(SortedArrayLookup* lookup) {
+  free(lookup->keys_allocated);
+  free(lookup->elements_allocated);
+  free(lookup);
+}
@@ -3,6 +3,7 @@
 /**
  * @file
  * @brief A self sorting, resizable array.
+ * Big arrays are stored in chunks, so inserting and removing stays cheap.
  */
 
 #include <Interface.h>
@@ -36,9 +37,12 @@ EXPORT_API size_t sorted_array_size(SortedArray* sa) MARK_NONNULL_ARGS(1);
 /**
  * Gets a pointer to the internal backing array.
  * The pointer is valid only until the next time \d sa is used.
+ * If \p sa is stored in chunks, they are first joined into a single array,
+ * which takes linear time. The array then stays in a single block until its size doubles.
  * 
  * @param sa object returned from \ref sorted_array_create.
- * @returns a pointer to the start of the internal allocated array.
+ * @returns a pointer to the start of the internal allocated array,
+ * or null if joining chunks failed.
  */
 EXPORT_API void* sorted_array_pointer(SortedArray* sa) MARK_NONNULL_ARGS(1);
 
@@ -104,6 +108,18 @@ EXPORT_API int sorted_array_merge(SortedArray* sa, const void* array, size_t cou
  */
 EXPORT_API int sorted_array_merge_sorted(SortedArray* a, SortedArray* b) MARK_NONNULL_ARGS(1, 2);
 
+/**
+ * Preallocates memory, so that \p sa can grow up to \p count elements
+ * without reallocating its memory block.
+ * Big arrays are stored in chunks, in which case only the chunk list is reserved.
+ * 
+ * @param sa object returned from \ref sorted_array_create.
+ * @param count the expected number of elements.
+ * @returns non-zero if we are out of memory.
+ * In that case, \p sa is not modified.
+ */
+EXPORT_API int sorted_array_reserve(SortedArray* sa, size_t count) MARK_NONNULL_ARGS(1);
+
 /**
  * Deletes the element at \p index.
  * 
@@ -144,6 +160,8 @@ EXPORT_API void sorted_array_clear(SortedArray* sa) MARK_NONNULL_ARGS(1);
 
 /**
  * Cleans up and optimizes internal allocated memory.
+ * Unused memory is only released when less than half of it is used,
+ * and some is kept for future inserts.
  * 
  * @param sa object returned from \ref sorted_array_create.
  */
@@ -182,4 +200,57 @@ static inline int sorted_array_pop(SortedArray* sa, void* dest) {
   return 0;
 }
 
+/**
+ * Opaque structure containing a read only copy of a \ref SortedArray,
+ * laid out for fast searching.
+ * Elements are stored in Eytzinger(breadth first) order,
+ * so searches touch few cache lines and can prefetch ahead.
+ * Keys which support \ref dti_ordered_key are searched without branches,
+ * or calls to the compare functions.
+ */
+struct SortedArrayLookup;
+typedef struct SortedArrayLookup SortedArrayLookup;
+
+/**
+ * Creates a lookup snapshot of the current contents of \p sa.
+ * Later changes to \p sa are not reflected in the snapshot.
+ * 
+ * @param sa object returned from \ref sorted_array_create.
+ * @returns an opaque pointer to the allocated object or null if we are out of memory.
+ */
+EXPORT_API SortedArrayLookup* sorted_array_lookup_create(SortedArray* sa) MARK_OBJ_ALLOC MARK_NONNULL_ARGS(1);
+
+/**
+ * Returns the number of elements stored in \p lookup.
+ * 
+ * @param lookup object returned from \ref sorted_array_lookup_create.
+ * @returns the number of stored elements.
+ */
+EXPORT_API size_t sorted_array_lookup_size(SortedArrayLookup* lookup) MARK_NONNULL_ARGS(1);
+
+/**
+ * Searches for an element equal to \p value.
+ * 
+ * @param lookup object returned from \ref sorted_array_lookup_create.
+ * @param value a pointer to the value to search for(with no offset preapplied).
+ * @returns a pointer to the stored element, or null if the value could not be found.
+ */
+EXPORT_API const void* sorted_array_lookup_find(SortedArrayLookup* lookup, const void* value) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Searches for the first element which is not smaller than \p value.
+ * 
+ * @param lookup object returned from \ref sorted_array_lookup_create.
+ * @param value a pointer to the value to search for(with no offset preapplied).
+ * @returns a pointer to the stored element, or null if all elements are smaller.
+ */
+EXPORT_API const void* sorted_array_lookup_lower_bound(SortedArrayLookup* lookup, const void* value) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Deallocates all memory used by this \ref SortedArrayLookup.
+ * 
+ * @param lookup object returned from \ref sorted_array_lookup_create.
+ */
+EXPORT_API void sorted_array_lookup_destroy(SortedArrayLookup* lookup) MARK_NONNULL_ARGS(1);
+
 #endif /*SSCE_SORTED_ARRAY_H*/
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include "WSDequeue.h"
+#include "CacheLine.h"
+
+#include <Macros.h>
+#include <memory/GAlloc.h>
+#include <structures/Interface.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Capacity of the buffer, when none is given.
+ */
+#define DEFAULT_CAPACITY 64
+
+/*
+ * A circular buffer.
+ * Replaced buffers are kept in a list, until the dequeue is destroyed.
+ */
+typedef struct WSBuffer {
+  struct WSBuffer* previous;
+  size_t mask;
+  // Elements are stored right after, each padded to a multiple of a word.
+} WSBuffer;
+
+#define wsbuffer_slot(dq, b, index) ((size_t*)((b) + 1) + ((index) & (b)->mask) * (dq)->words)
+
+/*
+ * Implementation details:
+ * Elements are in [top, bottom).
+ * Indices increase forever and get masked on access.
+ * They are signed, as the owner may briefly decrement bottom below top while popping.
+ *
+ * Thieves may copy a slot while the owner reuses it, but then they always lose the race for top
+ * and throw away the copy. Slots are copied with relaxed atomic words, so that such races are well defined.
+ */
+struct WSDequeue {
+  // Next index to steal, on its own cache line.
+  int64_t* top;
+  // Next index to push, on its own cache line.
+  int64_t* bottom;
+  void* lines;
+  // Current buffer.
+  WSBuffer* buffer;
+  // Size of each slot in words.
+  size_t words;
+  const IDataType* interface;
+};
+
+/*
+ * Internal functions.
+ */
+
+/*
+ * Copies between elements and slots.
+ * Built in copies, since the library is built with -fno-builtin-memcpy and these copy at most a word.
+ */
+static inline void internal_wsdequeue_store(size_t* slot, const void* data, size_t size) {
+  const uint8_t* src = data;
+  size_t words = size / sizeof(size_t);
+  for(size_t i = 0; i < words; i++) {
+    size_t w;
+    __builtin_memcpy(&w, src + i * sizeof(size_t), sizeof(size_t));
+    __atomic_store_n(&slot[i], w, __ATOMIC_RELAXED);
+  }
+  if(size % sizeof(size_t) != 0) {
+    size_t w = 0;
+    __builtin_memcpy(&w, src + words * sizeof(size_t), size % sizeof(size_t));
+    __atomic_store_n(&slot[words], w, __ATOMIC_RELAXED);
+  }
+}
+
+static inline void internal_wsdequeue_load(const size_t* slot, void* data, size_t size) {
+  uint8_t* dst = data;
+  size_t words = size / sizeof(size_t);
+  for(size_t i = 0; i < words; i++) {
+    size_t w = __atomic_load_n(&slot[i], __ATOMIC_RELAXED);
+    __builtin_memcpy(dst + i * sizeof(size_t), &w, sizeof(size_t));
+  }
+  if(size % sizeof(size_t) != 0) {
+    size_t w = __atomic_load_n(&slot[words], __ATOMIC_RELAXED);
+    __builtin_memcpy(dst + words * sizeof(size_t), &w, size % sizeof(size_t));
+  }
+}
+
+static WSBuffer* internal_wsdequeue_buffer_alloc(WSDequeue* dq, size_t capacity) {
+  WSBuffer* b = malloc(sizeof(WSBuffer) + capacity * dq->words * sizeof(size_t));
+  if(b != NULL) {
+    b->previous = NULL;
+    b->mask = capacity - 1;
+  }
+  return b;
+}
+
+/**
+ * Doubles the buffer, copying the elements in [top, bottom).
+ * Only the owner calls this, thieves keep reading the old buffer until they see the new one.
+ */
+static WSBuffer* internal_wsdequeue_grow(WSDequeue* dq, WSBuffer* old, int64_t top, int64_t bottom) {
+  WSBuffer* b = internal_wsdequeue_buffer_alloc(dq, (old->mask + 1) * 2);
+  if(b == NULL) {
+    EARLY_TRACE("wsdequeue could not grow buffer!");
+    return NULL;
+  }
+  size_t bytes = dq->words * sizeof(size_t);
+  for(int64_t i = top; i < bottom; i++) {
+    size_t* dst = wsbuffer_slot(dq, b, (size_t)i);
+    const size_t* src = wsbuffer_slot(dq, old, (size_t)i);
+    // Only the owner writes slots, so no thief can be changing these.
+    internal_wsdequeue_load(src, dst, bytes);
+  }
+  b->previous = old;
+  __atomic_store_n(&dq->buffer, b, __ATOMIC_RELEASE);
+  return b;
+}
+
+/*
+ * Interface | Public Api.
+ */
+
+WSDequeue* wsdequeue_create(const IDataType* interface, size_t capacity) {
+  WSDequeue* obj = malloc(sizeof(WSDequeue));
+  if(obj == NULL) {
+    return NULL;
+  }
+  // Owner and thieves write top and bottom, so they get separate lines.
+  size_t alignment = internal_cache_line_alignment();
+  obj->lines = malloc(3 * alignment);
+  if(obj->lines == NULL) {
+    free(obj);
+    return NULL;
+  }
+  uint8_t* lines = (uint8_t*)((((uintptr_t)obj->lines) + alignment - 1) / alignment * alignment);
+  obj->top = (int64_t*)lines;
+  obj->bottom = (int64_t*)(lines + alignment);
+  *obj->top = 0;
+  *obj->bottom = 0;
+  obj->words = (interface->size + sizeof(size_t) - 1) / sizeof(size_t);
+  obj->interface = interface;
+  size_t rounded = 2;
+  while(rounded < (capacity != 0 ? capacity : DEFAULT_CAPACITY)) {
+    rounded <<= 1;
+  }
+  obj->buffer = internal_wsdequeue_buffer_alloc(obj, rounded);
+  if(obj->buffer == NULL) {
+    free(obj->lines);
+    free(obj);
+    return NULL;
+  }
+  return obj;
+}
+
+size_t wsdequeue_size(WSDequeue* dq) {
+  int64_t top = __atomic_load_n(dq->top, __ATOMIC_ACQUIRE);
+  int64_t bottom = __atomic_load_n(dq->bottom, __ATOMIC_ACQUIRE);
+  return bottom > top ? (size_t)(bottom - top) : 0;
+}
+
+int wsdequeue_push(WSDequeue* dq, const void* data) {
+  int64_t bottom = __atomic_load_n(dq->bottom, __ATOMIC_RELAXED);
+  int64_t top = __atomic_load_n(dq->top, __ATOMIC_ACQUIRE);
+  WSBuffer* b = __atomic_load_n(&dq->buffer, __ATOMIC_RELAXED);
+  if(COLD_BRANCH(bottom - top > (int64_t)b->mask)) {
+    b = internal_wsdequeue_grow(dq, b, top, bottom);
+    if(b == NULL) {
+      return 1;
+    }
+  }
+  internal_wsdequeue_store(wsbuffer_slot(dq, b, (size_t)bottom), data, dq->interface->size);
+  // Publish the element to thieves.
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(dq->bottom, bottom + 1, __ATOMIC_RELAXED);
+  return 0;
+}
+
+int wsdequeue_pop(WSDequeue* dq, void* data) {
+  int64_t bottom = __atomic_load_n(dq->bottom, __ATOMIC_RELAXED) - 1;
+  WSBuffer* b = __atomic_load_n(&dq->buffer, __ATOMIC_RELAXED);
+  // Reserve the bottom element before looking at top.
+  __atomic_store_n(dq->bottom, bottom, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t top = __atomic_load_n(dq->top, __ATOMIC_RELAXED);
+  if(COLD_BRANCH(top > bottom)) {
+    // Empty.
+    __atomic_store_n(dq->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return 1;
+  }
+  internal_wsdequeue_load(wsbuffer_slot(dq, b, (size_t)bottom), data, dq->interface->size);
+  if(COLD_BRANCH(top == bottom)) {
+    // Last element, race thieves for it.
+    int won = __atomic_compare_exchange_n(dq->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(dq->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return !won;
+  }
+  return 0;
+}
+
+int wsdequeue_steal(WSDequeue* dq, void* data) {
+  int64_t top = __atomic_load_n(dq->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t bottom = __atomic_load_n(dq->bottom, __ATOMIC_ACQUIRE);
+  if(top >= bottom) {
+    return 1;
+  }
+  WSBuffer* b = __atomic_load_n(&dq->buffer, __ATOMIC_ACQUIRE);
+  internal_wsdequeue_load(wsbuffer_slot(dq, b, (size_t)top), data, dq->interface->size);
+  if(!__atomic_compare_exchange_n(dq->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    // Owner or another thief got it first.
+    return -1;
+  }
+  return 0;
+}
+
+void wsdequeue_destroy(WSDequeue* dq) {
+  WSBuffer* b = dq->buffer;
+  while(b != NULL) {
+    WSBuffer* previous = b->previous;
+    free(b);
+    b = previous;
+  }
+  free(dq->lines);
+  free(dq);
+}
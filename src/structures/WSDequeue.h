@@ -0,0 +1,88 @@
+#ifndef SSCE_WSDEQUEUE_H
+#define SSCE_WSDEQUEUE_H
+/**
+ * @file
+ * @brief Work stealing double ended queue of fixed type elements (Chase-Lev).
+ *
+ * A single owner thread pushes and pops elements at the bottom, like a stack.
+ * Any other thread can steal elements from the top, oldest first.
+ * Nothing takes a lock, and the owner only synchronizes with thieves
+ * when they race for the last element.
+ *
+ * The buffer grows when it is full and it never shrinks.
+ * Old buffers may still be read by slow thieves,
+ * so their memory is only released by \ref wsdequeue_destroy.
+ */
+
+#include <Interface.h>
+#include <Macros.h>
+
+#include <stddef.h>
+
+/**
+ * Opaque structure containing internal data.
+ */
+struct WSDequeue;
+typedef struct WSDequeue WSDequeue;
+
+/**
+ * Allocates a new empty WSDequeue object.
+ *
+ * @param interface \ref interface.
+ * @param capacity how many elements to allocate space for at initialization.
+ *   Use 0 to use the default.
+ * @returns the allocated WSDequeue or NULL if there was not enough memory available.
+ */
+EXPORT_API MARK_OBJ_ALLOC WSDequeue* wsdequeue_create(const IDataType* interface, size_t capacity) MARK_NONNULL_ARGS(1);
+
+/**
+ * Gets the number of currently stored elements.
+ * If other threads are using the dequeue, the result may already be out of date.
+ *
+ * @param dq \ref wsdequeue_create.
+ * @returns element count.
+ */
+EXPORT_API size_t wsdequeue_size(WSDequeue* dq) MARK_NONNULL_ARGS(1);
+
+/**
+ * Adds a copy of \p data at the bottom.
+ * Must only be called by the owner thread.
+ *
+ * @param dq \ref wsdequeue_create.
+ * @param data pointer to value to be added.
+ * @returns non zero if growing the buffer failed.
+ */
+EXPORT_API int wsdequeue_push(WSDequeue* dq, const void* data) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Retrieves and removes the element at the bottom, which is the newest one.
+ * Must only be called by the owner thread.
+ *
+ * @param dq \ref wsdequeue_create.
+ * @param data where the element will be placed.
+ *   Its contents are unspecified if nothing was popped.
+ * @returns non zero if the dequeue is empty.
+ */
+EXPORT_API int wsdequeue_pop(WSDequeue* dq, void* data) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Retrieves and removes the element at the top, which is the oldest one.
+ * Thread safe and lock free, may be called by any thread.
+ *
+ * @param dq \ref wsdequeue_create.
+ * @param data where the element will be placed.
+ *   Its contents are unspecified if nothing was stolen.
+ * @returns 0 if an element was stolen, a positive value if the dequeue is empty,
+ *   or a negative value if another thread took the element first, in which case stealing again may succeed.
+ */
+EXPORT_API int wsdequeue_steal(WSDequeue* dq, void* data) MARK_NONNULL_ARGS(1, 2);
+
+/**
+ * Frees all memory used by the dequeue.
+ * No other thread may be using it.
+ *
+ * @param dq \ref wsdequeue_create.
+ */
+EXPORT_API void wsdequeue_destroy(WSDequeue* dq) MARK_NONNULL_ARGS(1);
+
+#endif /*SSCE_WSDEQUEUE_H*/
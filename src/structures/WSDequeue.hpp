@@ -0,0 +1,20 @@
+#ifndef SSCE_WSDEQUEUE_HPP
+#define SSCE_WSDEQUEUE_HPP
+/**
+ * @file
+ * @brief Work stealing double ended queue of fixed type elements (Chase-Lev).
+ */
+
+#include <Macros.h>
+C_DECLS_START
+#include <WSDequeue.h>
+C_DECLS_END
+
+#include <Interface.hpp>
+
+namespace ssce {
+
+// TODO:
+
+} // namespace ssce
+#endif /*SSCE_WSDEQUEUE_HPP*/
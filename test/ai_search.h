@@ -218,7 +218,7 @@ static int npuzzle_heuristic(const NPuzzleSearchProblem* isp, const void* state)
 }
 
 static int npuzzle_state_cmp_eq(const IDataType* dti, const void* a, const void* b) {
-  return !memcmp(a, b, dti->size);
+  return !memcmp(a, b, dti->key_size);
 }
 
 static int npuzzle_state_cmp_l(const IDataType* dti, const void* a, const void* b) {
@@ -264,6 +264,7 @@ static inline void new_npuzzle(NPuzzleSearchProblem* o, IDataType* t, size_t n)
   t->cmp_le = (Compare)npuzzle_state_cmp_le;
   t->swap = (Operate)npuzzle_state_swap;
   t->hash = (Calculate)npuzzle_state_hash;
+  t->key_kind = KEY_KIND_OPAQUE;
 }
 
 static inline void gen_initial_state(void* dest, size_t n, ...) {
@@ -1,15 +1,22 @@
 #include "test_utils.h"
 
 #include <Bitfield.h>
+#include <Clock.h>
 #include <GAlloc.h>
 #include <Logger.h>
 #include <Macros.h>
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #define STRUCT_SIZE 64
+// Not a multiple of any vector width.
+#define WORD_OPS_WORDS 203
+#define WORD_OPS_BITS (WORD_OPS_WORDS * SIZE_T_BITS)
 
 static const size_t SET_BITS[] = {
   1 * sizeof(size_t),
@@ -22,6 +29,124 @@ static const size_t SET_BITS[] = {
   58 * sizeof(size_t)
 };
 
+static void fill_random(const Bitfield* bt, int density) {
+  for(size_t i = 0; i < bitfield_bits(bt); i++) {
+    bitfield_assign(bt, i, rand() % 100 < density);
+  }
+}
+
+/*
+ * Word operations checked bit by bit, on sparse, mixed and dense bitfields.
+ */
+static int test_word_ops(int density) {
+  static size_t data[3][WORD_OPS_WORDS];
+  static size_t other[WORD_OPS_WORDS + 1];
+  Bitfield a, b, c, wrong;
+  bitfield_init(&a, data[0], sizeof(data[0]));
+  bitfield_init(&b, data[1], sizeof(data[1]));
+  bitfield_init(&c, data[2], sizeof(data[2]));
+  bitfield_init(&wrong, other, sizeof(other));
+  fill_random(&a, density);
+  fill_random(&b, density);
+  if(bitfield_bits(&a) != WORD_OPS_BITS) {
+    return EXIT_FAILURE;
+  }
+  // Popcount, rank and select.
+  size_t count = 0;
+  for(size_t i = 0; i < WORD_OPS_BITS; i++) {
+    if(bitfield_rank(&a, i) != count) {
+      return EXIT_FAILURE;
+    }
+    if(bitfield_get(&a, i)) {
+      if(bitfield_select(&a, count) != i) {
+        return EXIT_FAILURE;
+      }
+      count++;
+    }
+  }
+  if(bitfield_popcount(&a) != count || bitfield_rank(&a, WORD_OPS_BITS) != count || bitfield_select(&a, count) != WORD_OPS_BITS) {
+    return EXIT_FAILURE;
+  }
+  // Searches.
+  for(size_t i = 0; i <= WORD_OPS_BITS; i++) {
+    size_t next_set = i;
+    while(next_set < WORD_OPS_BITS && !bitfield_get(&a, next_set)) {
+      next_set++;
+    }
+    size_t next_clear = i;
+    while(next_clear < WORD_OPS_BITS && bitfield_get(&a, next_clear)) {
+      next_clear++;
+    }
+    if(bitfield_find_next_set(&a, i) != next_set || bitfield_find_next_clear(&a, i) != next_clear) {
+      return EXIT_FAILURE;
+    }
+  }
+  // Binary operations, also in place.
+  if(!bitfield_and(&c, &a, &wrong) || !bitfield_or(&wrong, &a, &b)) {
+    return EXIT_FAILURE;
+  }
+  for(int op = 0; op < 4; op++) {
+    int failed = op == 0 ? bitfield_and(&c, &a, &b) : op == 1 ? bitfield_or(&c, &a, &b) : op == 2 ? bitfield_xor(&c, &a, &b) : bitfield_andnot(&c, &a, &b);
+    if(failed) {
+      return EXIT_FAILURE;
+    }
+    for(size_t i = 0; i < WORD_OPS_BITS; i++) {
+      int x = bitfield_get(&a, i);
+      int y = bitfield_get(&b, i);
+      int expected = op == 0 ? x && y : op == 1 ? x || y : op == 2 ? x != y : x && !y;
+      if(bitfield_get(&c, i) != expected) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  if(bitfield_xor(&a, &a, &a) || bitfield_popcount(&a) != 0) {
+    return EXIT_FAILURE;
+  }
+  // Ranges, with both ends inside, at and across word boundaries.
+  for(int r = 0; r < 1000; r++) {
+    size_t begin = rand() % (WORD_OPS_BITS + 1);
+    size_t end = begin + rand() % (r % 2 ? SIZE_T_BITS * 3 : 20);
+    end = end > WORD_OPS_BITS ? WORD_OPS_BITS : end;
+    int set = rand() % 2;
+    memcpy(data[2], data[1], sizeof(data[1]));
+    if(set) {
+      bitfield_set_range(&b, begin, end);
+    }
+    else {
+      bitfield_clear_range(&b, begin, end);
+    }
+    for(size_t i = 0; i < WORD_OPS_BITS; i++) {
+      int expected = i >= begin && i < end ? set : bitfield_get(&c, i);
+      if(bitfield_get(&b, i) != expected) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  // Filtered iteration visits exactly the matching bits, in order.
+  fill_random(&a, density);
+  size_t next = bitfield_find_next_set(&a, 0);
+  bitfield_for_each(&a, 1, density > 50, {
+    if(bit_index != next || !bit_value) {
+      return EXIT_FAILURE;
+    }
+    next = bitfield_find_next_set(&a, bit_index + 1);
+  });
+  if(next != WORD_OPS_BITS) {
+    return EXIT_FAILURE;
+  }
+  next = bitfield_find_next_clear(&a, 0);
+  bitfield_for_each(&a, 0, density > 50, {
+    if(bit_index != next || bit_value) {
+      return EXIT_FAILURE;
+    }
+    next = bitfield_find_next_clear(&a, bit_index + 1);
+  });
+  if(next != WORD_OPS_BITS) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
 int bench() {
   logger_set_level(LOGGER_INFO);
   const size_t size = bitfield_size(16 * 1024);
@@ -38,6 +163,29 @@ int bench() {
     })
   }
   bitfield_deinit(&bt);
+  free(data);
+  // Word operations on a bigger bitfield.
+  const size_t ops_size = bitfield_size(MBYTES(1));
+  void* ops_data = malloc(ops_size);
+  fill_light_garbage(ops_data, ops_size);
+  bitfield_init(&bt, ops_data, ops_size);
+  PerfClock pc;
+  clock_reset(&pc);
+  clock_start(&pc);
+  size_t count = 0;
+  for(size_t c = 0; c < 1024; c++) {
+    count += bitfield_popcount(&bt);
+  }
+  clock_stop(&pc);
+  printf("popcount: %6.4f (%zu)\n", pc.delta, count);
+  clock_start(&pc);
+  for(size_t c = 0; c < 1024; c++) {
+    bitfield_xor(&bt, &bt, &bt);
+  }
+  clock_stop(&pc);
+  printf("xor: %6.4f\n", pc.delta);
+  bitfield_deinit(&bt);
+  free(ops_data);
   return EXIT_SUCCESS;
 }
 
@@ -74,5 +222,10 @@ int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
     return EXIT_FAILURE;
   }
   bitfield_deinit(&bt);
+  free(data);
+  srand(time(NULL));
+  if(test_word_ops(3) || test_word_ops(50) || test_word_ops(97)) {
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
\ No newline at end of file
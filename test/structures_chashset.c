@@ -0,0 +1,244 @@
+#include "test_utils.h"
+
+#include <CHashSet.h>
+#include <Clock.h>
+#include <HashSet.h>
+#include <Macros.h>
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define THREAD_COUNT 4
+#define ADD_COUNT (KBYTES(64))
+#define BENCH_COUNT (MBYTES(1))
+
+static size_t mixed_hash(MARK_UNUSED const IDataType* ignored, const int* k) {
+  uint64_t h = (uint32_t)*k;
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return (size_t)h;
+}
+
+static const IDataType IDT_INT_MIXED = {4, 0, 4, (Compare)cst_cmp_e, (Compare)cst_cmp_l, (Compare)cst_cmp_le, (Operate)cst_swap, (Calculate)mixed_hash, KEY_KIND_SIGNED};
+
+typedef struct {
+  CHashSet* hs;
+  int id;
+  size_t inserted;
+  int failed;
+} Worker;
+
+/*
+ * Every thread inserts the same keys,
+ * so each key must be reported as new exactly once.
+ */
+static void* insert_worker(void* arg) {
+  Worker* w = arg;
+  for(int i = 0; i < ADD_COUNT; i++) {
+    // Each thread walks the keys in a different order.
+    int v = (i + w->id * (ADD_COUNT / THREAD_COUNT)) % ADD_COUNT;
+    int r = chashset_insert(w->hs, &v);
+    if(r < 0 || !chashset_contains(w->hs, &v)) {
+      w->failed = 1;
+      return NULL;
+    }
+    w->inserted += r;
+  }
+  return NULL;
+}
+
+/*
+ * Removes this thread's share of the even keys,
+ * while checking that odd keys never disappear.
+ */
+static void* remove_worker(void* arg) {
+  Worker* w = arg;
+  for(int v = 2 * w->id; v < ADD_COUNT; v += 2 * THREAD_COUNT) {
+    if(chashset_remove(w->hs, &v)) {
+      w->failed = 1;
+      return NULL;
+    }
+    int odd = v + 1;
+    if(!chashset_contains(w->hs, &odd) || chashset_get(w->hs, &odd)) {
+      w->failed = 1;
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Keeps replacing the odd keys, while reading other odd keys.
+ * Replaced elements are released while other threads may still be reading them.
+ */
+static void* churn_worker(void* arg) {
+  Worker* w = arg;
+  for(int i = 0; i < 4 * ADD_COUNT; i++) {
+    int v = 2 * ((i * 7 + w->id) % (ADD_COUNT / 2)) + 1;
+    if(chashset_add(w->hs, &v)) {
+      w->failed = 1;
+      return NULL;
+    }
+    int other = 2 * ((i * 13 + w->id * 3) % (ADD_COUNT / 2)) + 1;
+    int copy = other;
+    if(chashset_get(w->hs, &copy) || copy != other) {
+      w->failed = 1;
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+static int run_workers(CHashSet* hs, void* (*fn)(void*), Worker workers[THREAD_COUNT]) {
+  pthread_t threads[THREAD_COUNT];
+  for(int t = 0; t < THREAD_COUNT; t++) {
+    workers[t].hs = hs;
+    workers[t].id = t;
+    workers[t].inserted = 0;
+    workers[t].failed = 0;
+    if(pthread_create(&threads[t], NULL, fn, &workers[t])) {
+      return EXIT_FAILURE;
+    }
+  }
+  int failed = 0;
+  for(int t = 0; t < THREAD_COUNT; t++) {
+    pthread_join(threads[t], NULL);
+    failed |= workers[t].failed;
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int test(const IDataType* dti) {
+  Worker workers[THREAD_COUNT];
+  // Small initial size, so that expanding happens while threads are running.
+  CHashSet* hs = chashset_create(dti, 1, -1);
+  if(hs == NULL) {
+    return EXIT_FAILURE;
+  }
+  if(run_workers(hs, insert_worker, workers)) {
+    return EXIT_FAILURE;
+  }
+  size_t inserted = 0;
+  for(int t = 0; t < THREAD_COUNT; t++) {
+    inserted += workers[t].inserted;
+  }
+  if(inserted != ADD_COUNT || chashset_size(hs) != ADD_COUNT) {
+    return EXIT_FAILURE;
+  }
+  if(run_workers(hs, remove_worker, workers)) {
+    return EXIT_FAILURE;
+  }
+  if(chashset_size(hs) != ADD_COUNT / 2) {
+    return EXIT_FAILURE;
+  }
+  for(int v = 0; v < ADD_COUNT; v++) {
+    if(chashset_contains(hs, &v) != v % 2) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(run_workers(hs, churn_worker, workers) || chashset_size(hs) != ADD_COUNT / 2) {
+    return EXIT_FAILURE;
+  }
+  chashset_reclaim(hs);
+  if(chashset_clear(hs) || chashset_size(hs) != 0) {
+    return EXIT_FAILURE;
+  }
+  // Single threaded replace semantics.
+  int v = 7;
+  if(chashset_add(hs, &v) || chashset_add(hs, &v) || chashset_insert(hs, &v) != 0 || chashset_size(hs) != 1) {
+    return EXIT_FAILURE;
+  }
+  chashset_destroy(hs);
+  return EXIT_SUCCESS;
+}
+
+typedef struct {
+  CHashSet* chs;
+  HashSet* hs;
+  pthread_mutex_t* lock;
+  const int* keys;
+  int id;
+} BenchWorker;
+
+static void* bench_chashset_worker(void* arg) {
+  BenchWorker* w = arg;
+  for(size_t i = w->id; i < BENCH_COUNT; i += THREAD_COUNT) {
+    chashset_insert(w->chs, &w->keys[i]);
+    chashset_contains(w->chs, &w->keys[BENCH_COUNT - 1 - i]);
+  }
+  return NULL;
+}
+
+static void* bench_locked_worker(void* arg) {
+  BenchWorker* w = arg;
+  for(size_t i = w->id; i < BENCH_COUNT; i += THREAD_COUNT) {
+    pthread_mutex_lock(w->lock);
+    if(!hashset_contains(w->hs, &w->keys[i])) {
+      hashset_add(w->hs, &w->keys[i]);
+    }
+    pthread_mutex_unlock(w->lock);
+    pthread_mutex_lock(w->lock);
+    hashset_contains(w->hs, &w->keys[BENCH_COUNT - 1 - i]);
+    pthread_mutex_unlock(w->lock);
+  }
+  return NULL;
+}
+
+static int bench_run(const char* name, void* (*fn)(void*), BenchWorker* proto) {
+  pthread_t threads[THREAD_COUNT];
+  BenchWorker workers[THREAD_COUNT];
+  PerfClock pc;
+  clock_reset(&pc);
+  clock_start(&pc);
+  for(int t = 0; t < THREAD_COUNT; t++) {
+    workers[t] = *proto;
+    workers[t].id = t;
+    if(pthread_create(&threads[t], NULL, fn, &workers[t])) {
+      return EXIT_FAILURE;
+    }
+  }
+  for(int t = 0; t < THREAD_COUNT; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  clock_stop(&pc);
+  printf("%s: %6.4f\n", name, pc.delta);
+  return EXIT_SUCCESS;
+}
+
+static int bench() {
+  static int keys[BENCH_COUNT];
+  for(size_t i = 0; i < BENCH_COUNT; i++) {
+    keys[i] = rand();
+  }
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  BenchWorker proto = {NULL, NULL, &lock, keys, 0};
+  proto.chs = chashset_create(&IDT_INT_MIXED, 0, -1);
+  proto.hs = hashset_create(&IDT_INT_MIXED, 0, -1, -1, HASHSET_ENGINE_OPEN);
+  if(proto.chs == NULL || proto.hs == NULL) {
+    return EXIT_FAILURE;
+  }
+  printf("%d threads, insert + lookup:\n", THREAD_COUNT);
+  if(bench_run("chashset", bench_chashset_worker, &proto) || bench_run("hashset + mutex", bench_locked_worker, &proto)) {
+    return EXIT_FAILURE;
+  }
+  chashset_destroy(proto.chs);
+  hashset_destroy(proto.hs);
+  return EXIT_SUCCESS;
+}
+
+int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
+  srand(time(NULL));
+  if(argc > 1) {
+    return bench();
+  }
+  if(test(&IDT_INT) || test(&IDT_INT_MIXED)) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
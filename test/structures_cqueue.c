@@ -0,0 +1,295 @@
+#include "test_utils.h"
+
+#include <CQueue.h>
+#include <Clock.h>
+#include <Dequeue.h>
+#include <Macros.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PRODUCERS 3
+#define CONSUMERS 3
+#define PUSH_COUNT (KBYTES(64))
+#define BENCH_COUNT (MBYTES(4))
+
+/*
+ * Values carry the producer in the high bits and a counter in the low bits.
+ */
+#define make_value(producer, counter) (((uint64_t)(producer) << 32) | (counter))
+#define value_producer(v) ((size_t)((v) >> 32))
+#define value_counter(v) ((uint32_t)(v))
+
+static const IDataType IDT_U64 = {sizeof(uint64_t), 0, sizeof(uint64_t), NULL, NULL, NULL, NULL, NULL, KEY_KIND_UNSIGNED};
+
+typedef struct {
+  // Padding makes elements span more than one word.
+  uint64_t value;
+  uint64_t check;
+  uint8_t padding[7];
+} Wide;
+
+static const IDataType IDT_WIDE = {sizeof(Wide), 0, sizeof(uint64_t), NULL, NULL, NULL, NULL, NULL, KEY_KIND_UNSIGNED};
+
+static int test_single_thread() {
+  // Capacities which can not be rounded up, or allocated.
+  if(spsc_queue_create(&IDT_WIDE, SIZE_MAX) != NULL || mpmc_queue_create(&IDT_WIDE, SIZE_MAX / 2 + 2) != NULL ||
+     spsc_queue_create(&IDT_WIDE, SIZE_MAX / 4) != NULL || mpmc_queue_create(&IDT_WIDE, SIZE_MAX / 4) != NULL) {
+    return EXIT_FAILURE;
+  }
+  SPSCQueue* spsc = spsc_queue_create(&IDT_WIDE, 5);
+  MPMCQueue* mpmc = mpmc_queue_create(&IDT_WIDE, 5);
+  if(spsc == NULL || mpmc == NULL || spsc_queue_capacity(spsc) != 8 || mpmc_queue_capacity(mpmc) != 8) {
+    return EXIT_FAILURE;
+  }
+  Wide w;
+  if(!spsc_queue_pop(spsc, &w) || !mpmc_queue_pop(mpmc, &w)) {
+    return EXIT_FAILURE;
+  }
+  // Many laps around the ring, with a different fill level each time.
+  uint64_t pushed = 0;
+  uint64_t popped = 0;
+  for(size_t lap = 0; lap < 100; lap++) {
+    size_t fill = lap % 9;
+    for(size_t i = 0; i < fill; i++) {
+      Wide in = {pushed, ~pushed, {0}};
+      int full = i >= 8;
+      if(spsc_queue_push(spsc, &in) != full || mpmc_queue_push(mpmc, &in) != full) {
+        return EXIT_FAILURE;
+      }
+      pushed += !full;
+    }
+    if(spsc_queue_size(spsc) != pushed - popped || mpmc_queue_size(mpmc) != pushed - popped) {
+      return EXIT_FAILURE;
+    }
+    while(popped < pushed) {
+      Wide a;
+      Wide b;
+      if(spsc_queue_pop(spsc, &a) || mpmc_queue_pop(mpmc, &b)) {
+        return EXIT_FAILURE;
+      }
+      if(a.value != popped || a.check != ~popped || b.value != popped || b.check != ~popped) {
+        return EXIT_FAILURE;
+      }
+      popped++;
+    }
+  }
+  spsc_queue_destroy(spsc);
+  mpmc_queue_destroy(mpmc);
+  return EXIT_SUCCESS;
+}
+
+typedef struct {
+  SPSCQueue* spsc;
+  MPMCQueue* mpmc;
+  size_t id;
+  // Consumers count what they got from each producer.
+  size_t received[PRODUCERS];
+  // Total popped by all consumers.
+  size_t* popped;
+  int failed;
+} Worker;
+
+static void* spsc_producer(void* arg) {
+  Worker* w = arg;
+  for(uint32_t i = 0; i < PUSH_COUNT; i++) {
+    uint64_t v = make_value(0, i);
+    while(spsc_queue_push(w->spsc, &v)) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static int test_spsc() {
+  // Small capacity, so the queue is often full and empty.
+  Worker w = {spsc_queue_create(&IDT_U64, 64), NULL, 0, {0}, NULL, 0};
+  pthread_t producer;
+  if(w.spsc == NULL || pthread_create(&producer, NULL, spsc_producer, &w)) {
+    return EXIT_FAILURE;
+  }
+  int failed = 0;
+  for(uint32_t i = 0; i < PUSH_COUNT; i++) {
+    uint64_t v;
+    while(spsc_queue_pop(w.spsc, &v)) {
+      sched_yield();
+    }
+    failed |= value_counter(v) != i;
+  }
+  pthread_join(producer, NULL);
+  spsc_queue_destroy(w.spsc);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void* mpmc_producer(void* arg) {
+  Worker* w = arg;
+  for(uint32_t i = 0; i < PUSH_COUNT; i++) {
+    uint64_t v = make_value(w->id, i);
+    while(mpmc_queue_push(w->mpmc, &v)) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Each consumer must see the elements of every producer in the order they were pushed.
+ */
+static void* mpmc_consumer(void* arg) {
+  Worker* w = arg;
+  int64_t last[PRODUCERS];
+  for(size_t p = 0; p < PRODUCERS; p++) {
+    last[p] = -1;
+  }
+  while(__atomic_load_n(w->popped, __ATOMIC_RELAXED) < PRODUCERS * PUSH_COUNT) {
+    uint64_t v;
+    if(mpmc_queue_pop(w->mpmc, &v)) {
+      sched_yield();
+      continue;
+    }
+    __atomic_add_fetch(w->popped, 1, __ATOMIC_RELAXED);
+    size_t p = value_producer(v);
+    if(p >= PRODUCERS || (int64_t)value_counter(v) <= last[p]) {
+      w->failed = 1;
+      continue;
+    }
+    last[p] = value_counter(v);
+    w->received[p]++;
+  }
+  return NULL;
+}
+
+static int test_mpmc() {
+  MPMCQueue* q = mpmc_queue_create(&IDT_U64, 64);
+  if(q == NULL) {
+    return EXIT_FAILURE;
+  }
+  size_t popped = 0;
+  Worker producers[PRODUCERS];
+  Worker consumers[CONSUMERS];
+  pthread_t threads[PRODUCERS + CONSUMERS];
+  for(size_t t = 0; t < PRODUCERS + CONSUMERS; t++) {
+    Worker* w = t < PRODUCERS ? &producers[t] : &consumers[t - PRODUCERS];
+    *w = (Worker){NULL, q, t, {0}, &popped, 0};
+    if(pthread_create(&threads[t], NULL, t < PRODUCERS ? mpmc_producer : mpmc_consumer, w)) {
+      return EXIT_FAILURE;
+    }
+  }
+  for(size_t t = 0; t < PRODUCERS + CONSUMERS; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  // Nothing lost or duplicated.
+  for(size_t p = 0; p < PRODUCERS; p++) {
+    size_t received = 0;
+    for(size_t c = 0; c < CONSUMERS; c++) {
+      if(consumers[c].failed) {
+        return EXIT_FAILURE;
+      }
+      received += consumers[c].received[p];
+    }
+    if(received != PUSH_COUNT) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(mpmc_queue_size(q) != 0) {
+    return EXIT_FAILURE;
+  }
+  mpmc_queue_destroy(q);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Producer to consumer throughput, compared with a Dequeue behind a mutex.
+ */
+typedef struct {
+  SPSCQueue* spsc;
+  MPMCQueue* mpmc;
+  Dequeue* dq;
+  pthread_mutex_t* lock;
+} Bench;
+
+static void* bench_producer(void* arg) {
+  Bench* b = arg;
+  for(uint64_t i = 0; i < BENCH_COUNT; i++) {
+    if(b->spsc != NULL) {
+      while(spsc_queue_push(b->spsc, &i)) {
+        sched_yield();
+      }
+    }
+    else if(b->mpmc != NULL) {
+      while(mpmc_queue_push(b->mpmc, &i)) {
+        sched_yield();
+      }
+    }
+    else {
+      pthread_mutex_lock(b->lock);
+      dequeue_push_back(b->dq, &i);
+      pthread_mutex_unlock(b->lock);
+    }
+  }
+  return NULL;
+}
+
+static int bench_run(const char* name, Bench* b) {
+  PerfClock pc;
+  clock_reset(&pc);
+  clock_start(&pc);
+  pthread_t producer;
+  if(pthread_create(&producer, NULL, bench_producer, b)) {
+    return EXIT_FAILURE;
+  }
+  for(uint64_t i = 0; i < BENCH_COUNT; i++) {
+    uint64_t v;
+    int empty;
+    do {
+      if(b->spsc != NULL) {
+        empty = spsc_queue_pop(b->spsc, &v);
+      }
+      else if(b->mpmc != NULL) {
+        empty = mpmc_queue_pop(b->mpmc, &v);
+      }
+      else {
+        pthread_mutex_lock(b->lock);
+        empty = dequeue_pop_front(b->dq, &v);
+        pthread_mutex_unlock(b->lock);
+      }
+      if(empty) {
+        sched_yield();
+      }
+    } while(empty);
+  }
+  pthread_join(producer, NULL);
+  clock_stop(&pc);
+  printf("%s: %6.4f\n", name, pc.delta);
+  return EXIT_SUCCESS;
+}
+
+static int bench() {
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  Bench spsc = {spsc_queue_create(&IDT_U64, 4096), NULL, NULL, NULL};
+  Bench mpmc = {NULL, mpmc_queue_create(&IDT_U64, 4096), NULL, NULL};
+  Bench locked = {NULL, NULL, dequeue_create(&IDT_U64), &lock};
+  if(spsc.spsc == NULL || mpmc.mpmc == NULL || locked.dq == NULL) {
+    return EXIT_FAILURE;
+  }
+  if(bench_run("spsc", &spsc) || bench_run("mpmc", &mpmc) || bench_run("dequeue+mutex", &locked)) {
+    return EXIT_FAILURE;
+  }
+  spsc_queue_destroy(spsc.spsc);
+  mpmc_queue_destroy(mpmc.mpmc);
+  dequeue_destroy(locked.dq);
+  return EXIT_SUCCESS;
+}
+
+int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
+  if(argc > 1) {
+    return bench();
+  }
+  if(test_single_thread() || test_spsc() || test_mpmc()) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -5,10 +5,101 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MODEL_SIZE 4096
+
+/*
+ * Random pushes and pops on both ends, checked against a plain array,
+ * so that the buffer wraps around and grows at every position.
+ */
+static int test_random() {
+  static int model[MODEL_SIZE * 2];
+  size_t first = MODEL_SIZE;
+  size_t end = MODEL_SIZE;
+  Dequeue* dq = dequeue_create(&IDT_INT);
+  if(dq == NULL) {
+    return EXIT_FAILURE;
+  }
+  for(int i = 0; i < 200000; i++) {
+    int op = rand() % 10;
+    int result = -1;
+    // Batches of up to 40 elements.
+    int batch[40];
+    size_t count = rand() % 41;
+    if(op == 7 && count <= first) {
+      for(size_t j = 0; j < count; j++) {
+        batch[j] = i * 64 + j;
+      }
+      first -= count;
+      memcpy(&model[first], batch, count * sizeof(int));
+      if(dequeue_push_front_many(dq, batch, count)) {
+        return EXIT_FAILURE;
+      }
+    }
+    else if(op == 8 && count <= MODEL_SIZE * 2 - end) {
+      for(size_t j = 0; j < count; j++) {
+        batch[j] = i * 64 + j;
+      }
+      memcpy(&model[end], batch, count * sizeof(int));
+      end += count;
+      if(dequeue_push_back_many(dq, batch, count)) {
+        return EXIT_FAILURE;
+      }
+    }
+    else if(op == 9) {
+      size_t expected = count < end - first ? count : end - first;
+      if(dequeue_pop_front_many(dq, batch, count) != expected || memcmp(batch, &model[first], expected * sizeof(int))) {
+        return EXIT_FAILURE;
+      }
+      first += expected;
+    }
+    // Grow more often than shrink, until the model is close to full.
+    else if(first > 0 && end < MODEL_SIZE * 2 && op < 2) {
+      model[--first] = i;
+      dequeue_push_front(dq, &i);
+    }
+    else if(first > 0 && end < MODEL_SIZE * 2 && op < 4) {
+      model[end++] = i;
+      dequeue_push_back(dq, &i);
+    }
+    else if(op < 5 || op == 6) {
+      int failed = dequeue_pop_front(dq, &result);
+      if(failed != (first == end) || (!failed && result != model[first++])) {
+        return EXIT_FAILURE;
+      }
+    }
+    else {
+      int failed = dequeue_pop_back(dq, &result);
+      if(failed != (first == end) || (!failed && result != model[--end])) {
+        return EXIT_FAILURE;
+      }
+    }
+    if(first == end) {
+      // Recenter the model.
+      first = MODEL_SIZE;
+      end = MODEL_SIZE;
+    }
+    if(dequeue_size(dq) != end - first) {
+      return EXIT_FAILURE;
+    }
+    if(first != end && (dequeue_peek_front(dq, &result) || result != model[first] || dequeue_peek_back(dq, &result) || result != model[end - 1])) {
+      return EXIT_FAILURE;
+    }
+  }
+  dequeue_destroy(dq);
+  return EXIT_SUCCESS;
+}
 
 int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
   const int TEST_NUMS[] = {1, 2, 3, 4};
   Dequeue* dq = dequeue_create(&IDT_INT);
+  // Empty batches before anything is allocated.
+  if(dq == NULL || dequeue_push_back_many(dq, TEST_NUMS, 0) || dequeue_push_front_many(dq, TEST_NUMS, 0) || dequeue_size(dq) != 0) {
+    return EXIT_FAILURE;
+  }
   for(size_t l = 1; l <= (sizeof(TEST_NUMS) / sizeof(int)); l++) {
     printf("Performing %zu length test...\n", l);
     // Test push front, pop front.
@@ -77,5 +168,6 @@ int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
     dequeue_reset(dq);
   }
   dequeue_destroy(dq);
-  return EXIT_SUCCESS;
+  srand(time(NULL));
+  return test_random();
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "test_utils.h"
 
+#include <Bitfield.h>
+#include <Clock.h>
 #include <FAlloc.h>
 #include <HashSet.h>
 #include <Macros.h>
@@ -10,11 +12,209 @@
 #include <string.h>
 #include <time.h>
 
-#define ADD_COUNT KBYTES(1)
+#define ADD_COUNT (KBYTES(1))
+#define BENCH_COUNT (MBYTES(1))
 
-int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
-  srand(time(NULL));
-  HashSet* hs = hashset_create(&IDT_INT, 0, -1, -1);
+static const unsigned int ENGINES[] = {
+  HASHSET_ENGINE_BUCKETS,
+  HASHSET_ENGINE_BUCKETS | HASHSET_INCREMENTAL,
+  HASHSET_ENGINE_BUCKETS | HASHSET_INCREMENTAL | HASHSET_CACHE_HASH,
+  HASHSET_ENGINE_BUCKETS | HASHSET_CACHE_HASH,
+  HASHSET_ENGINE_BUCKETS | HASHSET_POW2,
+  HASHSET_ENGINE_BUCKETS | HASHSET_MIX_HASH,
+  HASHSET_ENGINE_BUCKETS | HASHSET_POW2 | HASHSET_MIX_HASH,
+  HASHSET_ENGINE_OPEN,
+  HASHSET_ENGINE_OPEN | HASHSET_CACHE_HASH,
+  HASHSET_ENGINE_OPEN | HASHSET_MIX_HASH,
+  HASHSET_ENGINE_BUCKETS | HASHSET_DENSE_KEYS,
+  HASHSET_ENGINE_OPEN | HASHSET_DENSE_KEYS};
+static const char* ENGINE_NAMES[] = {"buckets", "incremental", "incremental cached", "buckets cached", "buckets pow2", "buckets mixed", "buckets pow2 mixed", "open", "open cached", "open mixed", "buckets dense", "open dense"};
+
+static size_t cmp_eq_calls = 0;
+static size_t hash_calls = 0;
+
+static int counting_cmp_e(const IDataType* dti, const int* a, const int* b) {
+  cmp_eq_calls++;
+  return cst_cmp_e(dti, a, b);
+}
+
+static size_t mixed_hash(MARK_UNUSED const IDataType* ignored, const int* k) {
+  hash_calls++;
+  uint64_t h = (uint32_t)*k;
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return (size_t)h;
+}
+
+static const IDataType IDT_INT_MIXED = {4, 0, 4, (Compare)counting_cmp_e, (Compare)cst_cmp_l, (Compare)cst_cmp_le, (Operate)cst_swap, (Calculate)mixed_hash, KEY_KIND_SIGNED};
+static const IDataType IDT_INT_IDENTITY = {4, 0, 4, (Compare)counting_cmp_e, (Compare)cst_cmp_l, (Compare)cst_cmp_le, (Operate)cst_swap, (Calculate)cst_hash, KEY_KIND_SIGNED};
+
+static int bench_engine(const IDataType* dti, unsigned int flags, const char* name, const int* keys) {
+  PerfClock pc_add;
+  PerfClock pc_hit;
+  PerfClock pc_hit_batch;
+  PerfClock pc_miss;
+  PerfClock pc_remove;
+  clock_reset(&pc_add);
+  clock_reset(&pc_hit);
+  clock_reset(&pc_miss);
+  clock_reset(&pc_remove);
+  HashSet* hs = hashset_create(dti, 0, -1, -1, flags);
+  if(hs == NULL) {
+    return EXIT_FAILURE;
+  }
+  hash_calls = 0;
+  for(size_t i = 0; i < BENCH_COUNT; i++) {
+    // Each add is timed separately, to capture the worst case latency.
+    clock_start(&pc_add);
+    hashset_add(hs, &keys[i]);
+    clock_stop(&pc_add);
+  }
+  size_t add_hash_calls = hash_calls;
+  HashSetStats stats;
+  hashset_stats(hs, &stats);
+  size_t found = 0;
+  clock_start(&pc_hit);
+  for(size_t i = 0; i < BENCH_COUNT; i++) {
+    found += hashset_contains(hs, &keys[i]);
+  }
+  clock_stop(&pc_hit);
+  static size_t mask_data[BENCH_COUNT / SIZE_T_BITS];
+  Bitfield mask;
+  bitfield_init(&mask, mask_data, sizeof(mask_data));
+  clock_reset(&pc_hit_batch);
+  clock_start(&pc_hit_batch);
+  hashset_contains_many(hs, keys, BENCH_COUNT, &mask);
+  clock_stop(&pc_hit_batch);
+  cmp_eq_calls = 0;
+  clock_start(&pc_miss);
+  for(size_t i = 0; i < BENCH_COUNT; i++) {
+    int k = -keys[i] - 1;
+    found += hashset_contains(hs, &k);
+  }
+  clock_stop(&pc_miss);
+  size_t miss_cmp_eq_calls = cmp_eq_calls;
+  clock_start(&pc_remove);
+  for(size_t i = 0; i < BENCH_COUNT; i++) {
+    hashset_remove(hs, &keys[i]);
+  }
+  clock_stop(&pc_remove);
+  hashset_destroy(hs);
+  printf("%s: %6.4f | %6.4f | %6.4f | %6.4f | %6.4f | %6.4f | %zu | %zu (%zu)\n", name, pc_add.delta_sum, pc_add.max, pc_hit.delta, pc_hit_batch.delta, pc_miss.delta, pc_remove.delta, add_hash_calls, miss_cmp_eq_calls, found);
+  printf("\t%zu KiB | %.3f | %zu | %.3f | %zu | %6.4f\n", stats.bytes / 1024, stats.load_factor, stats.max_probe, stats.avg_probe, stats.resize_count, stats.rehash_time);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Memory and lookup time for dense keys.
+ */
+static int bench_dense() {
+  const unsigned int flags[] = {HASHSET_ENGINE_BUCKETS, HASHSET_ENGINE_OPEN, HASHSET_ENGINE_BUCKETS | HASHSET_DENSE_KEYS};
+  const char* names[] = {"buckets", "open", "dense"};
+  printf("dense keys:\n");
+  printf("engine:\t MEMORY | HIT\n");
+  for(size_t e = 0; e < sizeof(flags) / sizeof(unsigned int); e++) {
+    HashSet* hs = hashset_create(&IDT_INT, 0, -1, -1, flags[e]);
+    if(hs == NULL) {
+      return EXIT_FAILURE;
+    }
+    for(int v = 0; v < BENCH_COUNT; v++) {
+      hashset_add(hs, &v);
+    }
+    HashSetStats stats;
+    hashset_stats(hs, &stats);
+    PerfClock pc;
+    clock_reset(&pc);
+    size_t found = 0;
+    clock_start(&pc);
+    for(int v = 0; v < BENCH_COUNT; v++) {
+      found += hashset_contains(hs, &v);
+    }
+    clock_stop(&pc);
+    printf("%s: %zu KiB | %6.4f (%zu)\n", names[e], stats.bytes / 1024, pc.delta, found);
+    hashset_destroy(hs);
+  }
+  return EXIT_SUCCESS;
+}
+
+static int bench() {
+  static int keys[BENCH_COUNT];
+  for(size_t i = 0; i < BENCH_COUNT; i++) {
+    // Only positive keys, so that negative lookups never hit.
+    keys[i] = rand() & INT32_MAX;
+  }
+  const IDataType* dtis[] = {&IDT_INT_MIXED, &IDT_INT_IDENTITY};
+  const char* dti_names[] = {"mixed", "identity"};
+  for(size_t d = 0; d < sizeof(dtis) / sizeof(IDataType*); d++) {
+    printf("%s hash:\n", dti_names[d]);
+    printf("engine:\t ADD | ADD MAX | HIT | HIT BATCH | MISS | REMOVE | ADD HASH CALLS | MISS CMP_EQ CALLS\n");
+    printf("\t MEMORY | LOAD | MAX PROBE | AVG PROBE | RESIZES | REHASH\n");
+    for(size_t e = 0; e < sizeof(ENGINES) / sizeof(unsigned int); e++) {
+      if(bench_engine(dtis[d], ENGINES[e], ENGINE_NAMES[e], keys)) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  return bench_dense();
+}
+
+/*
+ * Checks that every stored element is visited exactly once.
+ * Returns how many were visited, or SIZE_MAX on error.
+ */
+static size_t count_iterated(HashSet* hs, const char* present) {
+  static char visited[ADD_COUNT];
+  memset(visited, 0, sizeof(visited));
+  size_t visited_count = 0;
+  HashSetIterator it;
+  hashset_iterator_init(hs, &it);
+  for(int* p = hashset_iterator_next(hs, &it); p != NULL; p = hashset_iterator_next(hs, &it)) {
+    if(*p < 0 || *p >= ADD_COUNT || (present != NULL && !present[*p]) || visited[*p]) {
+      return SIZE_MAX;
+    }
+    visited[*p] = 1;
+    visited_count++;
+    if(hashset_find_ptr(hs, p) != p) {
+      return SIZE_MAX;
+    }
+  }
+  return visited_count;
+}
+
+/*
+ * Negative lookups of identity hashed keys should rarely reach the comparator,
+ * even without mixing the hash.
+ */
+static int test_open_misses(unsigned int flags) {
+  HashSet* hs = hashset_create(&IDT_INT_IDENTITY, 0, -1, -1, flags);
+  if(hs == NULL) {
+    return EXIT_FAILURE;
+  }
+  // Odd keys are stored and even keys are looked up.
+  for(int v = 0; v < ADD_COUNT; v++) {
+    int k = (rand() & INT32_MAX) | 1;
+    if(hashset_add(hs, &k)) {
+      return EXIT_FAILURE;
+    }
+  }
+  cmp_eq_calls = 0;
+  for(int v = 0; v < ADD_COUNT; v++) {
+    int k = rand() & (INT32_MAX - 1);
+    if(hashset_contains(hs, &k)) {
+      return EXIT_FAILURE;
+    }
+  }
+  printf("Open misses compared %zu times\n", cmp_eq_calls);
+  hashset_destroy(hs);
+  // A matching fragment is 1 in 128 per full slot, so well below one compare per lookup.
+  return cmp_eq_calls < ADD_COUNT / 4 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int test_engine(const IDataType* dti, unsigned int flags) {
+  HashSet* hs = hashset_create(dti, 0, -1, -1, flags);
   if(hs == NULL) {
     return EXIT_FAILURE;
   }
@@ -25,10 +225,35 @@ int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
     if(!hashset_contains(hs, &v)) {
       return EXIT_FAILURE;
     }
+    // Also covers iterating in the middle of an incremental resize.
+    if(count_iterated(hs, NULL) != (size_t)v + 1) {
+      return EXIT_FAILURE;
+    }
   }
   if(hash_size(hs) != ADD_COUNT) {
     return EXIT_FAILURE;
   }
+  HashSetStats stats;
+  hashset_stats(hs, &stats);
+  if(stats.elements != ADD_COUNT) {
+    return EXIT_FAILURE;
+  }
+  if(flags & HASHSET_DENSE_KEYS) {
+    // Keys are dense, so they should still be stored as bits.
+    if(stats.bytes >= ADD_COUNT * dti->size || stats.max_probe != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+  else if(stats.bytes < ADD_COUNT * dti->size || stats.resize_count == 0) {
+    return EXIT_FAILURE;
+  }
+  if(stats.avg_probe > stats.max_probe || stats.load_factor <= 0.0f) {
+    return EXIT_FAILURE;
+  }
+  if(!(flags & (HASHSET_ENGINE_OPEN | HASHSET_DENSE_KEYS)) && stats.avg_probe < 1.0f) {
+    // Average of non empty buckets.
+    return EXIT_FAILURE;
+  }
   for(int v = 0; v < ADD_COUNT; v++) {
     if(hashset_remove(hs, &v)) {
       return EXIT_FAILURE;
@@ -40,6 +265,152 @@ int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
   if(hash_size(hs) != 0) {
     return EXIT_FAILURE;
   }
+  // Random operations, checked against a reference.
+  static char present[ADD_COUNT];
+  size_t present_count = 0;
+  memset(present, 0, sizeof(present));
+  for(size_t i = 0; i < 64 * ADD_COUNT; i++) {
+    int v = rand() % ADD_COUNT;
+    if(rand() % 2) {
+      if(hashset_add(hs, &v)) {
+        return EXIT_FAILURE;
+      }
+      present_count += !present[v];
+      present[v] = 1;
+    }
+    else {
+      if(hashset_remove(hs, &v) != !present[v]) {
+        return EXIT_FAILURE;
+      }
+      present_count -= present[v];
+      present[v] = 0;
+    }
+    if(hashset_contains(hs, &v) != present[v] || hash_size(hs) != present_count) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(count_iterated(hs, present) != present_count) {
+    return EXIT_FAILURE;
+  }
+  int missing = -1;
+  if(hashset_find_ptr(hs, &missing) != NULL) {
+    return EXIT_FAILURE;
+  }
+  // Batch operations over every key.
+  static int all[ADD_COUNT];
+  static size_t mask_data[ADD_COUNT / SIZE_T_BITS];
+  Bitfield mask;
+  bitfield_init(&mask, mask_data, sizeof(mask_data));
+  for(int v = 0; v < ADD_COUNT; v++) {
+    all[v] = v;
+  }
+  if(hashset_contains_many(hs, all, ADD_COUNT, &mask)) {
+    return EXIT_FAILURE;
+  }
+  for(int v = 0; v < ADD_COUNT; v++) {
+    if(bitfield_get(&mask, v) != present[v]) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(hashset_add_many(hs, all, ADD_COUNT, &mask) || hash_size(hs) != ADD_COUNT) {
+    return EXIT_FAILURE;
+  }
+  for(int v = 0; v < ADD_COUNT; v++) {
+    if(bitfield_get(&mask, v) == present[v]) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(hashset_remove_many(hs, all, ADD_COUNT / 2, &mask) || hash_size(hs) != ADD_COUNT / 2) {
+    return EXIT_FAILURE;
+  }
+  if(hashset_remove_many(hs, all, ADD_COUNT, NULL) || hash_size(hs) != 0) {
+    return EXIT_FAILURE;
+  }
+  hashset_destroy(hs);
+  // Clear and destroy at every point of the first few resizes, some of them while migrating.
+  for(int n = 1; n <= 64; n++) {
+    // Tiny initial size, so the table resizes early.
+    hs = hashset_create(dti, 2, -1, -1, flags);
+    if(hs == NULL) {
+      return EXIT_FAILURE;
+    }
+    for(int v = 0; v < n; v++) {
+      if(hashset_add(hs, &v)) {
+        return EXIT_FAILURE;
+      }
+    }
+    if(n % 2 && (hashset_clear(hs) || hash_size(hs) != 0)) {
+      return EXIT_FAILURE;
+    }
+    hashset_destroy(hs);
+  }
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Dense keys which become sparse must switch to hashing without losing any element.
+ */
+static int test_dense_switch(unsigned int flags) {
+  HashSet* hs = hashset_create(&IDT_INT, 0, -1, -1, flags | HASHSET_DENSE_KEYS);
+  if(hs == NULL) {
+    return EXIT_FAILURE;
+  }
+  for(int v = 0; v < ADD_COUNT; v += 2) {
+    if(hashset_add(hs, &v)) {
+      return EXIT_FAILURE;
+    }
+  }
+  HashSetStats dense_stats;
+  hashset_stats(hs, &dense_stats);
+  // Negative keys are huge when treated as unsigned.
+  int sparse[] = {INT32_MAX, -1};
+  for(size_t i = 0; i < sizeof(sparse) / sizeof(int); i++) {
+    if(hashset_add(hs, &sparse[i]) || !hashset_contains(hs, &sparse[i])) {
+      return EXIT_FAILURE;
+    }
+  }
+  HashSetStats stats;
+  hashset_stats(hs, &stats);
+  if(stats.elements != ADD_COUNT / 2 + 2 || stats.resize_count != dense_stats.resize_count + 1) {
+    return EXIT_FAILURE;
+  }
+  for(int v = 0; v < ADD_COUNT; v++) {
+    if(hashset_contains(hs, &v) != !(v % 2)) {
+      return EXIT_FAILURE;
+    }
+  }
+  // Back to dense mode.
+  if(hashset_clear(hs)) {
+    return EXIT_FAILURE;
+  }
+  int v = 1;
+  if(hashset_add(hs, &v) || !hashset_contains(hs, &v) || hashset_contains(hs, &sparse[0]) || count_iterated(hs, NULL) != 1) {
+    return EXIT_FAILURE;
+  }
+  hashset_stats(hs, &stats);
+  if(stats.capacity != dense_stats.capacity) {
+    return EXIT_FAILURE;
+  }
   hashset_destroy(hs);
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
+  srand(time(NULL));
+  if(argc > 1) {
+    return bench();
+  }
+  for(size_t e = 0; e < sizeof(ENGINES) / sizeof(unsigned int); e++) {
+    printf("Testing %s engine...\n", ENGINE_NAMES[e]);
+    if(test_engine(&IDT_INT, ENGINES[e]) || test_engine(&IDT_INT_MIXED, ENGINES[e])) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(test_open_misses(HASHSET_ENGINE_OPEN) || test_open_misses(HASHSET_ENGINE_OPEN | HASHSET_MIX_HASH)) {
+    return EXIT_FAILURE;
+  }
+  if(test_dense_switch(HASHSET_ENGINE_BUCKETS) || test_dense_switch(HASHSET_ENGINE_OPEN)) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
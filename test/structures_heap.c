@@ -15,5 +15,19 @@ int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
   if(memcmp(a, h, n)) {
     return EXIT_FAILURE;
   }
+  // d-ary heaps.
+  for(size_t arity = 2; arity <= 8; arity++) {
+    static int d[1000];
+    fill_garbage(d, sizeof(d));
+    heap_create_d(d, 1000, arity, &IDT_INT);
+    for(size_t i = 1; i < 1000; i++) {
+      if(d[(i - 1) / arity] < d[i]) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  if(heap_arity(&IDT_INT) < 2) {
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "test_utils.h"
+
+#include <Clock.h>
+#include <Macros.h>
+#include <PriorityQueue.h>
+#include <SortedArray.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_COUNT (KBYTES(16))
+#define BENCH_ROUNDS (KBYTES(32))
+#define BENCH_CHILDREN 4
+
+/*
+ * Odd sized elements with a payload around the key.
+ */
+typedef struct {
+  char tag;
+  int key;
+  char check;
+} MARK_PACKED Record;
+
+static int record_cmp_l(MARK_UNUSED const IDataType* ignored, const int* a, const int* b) {
+  int x, y;
+  memcpy(&x, a, sizeof(int));
+  memcpy(&y, b, sizeof(int));
+  return x < y;
+}
+
+static void record_swap(MARK_UNUSED const IDataType* ignored, Record* a, Record* b) {
+  Record tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+static const IDataType IDT_RECORD = {sizeof(Record), offsetof(Record, key), sizeof(int), NULL, (Compare)record_cmp_l, NULL, (Operate)record_swap, NULL, KEY_KIND_OPAQUE};
+
+/*
+ * Pops everything and checks that elements come out greatest first.
+ */
+static int drain(PriorityQueue* pq, size_t expected) {
+  int previous = INT32_MAX;
+  size_t count = 0;
+  int v;
+  while(priority_queue_pop(pq, &v) == 0) {
+    if(v > previous) {
+      return EXIT_FAILURE;
+    }
+    previous = v;
+    count++;
+  }
+  return count == expected && priority_queue_size(pq) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int test_push_pop(size_t arity) {
+  PriorityQueue* pq = priority_queue_create(&IDT_INT, 0, arity);
+  if(pq == NULL) {
+    return EXIT_FAILURE;
+  }
+  int v;
+  if(priority_queue_pop(pq, &v) == 0 || priority_queue_peek(pq, &v) == 0) {
+    return EXIT_FAILURE;
+  }
+  int max = INT32_MIN;
+  for(size_t i = 0; i < TEST_COUNT; i++) {
+    int r = rand() % 1000;
+    max = r > max ? r : max;
+    if(priority_queue_push(pq, &r) == INVALID_SIZE_T || priority_queue_peek(pq, &v) || v != max) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(drain(pq, TEST_COUNT)) {
+    return EXIT_FAILURE;
+  }
+  // Both paths of push_many.
+  static int array[TEST_COUNT];
+  fill_garbage(array, sizeof(array));
+  if(priority_queue_push_many(pq, array, TEST_COUNT, NULL) || priority_queue_push_many(pq, array, 10, NULL)) {
+    return EXIT_FAILURE;
+  }
+  if(drain(pq, TEST_COUNT + 10)) {
+    return EXIT_FAILURE;
+  }
+  priority_queue_destroy(pq);
+  return EXIT_SUCCESS;
+}
+
+static int test_handles(size_t arity) {
+  static int values[TEST_COUNT];
+  static size_t handles[TEST_COUNT];
+  PriorityQueue* pq = priority_queue_create(&IDT_INT, 1, arity);
+  if(pq == NULL) {
+    return EXIT_FAILURE;
+  }
+  for(size_t i = 0; i < TEST_COUNT; i++) {
+    values[i] = rand() % 1000;
+  }
+  if(priority_queue_push_many(pq, values, TEST_COUNT, handles)) {
+    return EXIT_FAILURE;
+  }
+  // Raise and lower priorities.
+  for(size_t i = 0; i < TEST_COUNT; i++) {
+    values[i] += rand() % 2000 - 1000;
+    if(priority_queue_update(pq, handles[i], &values[i])) {
+      return EXIT_FAILURE;
+    }
+  }
+  for(size_t i = 0; i < TEST_COUNT; i++) {
+    int v;
+    if(priority_queue_get(pq, handles[i], &v) || v != values[i]) {
+      return EXIT_FAILURE;
+    }
+  }
+  // The greatest gets popped, and its handle becomes invalid.
+  int top;
+  size_t top_handle = INVALID_SIZE_T;
+  if(priority_queue_peek(pq, &top)) {
+    return EXIT_FAILURE;
+  }
+  for(size_t i = 0; i < TEST_COUNT; i++) {
+    if(values[i] == top) {
+      top_handle = handles[i];
+    }
+  }
+  int v = 0;
+  if(priority_queue_pop(pq, NULL)) {
+    return EXIT_FAILURE;
+  }
+  size_t duplicates = 0;
+  for(size_t i = 0; i < TEST_COUNT; i++) {
+    duplicates += values[i] == top;
+  }
+  if(duplicates == 1 && (priority_queue_get(pq, top_handle, &v) == 0 || priority_queue_update(pq, top_handle, &v) == 0)) {
+    return EXIT_FAILURE;
+  }
+  // Freed handles get reused.
+  if(priority_queue_push(pq, &v) >= TEST_COUNT || priority_queue_get(pq, INVALID_SIZE_T, &v) == 0) {
+    return EXIT_FAILURE;
+  }
+  if(drain(pq, TEST_COUNT)) {
+    return EXIT_FAILURE;
+  }
+  priority_queue_clear(pq);
+  if(priority_queue_size(pq) != 0 || priority_queue_get(pq, handles[0], &v) == 0) {
+    return EXIT_FAILURE;
+  }
+  priority_queue_destroy(pq);
+  return EXIT_SUCCESS;
+}
+
+static int test_records(size_t arity) {
+  PriorityQueue* pq = priority_queue_create(&IDT_RECORD, 0, arity);
+  if(pq == NULL) {
+    return EXIT_FAILURE;
+  }
+  size_t handles[100];
+  for(int i = 0; i < 100; i++) {
+    Record r = {(char)i, i, (char)~i};
+    handles[i] = priority_queue_push(pq, &r);
+  }
+  // Make the smallest the greatest.
+  Record r = {0, 1000, ~0};
+  if(priority_queue_update(pq, handles[0], &r)) {
+    return EXIT_FAILURE;
+  }
+  int expected = 1000;
+  while(priority_queue_pop(pq, &r) == 0) {
+    if(r.key != expected || r.check != (char)~r.tag || (r.key != 1000 && r.tag != (char)r.key)) {
+      return EXIT_FAILURE;
+    }
+    expected = expected == 1000 ? 99 : expected - 1;
+  }
+  if(expected != 0) {
+    return EXIT_FAILURE;
+  }
+  priority_queue_destroy(pq);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Frontier like workload: pop one, push a few.
+ */
+static double bench_queue(size_t arity) {
+  int children[BENCH_CHILDREN];
+  PerfClock pc;
+  clock_reset(&pc);
+  PriorityQueue* pq = priority_queue_create(&IDT_INT, 0, arity);
+  if(pq == NULL) {
+    abort();
+  }
+  int v = 0;
+  srand(1);
+  priority_queue_push(pq, &v);
+  clock_start(&pc);
+  for(size_t i = 0; i < BENCH_ROUNDS; i++) {
+    priority_queue_pop(pq, &v);
+    for(size_t c = 0; c < BENCH_CHILDREN; c++) {
+      children[c] = rand();
+    }
+    priority_queue_push_many(pq, children, BENCH_CHILDREN, NULL);
+  }
+  // Then pop everything.
+  while(priority_queue_pop(pq, NULL) == 0) {
+  }
+  clock_stop(&pc);
+  priority_queue_destroy(pq);
+  return pc.delta;
+}
+
+static int bench() {
+  int children[BENCH_CHILDREN];
+  PerfClock pc;
+  clock_reset(&pc);
+  const size_t arities[] = {2, 4, 8, 0};
+  for(size_t i = 0; i < sizeof(arities) / sizeof(size_t); i++) {
+    printf("priority_queue(arity %zu): %6.4f\n", arities[i], bench_queue(arities[i]));
+  }
+  SortedArray* sa = sorted_array_create(&IDT_INT);
+  if(sa == NULL) {
+    return EXIT_FAILURE;
+  }
+  int v = 0;
+  srand(1);
+  sorted_array_insert(sa, &v);
+  clock_start(&pc);
+  for(size_t i = 0; i < BENCH_ROUNDS; i++) {
+    sorted_array_pop(sa, &v);
+    for(size_t c = 0; c < BENCH_CHILDREN; c++) {
+      children[c] = rand();
+    }
+    sorted_array_merge(sa, children, BENCH_CHILDREN);
+  }
+  while(sorted_array_pop(sa, &v) == 0) {
+  }
+  clock_stop(&pc);
+  printf("sorted_array: %6.4f\n", pc.delta);
+  sorted_array_destroy(sa);
+  return EXIT_SUCCESS;
+}
+
+int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
+  srand(time(NULL));
+  if(argc > 1) {
+    return bench();
+  }
+  // Automatic, binary, odd and wide heaps.
+  const size_t arities[] = {0, 2, 3, 4, 8};
+  for(size_t i = 0; i < sizeof(arities) / sizeof(size_t); i++) {
+    if(test_push_pop(arities[i]) || test_handles(arities[i]) || test_records(arities[i])) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,309 @@
+#include "test_utils.h"
+
+#include <Clock.h>
+#include <Interface.h>
+#include <Macros.h>
+#include <Sort.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_COUNT (KBYTES(64))
+#define BENCH_COUNT (MBYTES(1))
+
+typedef void (*SortFunction)(void*, size_t, const IDataType*);
+
+typedef enum { PATTERN_RANDOM, PATTERN_SORTED, PATTERN_REVERSED, PATTERN_EQUAL, PATTERN_FEW_UNIQUE, PATTERN_ORGAN_PIPE, PATTERN_SORTED_TAIL, PATTERN_COUNT } Pattern;
+static const char* PATTERN_NAMES[] = {"random", "sorted", "reversed", "equal", "few unique", "organ pipe", "sorted + random tail"};
+
+static void fill_pattern(int* a, size_t n, Pattern p) {
+  for(size_t i = 0; i < n; i++) {
+    switch(p) {
+      case PATTERN_RANDOM:
+        a[i] = rand();
+        break;
+      case PATTERN_SORTED:
+        a[i] = i;
+        break;
+      case PATTERN_REVERSED:
+        a[i] = n - i;
+        break;
+      case PATTERN_EQUAL:
+        a[i] = 7;
+        break;
+      case PATTERN_FEW_UNIQUE:
+        a[i] = rand() % 4;
+        break;
+      case PATTERN_ORGAN_PIPE:
+        a[i] = i < n / 2 ? i : n - i;
+        break;
+      default:
+        a[i] = i < n - n / 16 ? (int)i : rand();
+        break;
+    }
+  }
+}
+
+static int int_compare(const void* a, const void* b) {
+  int x = *(const int*)a;
+  int y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Elements with a payload around the key.
+ */
+typedef struct {
+  int payload;
+  int key;
+  int check;
+} Record;
+
+static void record_swap(MARK_UNUSED const IDataType* ignored, Record* a, Record* b) {
+  Record tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+/*
+ * Adapts sort_tim to the same signature as the other sorts.
+ */
+static void sort_tim_checked(void* array, size_t size, const IDataType* interface) {
+  if(sort_tim(array, size, interface)) {
+    printf("sort_tim failed to allocate memory!\n");
+    abort();
+  }
+}
+
+static void sort_radix_checked(void* array, size_t size, const IDataType* interface) {
+  if(sort_radix(array, size, interface)) {
+    printf("sort_radix failed to allocate memory!\n");
+    abort();
+  }
+}
+
+/*
+ * Odd thread counts leave a run without a pair during merging.
+ */
+#define DEFINE_PARALLEL_SORT(threads)                                                         \
+  static void sort_parallel_##threads(void* array, size_t size, const IDataType* interface) { \
+    if(sort_parallel(array, size, interface, threads)) {                                      \
+      printf("sort_parallel failed to allocate memory!\n");                                   \
+      abort();                                                                                \
+    }                                                                                         \
+  }
+
+DEFINE_PARALLEL_SORT(0)
+DEFINE_PARALLEL_SORT(2)
+DEFINE_PARALLEL_SORT(3)
+DEFINE_PARALLEL_SORT(7)
+
+/*
+ * Interfaces for every key kind.
+ */
+#define DEFINE_SCALAR_TYPE(name, T, kind)                                                 \
+  static int name##_cmp_l(MARK_UNUSED const IDataType* ignored, const T* a, const T* b) { \
+    return *a < *b;                                                                       \
+  }                                                                                       \
+  static void name##_swap(MARK_UNUSED const IDataType* ignored, T* a, T* b) {             \
+    T tmp = *a;                                                                           \
+    *a = *b;                                                                              \
+    *b = tmp;                                                                             \
+  }                                                                                       \
+  static int name##_compare(const void* a, const void* b) {                               \
+    T x = *(const T*)a;                                                                   \
+    T y = *(const T*)b;                                                                   \
+    return (x > y) - (x < y);                                                             \
+  }                                                                                       \
+  static const IDataType IDT_##name = {sizeof(T), 0, sizeof(T), NULL, (Compare)name##_cmp_l, NULL, (Operate)name##_swap, NULL, kind};
+
+DEFINE_SCALAR_TYPE(I8, int8_t, KEY_KIND_SIGNED)
+DEFINE_SCALAR_TYPE(I32, int32_t, KEY_KIND_SIGNED)
+DEFINE_SCALAR_TYPE(U16, uint16_t, KEY_KIND_UNSIGNED)
+DEFINE_SCALAR_TYPE(U64, uint64_t, KEY_KIND_UNSIGNED)
+DEFINE_SCALAR_TYPE(I64, int64_t, KEY_KIND_SIGNED)
+DEFINE_SCALAR_TYPE(F32, float, KEY_KIND_FLOAT)
+DEFINE_SCALAR_TYPE(F64, double, KEY_KIND_FLOAT)
+
+static const IDataType IDT_RECORD = {sizeof(Record), offsetof(Record, key), sizeof(int), (Compare)cst_cmp_e, (Compare)cst_cmp_l, (Compare)cst_cmp_le, (Operate)record_swap, (Calculate)cst_hash, KEY_KIND_SIGNED};
+
+/*
+ * Sorts every pattern at many sizes, and compares with qsort.
+ */
+static int test_ints(SortFunction fn) {
+  static int data[TEST_COUNT];
+  static int expected[TEST_COUNT];
+  const size_t sizes[] = {0, 1, 2, 3, 10, 23, 24, 25, 100, 128, 129, 1000, TEST_COUNT};
+  for(size_t s = 0; s < sizeof(sizes) / sizeof(size_t); s++) {
+    size_t n = sizes[s];
+    for(Pattern p = 0; p < PATTERN_COUNT; p++) {
+      fill_pattern(data, n, p);
+      memcpy(expected, data, n * sizeof(int));
+      qsort(expected, n, sizeof(int), int_compare);
+      fn(data, n, &IDT_INT);
+      if(memcmp(data, expected, n * sizeof(int)) != 0) {
+        printf("Failed sorting %zu %s elements!\n", n, PATTERN_NAMES[p]);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+static int test_records(SortFunction fn) {
+  static Record data[TEST_COUNT];
+  for(size_t i = 0; i < TEST_COUNT; i++) {
+    data[i].key = rand() % 1000;
+    data[i].payload = data[i].key * 3;
+    data[i].check = ~data[i].key;
+  }
+  fn(data, TEST_COUNT, &IDT_RECORD);
+  for(size_t i = 0; i < TEST_COUNT; i++) {
+    if((i != 0 && data[i - 1].key > data[i].key) || data[i].payload != data[i].key * 3 || data[i].check != ~data[i].key) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Many equal keys, with the original position as payload.
+ */
+static int test_stable(SortFunction fn) {
+  static Record data[TEST_COUNT];
+  const int key_ranges[] = {2, 100, TEST_COUNT};
+  for(size_t r = 0; r < sizeof(key_ranges) / sizeof(int); r++) {
+    for(Pattern p = 0; p < PATTERN_COUNT; p++) {
+      static int keys[TEST_COUNT];
+      fill_pattern(keys, TEST_COUNT, p);
+      for(size_t i = 0; i < TEST_COUNT; i++) {
+        data[i].key = keys[i] % key_ranges[r];
+        data[i].payload = i;
+        data[i].check = ~data[i].key;
+      }
+      fn(data, TEST_COUNT, &IDT_RECORD);
+      for(size_t i = 1; i < TEST_COUNT; i++) {
+        if(data[i - 1].key > data[i].key || (data[i - 1].key == data[i].key && data[i - 1].payload >= data[i].payload) || data[i].check != ~data[i].key) {
+          printf("Failed stable sorting %s elements!\n", PATTERN_NAMES[p]);
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Fills with random bytes, so that every bit of integer keys gets used.
+ */
+static void fill_bytes(void* array, size_t bytes) {
+  uint8_t* p = array;
+  for(size_t i = 0; i < bytes; i++) {
+    p[i] = rand() & 0xff;
+  }
+}
+
+static int test_radix_type(const IDataType* dti, int (*compare)(const void*, const void*), int floats) {
+  static uint64_t data[TEST_COUNT];
+  static uint64_t expected[TEST_COUNT];
+  const size_t sizes[] = {0, 1, 100, 255, 256, 1000, TEST_COUNT};
+  for(size_t s = 0; s < sizeof(sizes) / sizeof(size_t); s++) {
+    size_t n = sizes[s];
+    if(floats) {
+      // Random bytes would give NaNs.
+      for(size_t i = 0; i < n; i++) {
+        double v = (rand() - RAND_MAX / 2) / 7.0;
+        if(dti->size == sizeof(float)) {
+          ((float*)data)[i] = v;
+        }
+        else {
+          ((double*)data)[i] = v;
+        }
+      }
+    }
+    else {
+      fill_bytes(data, n * dti->size);
+    }
+    memcpy(expected, data, n * dti->size);
+    qsort(expected, n, dti->size, compare);
+    sort_radix_checked(data, n, dti);
+    if(memcmp(data, expected, n * dti->size) != 0) {
+      printf("Failed radix sorting %zu elements of %zu bytes!\n", n, dti->size);
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+static int test_radix() {
+  if(test_radix_type(&IDT_I8, I8_compare, 0) || test_radix_type(&IDT_I32, I32_compare, 0) || test_radix_type(&IDT_U16, U16_compare, 0)) {
+    return EXIT_FAILURE;
+  }
+  if(test_radix_type(&IDT_U64, U64_compare, 0) || test_radix_type(&IDT_I64, I64_compare, 0)) {
+    return EXIT_FAILURE;
+  }
+  if(test_radix_type(&IDT_F32, F32_compare, 1) || test_radix_type(&IDT_F64, F64_compare, 1)) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+static int bench() {
+  static int source[BENCH_COUNT];
+  static int data[BENCH_COUNT];
+  const SortFunction fns[] = {sort_heap, sort_pdq, sort_tim_checked, sort_radix_checked, sort_parallel_0};
+  const char* fn_names[] = {"heapsort", "pdqsort", "timsort", "radix", "parallel"};
+  printf("pattern:\t qsort");
+  for(size_t f = 0; f < sizeof(fns) / sizeof(SortFunction); f++) {
+    printf(" | %s", fn_names[f]);
+  }
+  printf("\n");
+  for(Pattern p = 0; p < PATTERN_COUNT; p++) {
+    fill_pattern(source, BENCH_COUNT, p);
+    PerfClock pc;
+    clock_reset(&pc);
+    memcpy(data, source, sizeof(data));
+    clock_start(&pc);
+    qsort(data, BENCH_COUNT, sizeof(int), int_compare);
+    clock_stop(&pc);
+    printf("%s: %6.4f", PATTERN_NAMES[p], pc.delta);
+    for(size_t f = 0; f < sizeof(fns) / sizeof(SortFunction); f++) {
+      memcpy(data, source, sizeof(data));
+      clock_start(&pc);
+      fns[f](data, BENCH_COUNT, &IDT_INT);
+      clock_stop(&pc);
+      if(!is_sorted_i(data, BENCH_COUNT)) {
+        return EXIT_FAILURE;
+      }
+      printf(" | %6.4f", pc.delta);
+    }
+    printf("\n");
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
+  srand(time(NULL));
+  if(argc > 1) {
+    return bench();
+  }
+  if(test_ints(sort_heap) || test_records(sort_heap) || test_ints(sort_pdq) || test_ints(sort)) {
+    return EXIT_FAILURE;
+  }
+  if(test_ints(sort_tim_checked) || test_records(sort_pdq) || test_records(sort_tim_checked) || test_stable(sort_tim_checked)) {
+    return EXIT_FAILURE;
+  }
+  if(test_ints(sort_radix_checked) || test_records(sort_radix_checked) || test_stable(sort_radix_checked) || test_radix()) {
+    return EXIT_FAILURE;
+  }
+  if(test_ints(sort_parallel_0) || test_ints(sort_parallel_2) || test_ints(sort_parallel_3) || test_ints(sort_parallel_7)) {
+    return EXIT_FAILURE;
+  }
+  if(test_records(sort_parallel_3) || test_records(sort_parallel_7)) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+#include "test_utils.hpp"
+
+#include <Clock.hpp>
+#include <Heap.hpp>
+#include <Sort.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <vector>
+
+#define TEST_COUNT (64 * 1024)
+#define BENCH_COUNT (1024 * 1024)
+
+/*
+ * Elements with a payload around the key.
+ */
+struct Record {
+  int payload;
+  int key;
+  int check;
+};
+
+static void fill(std::vector<int>& a, int pattern) {
+  std::size_t n = a.size();
+  for(std::size_t i = 0; i < n; i++) {
+    switch(pattern) {
+      case 0:
+        a[i] = std::rand();
+        break;
+      case 1:
+        a[i] = i;
+        break;
+      case 2:
+        a[i] = n - i;
+        break;
+      case 3:
+        a[i] = std::rand() % 4;
+        break;
+      default:
+        a[i] = i < n / 2 ? i : n - i;
+        break;
+    }
+  }
+}
+
+static int test_ints() {
+  const std::size_t sizes[] = {0, 1, 2, 3, 10, 23, 24, 25, 100, 128, 129, 1000, TEST_COUNT};
+  for(std::size_t n : sizes) {
+    for(int p = 0; p < 5; p++) {
+      std::vector<int> data(n);
+      fill(data, p);
+      std::vector<int> expected = data;
+      std::sort(expected.begin(), expected.end());
+      std::vector<int> heap = data;
+      ssce::sort(data.data(), n);
+      ssce::sort_heap(heap.data(), n);
+      if(data != expected || heap != expected) {
+        std::printf("Failed sorting %zu elements of pattern %d!\n", n, p);
+        return EXIT_FAILURE;
+      }
+      // Descending order, through a custom comparator.
+      ssce::sort(data.data(), n, std::greater<int>());
+      if(!std::equal(data.begin(), data.end(), expected.rbegin())) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+static int test_records() {
+  std::vector<Record> data(TEST_COUNT);
+  for(Record& r : data) {
+    r.key = std::rand() % 1000;
+    r.payload = r.key * 3;
+    r.check = ~r.key;
+  }
+  ssce::sort(data.data(), data.size(), [](const Record& a, const Record& b) { return a.key < b.key; });
+  for(std::size_t i = 0; i < data.size(); i++) {
+    if((i != 0 && data[i - 1].key > data[i].key) || data[i].payload != data[i].key * 3 || data[i].check != ~data[i].key) {
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+static int test_heap() {
+  std::vector<double> data(1000);
+  for(double& d : data) {
+    d = std::rand() / 7.0;
+  }
+  ssce::heap_create(data.data(), data.size());
+  for(std::size_t i = 1; i < data.size(); i++) {
+    if(data[(i - 1) / 2] < data[i]) {
+      return EXIT_FAILURE;
+    }
+  }
+  // Replace the root and restore the heap.
+  data[0] = -1;
+  ssce::heap_sift_down(data.data(), data.data(), data.data() + data.size() - 1);
+  for(std::size_t i = 1; i < data.size(); i++) {
+    if(data[(i - 1) / 2] < data[i]) {
+      return EXIT_FAILURE;
+    }
+  }
+  // The C bridge.
+  std::vector<int> ints(TEST_COUNT);
+  fill(ints, 0);
+  ssce::heapsort(ints.data(), ints.size());
+  if(!std::is_sorted(ints.begin(), ints.end())) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+static int bench() {
+  std::vector<int> source(BENCH_COUNT);
+  IDataType dti = ssce::IDataTypeCpp<int>().constructIDataType();
+  std::printf("pattern:\t sort_pdq | ssce::sort | std::sort\n");
+  for(int p = 0; p < 5; p++) {
+    fill(source, p);
+    PerfClock pc;
+    clock_reset(&pc);
+    std::vector<int> data = source;
+    clock_start(&pc);
+    sort_pdq(data.data(), data.size(), &dti);
+    clock_stop(&pc);
+    std::printf("%d: %6.4f", p, pc.delta);
+    data = source;
+    clock_start(&pc);
+    ssce::sort(data.data(), data.size());
+    clock_stop(&pc);
+    std::printf(" | %6.4f", pc.delta);
+    data = source;
+    clock_start(&pc);
+    std::sort(data.begin(), data.end());
+    clock_stop(&pc);
+    std::printf(" | %6.4f\n", pc.delta);
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
+  std::srand(std::time(NULL));
+  if(argc > 1) {
+    return bench();
+  }
+  if(test_ints() || test_records() || test_heap()) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
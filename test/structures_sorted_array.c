@@ -1,5 +1,6 @@
 #include "test_utils.h"
 
+#include <Config.h>
 #include <Macros.h>
 #include <SortedArray.h>
 
@@ -10,6 +11,40 @@
 
 #define STRESS_SECTIONS_LENGTH 4096 / sizeof(int)
 #define STRESS_SECTIONS_COUNT 128u
+// Enough elements to switch to chunks.
+#define CHUNKED_COUNT (KBYTES(160))
+// Sequential inserts just past the switch to chunks.
+#define DRAIN_COUNT (STRUCTURES_SORTED_ARRAY_CHUNKED_BYTES / sizeof(int) + 4464)
+
+/*
+ * Key with the insertion order as payload.
+ */
+typedef struct {
+  int order;
+  int key;
+} Record;
+
+static int record_cmp_e(MARK_UNUSED const IDataType* ignored, const int* a, const int* b) {
+  return *a == *b;
+}
+
+static int record_cmp_l(MARK_UNUSED const IDataType* ignored, const int* a, const int* b) {
+  return *a < *b;
+}
+
+static const IDataType IDT_RECORD = {sizeof(Record), offsetof(Record, key), sizeof(int), (Compare)record_cmp_e, (Compare)record_cmp_l, NULL, NULL, NULL, KEY_KIND_SIGNED};
+
+static int double_cmp_e(MARK_UNUSED const IDataType* ignored, const double* a, const double* b) {
+  return *a == *b;
+}
+
+static int double_cmp_l(MARK_UNUSED const IDataType* ignored, const double* a, const double* b) {
+  return *a < *b;
+}
+
+static const IDataType IDT_DOUBLE = {sizeof(double), 0, sizeof(double), (Compare)double_cmp_e, (Compare)double_cmp_l, NULL, NULL, NULL, KEY_KIND_FLOAT};
+// Both zeros compare equal, so they must be found through each other.
+static const double SIGNED_ZEROS[] = {-1.0, -0.0, 1.0};
 
 static inline void dump_sorted_array(SortedArray* sa) {
   size_t len = sorted_array_size(sa);
@@ -92,6 +127,467 @@ static int stress() {
   return EXIT_SUCCESS;
 }
 
+static int int_compare(const void* a, const void* b) {
+  int x = *(const int*)a;
+  int y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Compares every element with a plain sorted array.
+ */
+static int matches(SortedArray* sa, const int* expected, size_t n) {
+  if(sorted_array_size(sa) != n) {
+    return 0;
+  }
+  for(size_t i = 0; i < n; i++) {
+    int v;
+    if(sorted_array_get(sa, &v, i) || v != expected[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int test_chunked() {
+  static int expected[CHUNKED_COUNT + CHUNKED_COUNT / 2];
+  static int batch[CHUNKED_COUNT / 2];
+  SortedArray* sa = sorted_array_create(&IDT_INT);
+  if(sa == NULL) {
+    return EXIT_FAILURE;
+  }
+  size_t n = 0;
+  for(size_t i = 0; i < CHUNKED_COUNT; i++) {
+    int v = rand() % (CHUNKED_COUNT / 4);
+    size_t index = sorted_array_insert(sa, &v);
+    if(index == INVALID_SIZE_T) {
+      return EXIT_FAILURE;
+    }
+    expected[n++] = v;
+  }
+  qsort(expected, n, sizeof(int), int_compare);
+  if(!matches(sa, expected, n)) {
+    puts("Chunked insert failed!");
+    return EXIT_FAILURE;
+  }
+  // Find.
+  for(int i = 0; i < 1000; i++) {
+    int v = rand() % (CHUNKED_COUNT / 2);
+    size_t index = sorted_array_find(sa, &v);
+    int found;
+    int exists = bsearch(&v, expected, n, sizeof(int), int_compare) != NULL;
+    if(exists != (index != INVALID_SIZE_T) || (exists && (sorted_array_get(sa, &found, index) || found != v))) {
+      puts("Chunked find failed!");
+      return EXIT_FAILURE;
+    }
+  }
+  // Erase and delete.
+  for(int i = 0; i < 1000; i++) {
+    size_t index = rand() % n;
+    if(sorted_array_erase(sa, index)) {
+      return EXIT_FAILURE;
+    }
+    memmove(&expected[index], &expected[index + 1], (n - index - 1) * sizeof(int));
+    n--;
+    int v = expected[rand() % n];
+    index = sorted_array_delete_stable(sa, &v);
+    if(index == INVALID_SIZE_T || (index != 0 && expected[index - 1] == v)) {
+      return EXIT_FAILURE;
+    }
+    memmove(&expected[index], &expected[index + 1], (n - index - 1) * sizeof(int));
+    n--;
+  }
+  if(!matches(sa, expected, n)) {
+    puts("Chunked erase failed!");
+    return EXIT_FAILURE;
+  }
+  // Small and big merges.
+  for(size_t count = 100; count <= CHUNKED_COUNT / 2; count *= 400) {
+    for(size_t i = 0; i < count; i++) {
+      batch[i] = rand();
+      expected[n + i] = batch[i];
+    }
+    if(sorted_array_merge(sa, batch, count)) {
+      return EXIT_FAILURE;
+    }
+    n += count;
+    qsort(expected, n, sizeof(int), int_compare);
+    if(!matches(sa, expected, n)) {
+      puts("Chunked merge failed!");
+      return EXIT_FAILURE;
+    }
+  }
+  sorted_array_compact(sa);
+  if(!matches(sa, expected, n)) {
+    return EXIT_FAILURE;
+  }
+  // Merge two chunked arrays.
+  SortedArray* copy = sorted_array_create(&IDT_INT);
+  if(copy == NULL || sorted_array_merge_sorted(copy, sa) || sorted_array_merge_sorted(sa, copy)) {
+    return EXIT_FAILURE;
+  }
+  if(sorted_array_size(sa) != 2 * n || !is_sorted_i(sorted_array_pointer(sa), 2 * n)) {
+    puts("Chunked merge_sorted failed!");
+    return EXIT_FAILURE;
+  }
+  sorted_array_destroy(copy);
+  // Shrink back to a single block.
+  while(sorted_array_size(sa) > KBYTES(12)) {
+    if(sorted_array_erase(sa, sorted_array_size(sa) - 1)) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(!is_sorted_i(sorted_array_pointer(sa), sorted_array_size(sa))) {
+    return EXIT_FAILURE;
+  }
+  sorted_array_destroy(sa);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Big inserts and merges between calls to sorted_array_pointer, which joins the chunks.
+ */
+static int test_pointer_interleave() {
+  static int expected[CHUNKED_COUNT * 3];
+  static int batch[CHUNKED_COUNT / 8];
+  SortedArray* sa = sorted_array_create(&IDT_INT);
+  if(sa == NULL) {
+    return EXIT_FAILURE;
+  }
+  size_t n = 0;
+  for(int round = 0; round < 24; round++) {
+    for(size_t i = 0; i < CHUNKED_COUNT / 16; i++) {
+      int v = rand() % CHUNKED_COUNT;
+      if(sorted_array_insert(sa, &v) == INVALID_SIZE_T) {
+        return EXIT_FAILURE;
+      }
+      expected[n++] = v;
+    }
+    if(round % 3 == 0) {
+      // Joined arrays are merged flat, chunked ones chunk by chunk.
+      for(size_t i = 0; i < CHUNKED_COUNT / 8; i++) {
+        batch[i] = rand() % CHUNKED_COUNT;
+        expected[n++] = batch[i];
+      }
+      if(sorted_array_merge(sa, batch, CHUNKED_COUNT / 8)) {
+        return EXIT_FAILURE;
+      }
+    }
+    qsort(expected, n, sizeof(int), int_compare);
+    if(round % 2 == 0 && !matches(sa, expected, n)) {
+      puts("Interleaved insert failed!");
+      return EXIT_FAILURE;
+    }
+    int* pointer = sorted_array_pointer(sa);
+    if(pointer == NULL || memcmp(pointer, expected, n * sizeof(int)) != 0) {
+      puts("Interleaved sorted_array_pointer failed!");
+      return EXIT_FAILURE;
+    }
+  }
+  sorted_array_destroy(sa);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Every stored key is found and every other key in [0, DRAIN_COUNT) is not.
+ */
+static int all_found(SortedArray* sa, const int* expected, size_t n) {
+  size_t next = 0;
+  for(int v = 0; v < (int)DRAIN_COUNT; v++) {
+    int exists = next < n && expected[next] == v;
+    size_t index = sorted_array_find(sa, &v);
+    if(exists != (index != INVALID_SIZE_T) || (exists && index != next)) {
+      return 0;
+    }
+    next += exists;
+  }
+  return 1;
+}
+
+/*
+ * Deleting whole chunks, from the middle and from the end, must not leave empty chunks behind.
+ */
+static int test_chunked_drain() {
+  static int expected[DRAIN_COUNT];
+  // Chunks are created three quarters full.
+  const size_t chunk_elements = STRUCTURES_SORTED_ARRAY_CHUNK_BYTES / sizeof(int);
+  const size_t fill = chunk_elements - chunk_elements / 4;
+  SortedArray* sa = sorted_array_create(&IDT_INT);
+  if(sa == NULL) {
+    return EXIT_FAILURE;
+  }
+  size_t n = 0;
+  for(int v = 0; v < (int)DRAIN_COUNT; v++) {
+    if(sorted_array_insert(sa, &v) == INVALID_SIZE_T) {
+      return EXIT_FAILURE;
+    }
+    expected[n++] = v;
+  }
+  // Exactly the fifth chunk.
+  int first = 5 * fill;
+  for(int v = first; v < first + (int)fill; v++) {
+    if(sorted_array_delete_stable(sa, &v) != (size_t)first) {
+      return EXIT_FAILURE;
+    }
+  }
+  memmove(&expected[first], &expected[first + fill], (n - first - fill) * sizeof(int));
+  n -= fill;
+  // More than a chunk from the end.
+  for(int i = 0; i < (int)chunk_elements + 1000; i++) {
+    int v = expected[--n];
+    if(sorted_array_delete_stable(sa, &v) != n) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(!matches(sa, expected, n) || !all_found(sa, expected, n)) {
+    puts("Chunked drain failed!");
+    return EXIT_FAILURE;
+  }
+  // Fill the gap again and delete part of it.
+  for(int v = first; v < first + (int)fill; v++) {
+    if(sorted_array_insert(sa, &v) != (size_t)v) {
+      return EXIT_FAILURE;
+    }
+  }
+  memmove(&expected[first + fill], &expected[first], (n - first) * sizeof(int));
+  for(size_t i = 0; i < fill; i++) {
+    expected[first + i] = first + i;
+  }
+  n += fill;
+  for(int v = first; v < first + (int)fill; v += 2) {
+    if(sorted_array_delete_stable(sa, &v) == INVALID_SIZE_T) {
+      return EXIT_FAILURE;
+    }
+  }
+  size_t kept = first;
+  for(size_t i = first; i < n; i++) {
+    if(i >= first + fill || (expected[i] - first) % 2 != 0) {
+      expected[kept++] = expected[i];
+    }
+  }
+  n = kept;
+  if(!matches(sa, expected, n) || !all_found(sa, expected, n)) {
+    puts("Chunked refill failed!");
+    return EXIT_FAILURE;
+  }
+  sorted_array_destroy(sa);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Equal keys keep their insertion order, both in a single block and in chunks.
+ */
+static int test_stable() {
+  SortedArray* sa = sorted_array_create(&IDT_RECORD);
+  if(sa == NULL) {
+    return EXIT_FAILURE;
+  }
+  for(int i = 0; i < CHUNKED_COUNT / 2; i++) {
+    Record r = {i, rand() % 64};
+    if(sorted_array_insert_stable(sa, &r) == INVALID_SIZE_T) {
+      return EXIT_FAILURE;
+    }
+    if(i == 1000 || i == CHUNKED_COUNT / 2 - 1) {
+      Record previous = {-1, -1};
+      for(size_t j = 0; j < sorted_array_size(sa); j++) {
+        Record current;
+        sorted_array_get(sa, &current, j);
+        if(current.key < previous.key || (current.key == previous.key && current.order <= previous.order)) {
+          puts("Stable insert failed!");
+          return EXIT_FAILURE;
+        }
+        previous = current;
+      }
+    }
+  }
+  // The first inserted gets deleted first.
+  for(int i = 0; i < 10; i++) {
+    Record key = {0, 7};
+    size_t first = 0;
+    Record current;
+    while(sorted_array_get(sa, &current, first) == 0 && current.key < key.key) {
+      first++;
+    }
+    if(current.key != key.key) {
+      break;
+    }
+    int order = current.order;
+    if(sorted_array_delete_stable(sa, &key) != first) {
+      puts("Stable delete failed!");
+      return EXIT_FAILURE;
+    }
+    if(sorted_array_get(sa, &current, first) == 0 && current.key == key.key && current.order <= order) {
+      return EXIT_FAILURE;
+    }
+  }
+  sorted_array_destroy(sa);
+  return EXIT_SUCCESS;
+}
+
+static int test_reserve() {
+  SortedArray* sa = sorted_array_create(&IDT_INT);
+  if(sa == NULL || sorted_array_reserve(sa, 1000)) {
+    return EXIT_FAILURE;
+  }
+  // Reserved memory block never moves.
+  int v = 0;
+  sorted_array_insert(sa, &v);
+  void* block = sorted_array_pointer(sa);
+  for(int i = 1; i < 1000; i++) {
+    v = rand();
+    if(sorted_array_insert(sa, &v) == INVALID_SIZE_T || sorted_array_pointer(sa) != block) {
+      puts("Reserved insert reallocated!");
+      return EXIT_FAILURE;
+    }
+  }
+  // Neither while erasing, or inserting again.
+  while(sorted_array_size(sa) > 100) {
+    sorted_array_erase(sa, sorted_array_size(sa) - 1);
+  }
+  for(int i = 0; i < 900; i++) {
+    v = rand();
+    sorted_array_insert(sa, &v);
+  }
+  if(sorted_array_pointer(sa) != block || !is_sorted_i(block, sorted_array_size(sa))) {
+    puts("Erase reallocated!");
+    return EXIT_FAILURE;
+  }
+  // Compact keeps the contents.
+  while(sorted_array_size(sa) > 10) {
+    sorted_array_erase(sa, rand() % sorted_array_size(sa));
+  }
+  sorted_array_compact(sa);
+  if(sorted_array_size(sa) != 10 || !is_sorted_i(sorted_array_pointer(sa), 10)) {
+    return EXIT_FAILURE;
+  }
+  sorted_array_clear(sa);
+  sorted_array_compact(sa);
+  if(sorted_array_insert(sa, &v) != 0) {
+    return EXIT_FAILURE;
+  }
+  sorted_array_destroy(sa);
+  return EXIT_SUCCESS;
+}
+
+/*
+ * Compares lookups with a plain binary search on \p expected.
+ */
+static int check_lookup(SortedArray* sa, const int* expected, size_t n) {
+  SortedArrayLookup* lookup = sorted_array_lookup_create(sa);
+  if(lookup == NULL || sorted_array_lookup_size(lookup) != n) {
+    return 0;
+  }
+  for(int i = 0; i < 10000; i++) {
+    int v = (i % 2) ? expected[rand() % n] : rand() % (CHUNKED_COUNT * 4) - CHUNKED_COUNT * 2;
+    const int* found = sorted_array_lookup_find(lookup, &v);
+    const int* bound = sorted_array_lookup_lower_bound(lookup, &v);
+    size_t first = 0;
+    size_t end = n;
+    while(first < end) {
+      size_t middle = first + (end - first) / 2;
+      if(expected[middle] < v) {
+        first = middle + 1;
+      }
+      else {
+        end = middle;
+      }
+    }
+    int exists = first < n && expected[first] == v;
+    if(exists != (found != NULL) || (found != NULL && *found != v)) {
+      sorted_array_lookup_destroy(lookup);
+      return 0;
+    }
+    if((first == n) != (bound == NULL) || (bound != NULL && *bound != expected[first])) {
+      sorted_array_lookup_destroy(lookup);
+      return 0;
+    }
+  }
+  sorted_array_lookup_destroy(lookup);
+  return 1;
+}
+
+static int test_lookup() {
+  static int expected[CHUNKED_COUNT];
+  // Opaque keys take the compare function path.
+  IDataType opaque = IDT_INT;
+  opaque.key_kind = KEY_KIND_OPAQUE;
+  const IDataType* interfaces[] = {&IDT_INT, &opaque};
+  const size_t sizes[] = {1, 7, 1000, CHUNKED_COUNT};
+  for(size_t d = 0; d < 2; d++) {
+    for(size_t s = 0; s < 4; s++) {
+      size_t n = sizes[s];
+      SortedArray* sa = sorted_array_create(interfaces[d]);
+      for(size_t i = 0; i < n; i++) {
+        expected[i] = rand() % (CHUNKED_COUNT * 2) - CHUNKED_COUNT;
+      }
+      if(sa == NULL || sorted_array_merge(sa, expected, n)) {
+        return EXIT_FAILURE;
+      }
+      qsort(expected, n, sizeof(int), int_compare);
+      if(!check_lookup(sa, expected, n)) {
+        printf("Lookup of %zu elements failed!\n", n);
+        return EXIT_FAILURE;
+      }
+      sorted_array_destroy(sa);
+    }
+  }
+  // Elements wider than their keys search a separate key array.
+  typedef struct {
+    Record record;
+    double payload;
+  } WideRecord;
+  IDataType wide = IDT_RECORD;
+  wide.size = sizeof(WideRecord);
+  SortedArray* sa = sorted_array_create(&wide);
+  for(int i = 0; i < 5000; i++) {
+    WideRecord r = {{i, 2 * i}, i};
+    sorted_array_insert(sa, &r);
+  }
+  SortedArrayLookup* lookup = sorted_array_lookup_create(sa);
+  for(int i = -1; i < 10001; i++) {
+    WideRecord r = {{0, i}, 0};
+    const WideRecord* found = sorted_array_lookup_find(lookup, &r);
+    const WideRecord* bound = sorted_array_lookup_lower_bound(lookup, &r);
+    if((found != NULL) != (i >= 0 && i <= 9998 && i % 2 == 0) || (found != NULL && found->payload != i / 2)) {
+      puts("Wide lookup failed!");
+      return EXIT_FAILURE;
+    }
+    if((bound == NULL) != (i > 9998) || (bound != NULL && bound->record.key != (i < 0 ? 0 : i + i % 2))) {
+      puts("Wide lower bound failed!");
+      return EXIT_FAILURE;
+    }
+  }
+  sorted_array_lookup_destroy(lookup);
+  sorted_array_destroy(sa);
+  // Signed zeros.
+  sa = sorted_array_create(&IDT_DOUBLE);
+  if(sa == NULL || sorted_array_merge(sa, SIGNED_ZEROS, 3)) {
+    return EXIT_FAILURE;
+  }
+  lookup = sorted_array_lookup_create(sa);
+  for(int sign = 0; sign < 2; sign++) {
+    double zero = sign ? -0.0 : 0.0;
+    const double* found = sorted_array_lookup_find(lookup, &zero);
+    const double* bound = sorted_array_lookup_lower_bound(lookup, &zero);
+    if(found == NULL || *found != 0.0 || bound != found) {
+      puts("Signed zero lookup failed!");
+      return EXIT_FAILURE;
+    }
+  }
+  sorted_array_lookup_destroy(lookup);
+  sorted_array_destroy(sa);
+  // Empty snapshot.
+  sa = sorted_array_create(&IDT_INT);
+  lookup = sorted_array_lookup_create(sa);
+  int v = 0;
+  if(lookup == NULL || sorted_array_lookup_find(lookup, &v) != NULL || sorted_array_lookup_lower_bound(lookup, &v) != NULL) {
+    return EXIT_FAILURE;
+  }
+  sorted_array_lookup_destroy(lookup);
+  sorted_array_destroy(sa);
+  return EXIT_SUCCESS;
+}
+
 int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
   if(argc > 1) {
     return stress();
@@ -135,5 +631,20 @@ int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
     return EXIT_FAILURE;
   }
   sorted_array_destroy(sai);
+  SortedArray* sad = sorted_array_create(&IDT_DOUBLE);
+  if(sad == NULL || sorted_array_merge(sad, SIGNED_ZEROS, 3)) {
+    return EXIT_FAILURE;
+  }
+  const double positive_zero = 0.0;
+  const double negative_zero = -0.0;
+  if(sorted_array_find(sad, &positive_zero) != 1 || sorted_array_find(sad, &negative_zero) != 1) {
+    puts("Signed zero find failed!");
+    return EXIT_FAILURE;
+  }
+  sorted_array_destroy(sad);
+  srand(time(NULL));
+  if(test_reserve() || test_chunked() || test_pointer_interleave() || test_chunked_drain() || test_stable() || test_lookup()) {
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
\ No newline at end of file
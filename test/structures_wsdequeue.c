@@ -0,0 +1,208 @@
+#include "test_utils.h"
+
+#include <Clock.h>
+#include <Dequeue.h>
+#include <Macros.h>
+#include <WSDequeue.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define THIEVES 3
+#define STRESS_COUNT (KBYTES(256))
+#define BENCH_COUNT (MBYTES(8))
+
+/*
+ * Odd size, so slots do not end on a word boundary.
+ */
+typedef struct {
+  uint32_t id;
+  uint32_t check;
+  uint32_t again;
+} Task;
+
+#define task_check(id) ((uint32_t)((id) * UINT32_C(2654435761)))
+
+static const IDataType IDT_TASK = {sizeof(Task), 0, sizeof(uint32_t), NULL, NULL, NULL, NULL, NULL, KEY_KIND_UNSIGNED};
+
+static inline int task_valid(const Task* t) {
+  return t->id < STRESS_COUNT && t->check == task_check(t->id) && t->again == t->id;
+}
+
+static int test_single_thread() {
+  // Tiny capacity, so pushing grows many times.
+  WSDequeue* dq = wsdequeue_create(&IDT_TASK, 2);
+  if(dq == NULL) {
+    return EXIT_FAILURE;
+  }
+  Task t;
+  if(wsdequeue_pop(dq, &t) == 0 || wsdequeue_steal(dq, &t) <= 0) {
+    return EXIT_FAILURE;
+  }
+  for(uint32_t i = 0; i < 1000; i++) {
+    Task in = {i, task_check(i), i};
+    if(wsdequeue_push(dq, &in)) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(wsdequeue_size(dq) != 1000) {
+    return EXIT_FAILURE;
+  }
+  // Owner gets the newest, thieves the oldest.
+  for(uint32_t i = 0; i < 500; i++) {
+    if(wsdequeue_pop(dq, &t) || t.id != 999 - i || !task_valid(&t)) {
+      return EXIT_FAILURE;
+    }
+    if(wsdequeue_steal(dq, &t) || t.id != i || !task_valid(&t)) {
+      return EXIT_FAILURE;
+    }
+  }
+  if(wsdequeue_size(dq) != 0 || wsdequeue_pop(dq, &t) == 0) {
+    return EXIT_FAILURE;
+  }
+  wsdequeue_destroy(dq);
+  return EXIT_SUCCESS;
+}
+
+typedef struct {
+  WSDequeue* dq;
+  // How many times each task was taken.
+  uint8_t* taken;
+  // Set by the owner when it has nothing more to push.
+  int* done;
+  int failed;
+} Worker;
+
+static inline void take(Worker* w, const Task* t) {
+  if(!task_valid(t) || __atomic_add_fetch(&w->taken[t->id], 1, __ATOMIC_RELAXED) != 1) {
+    w->failed = 1;
+  }
+}
+
+static void* thief(void* arg) {
+  Worker* w = arg;
+  while(1) {
+    Task t;
+    int r = wsdequeue_steal(w->dq, &t);
+    if(r == 0) {
+      take(w, &t);
+    }
+    else if(r > 0) {
+      if(__atomic_load_n(w->done, __ATOMIC_ACQUIRE) && wsdequeue_size(w->dq) == 0) {
+        return NULL;
+      }
+      sched_yield();
+    }
+  }
+}
+
+/*
+ * The owner pushes tasks in random bursts and pops some of them back,
+ * while thieves steal from the other end.
+ * Every task must be taken exactly once.
+ */
+static int test_stress() {
+  static uint8_t taken[STRESS_COUNT];
+  int done = 0;
+  WSDequeue* dq = wsdequeue_create(&IDT_TASK, 0);
+  if(dq == NULL) {
+    return EXIT_FAILURE;
+  }
+  Worker owner = {dq, taken, &done, 0};
+  Worker thieves[THIEVES];
+  pthread_t threads[THIEVES];
+  for(int i = 0; i < THIEVES; i++) {
+    thieves[i] = owner;
+    if(pthread_create(&threads[i], NULL, thief, &thieves[i])) {
+      return EXIT_FAILURE;
+    }
+  }
+  uint32_t next = 0;
+  while(next < STRESS_COUNT) {
+    uint32_t burst = rand() % 512;
+    for(uint32_t i = 0; i < burst && next < STRESS_COUNT; i++, next++) {
+      Task t = {next, task_check(next), next};
+      if(wsdequeue_push(dq, &t)) {
+        return EXIT_FAILURE;
+      }
+    }
+    uint32_t pops = rand() % 512;
+    for(uint32_t i = 0; i < pops; i++) {
+      Task t;
+      if(wsdequeue_pop(dq, &t) == 0) {
+        take(&owner, &t);
+      }
+    }
+  }
+  Task t;
+  while(wsdequeue_size(dq) != 0) {
+    if(wsdequeue_pop(dq, &t) == 0) {
+      take(&owner, &t);
+    }
+  }
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+  int failed = owner.failed;
+  for(int i = 0; i < THIEVES; i++) {
+    pthread_join(threads[i], NULL);
+    failed |= thieves[i].failed;
+  }
+  for(size_t i = 0; i < STRESS_COUNT; i++) {
+    failed |= taken[i] != 1;
+  }
+  wsdequeue_destroy(dq);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Owner side push and pop, compared with Dequeue which has no synchronization.
+ */
+static int bench() {
+  WSDequeue* ws = wsdequeue_create(&IDT_INT, 0);
+  Dequeue* dq = dequeue_create(&IDT_INT);
+  if(ws == NULL || dq == NULL) {
+    return EXIT_FAILURE;
+  }
+  PerfClock pc;
+  clock_reset(&pc);
+  clock_start(&pc);
+  for(int i = 0; i < BENCH_COUNT; i++) {
+    wsdequeue_push(ws, &i);
+    if(i % 4 == 3) {
+      int v;
+      wsdequeue_pop(ws, &v);
+      wsdequeue_pop(ws, &v);
+    }
+  }
+  clock_stop(&pc);
+  printf("wsdequeue: %6.4f\n", pc.delta);
+  clock_start(&pc);
+  for(int i = 0; i < BENCH_COUNT; i++) {
+    dequeue_push_back(dq, &i);
+    if(i % 4 == 3) {
+      int v;
+      dequeue_pop_back(dq, &v);
+      dequeue_pop_back(dq, &v);
+    }
+  }
+  clock_stop(&pc);
+  printf("dequeue: %6.4f\n", pc.delta);
+  wsdequeue_destroy(ws);
+  dequeue_destroy(dq);
+  return EXIT_SUCCESS;
+}
+
+int main(MARK_UNUSED int argc, MARK_UNUSED char* argv[]) {
+  if(argc > 1) {
+    return bench();
+  }
+  srand(time(NULL));
+  if(test_single_thread() || test_stress()) {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
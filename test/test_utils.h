@@ -87,6 +87,6 @@ static size_t cst_hash(MARK_UNUSED const IDataType* ignored, const int* k) {
   return *k;
 }
 
-const IDataType IDT_INT = {4, 0, 4, (Compare)cst_cmp_e, (Compare)cst_cmp_l, (Compare)cst_cmp_le, (Operate)cst_swap, (Calculate)cst_hash};
+const IDataType IDT_INT = {4, 0, 4, (Compare)cst_cmp_e, (Compare)cst_cmp_l, (Compare)cst_cmp_le, (Operate)cst_swap, (Calculate)cst_hash, KEY_KIND_SIGNED};
 
 #endif /*TEST_UTILS_H*/
\ No newline at end of file